@@ -1,4 +1,5 @@
 import struct
+import zlib
 from pathlib import Path
 
 from operator import itemgetter
@@ -21,11 +22,15 @@ import matplotlib.pyplot as plt
 
 
 class BlockMetadata():
-    def __init__(self, metatype, index, start, end):
+    def __init__(self, metatype, index, start, end, sequence_number=None, block_type=None):
         self.metatype = metatype
         self.index = index
         self.start = start
         self.end = end
+        # None for the files written before the block numbers were sequence numbers
+        self.sequence_number = sequence_number
+        # the block type char as on the SD card, i.e. 'R' for compressed data parsed as "ADC"
+        self.block_type = block_type
 
 
 class DataEntry():
@@ -64,28 +69,500 @@ class ChannelStats():
                )
 
 
+class ChannelExactStats():
+    """The exact integer sums behind a ChannelStats, as logged in the 'S' records (the STEX messages before).
+    All values are relative to the middle ADC value. Everything derived here is
+    computed from the integers, so it is reproducible bit for bit."""
+    def __init__(self, channel, nbr_samples, sum_x, sum_x2, max_val, min_val, count_extrema):
+        self.channel = channel
+        self.nbr_samples = nbr_samples
+        self.sum_x = sum_x
+        self.sum_x2 = sum_x2
+        self.max_val = max_val
+        self.min_val = min_val
+        self.count_extrema = count_extrema
+
+        self.mean_x = self.sum_x / self.nbr_samples
+        self.mean_x2 = self.sum_x2 / self.nbr_samples
+        # n**2 * variance is an exact, non negative integer
+        self.std = math.sqrt(self.nbr_samples * self.sum_x2 - self.sum_x**2) / self.nbr_samples
+
+    def __repr__(self):
+        return("< chnl {}: n {} | sum {} | sum of sqr {} | min {} | max {} | nbr extremal {} | mean {} | std {} >".format(
+            self.channel,
+            self.nbr_samples,
+            self.sum_x,
+            self.sum_x2,
+            self.min_val,
+            self.max_val,
+            self.count_extrema,
+            self.mean_x,
+            self.std
+        )
+               )
+
+
+def decode_rice_block(data):
+    """Decode the data part (500 bytes) of a compressed 'R' ADC block, as written by the
+    RiceBlockEncoder of the logger (see RiceBlockCodec.h for the layout). Returns the list of samples."""
+    nbr_samples, first_sample = struct.unpack('<HH', data[0:4])
+
+    if nbr_samples == 0:
+        return []
+
+    bitstream = data[4:]
+    nbr_bits = 8 * len(bitstream)
+    # turn the bitstream into one large integer, so that bits can be read MSB first
+    bits_value = int.from_bytes(bitstream, byteorder="big")
+    crrt_bit = 0
+
+    def read_bits(nbr_bits_to_read):
+        nonlocal crrt_bit
+        if crrt_bit + nbr_bits_to_read > nbr_bits:
+            raise ValueError("corrupted rice block")
+        value = (bits_value >> (nbr_bits - crrt_bit - nbr_bits_to_read)) & ((1 << nbr_bits_to_read) - 1)
+        crrt_bit += nbr_bits_to_read
+        return value
+
+    list_samples = [first_sample]
+    previous_sample = first_sample
+
+    while len(list_samples) < nbr_samples:
+        partition_header = read_bits(8)
+        k = partition_header >> 4
+        nbr_values_in_partition = (partition_header & 0x0F) + 1
+
+        if len(list_samples) + nbr_values_in_partition > nbr_samples:
+            raise ValueError("corrupted rice block")
+
+        for _ in range(nbr_values_in_partition):
+            if k == 15:
+                previous_sample = read_bits(16)
+            else:
+                quotient = 0
+                while read_bits(1) == 1:
+                    quotient += 1
+                zigzag_value = (quotient << k) | read_bits(k)
+                delta = (zigzag_value >> 1) ^ -(zigzag_value & 1)
+                previous_sample = (previous_sample + delta) & 0xFFFF
+
+            list_samples.append(previous_sample)
+
+    return list_samples
+
+
+def parse_telemetry_block(data):
+    """Decode the data part (500 bytes) of a 'T' telemetry block, as written by
+    FastLogger::write_telemetry_block. Returns a dict. The histograms are lists of counts of durations in
+    micros: bucket 0 counts the 0s, bucket i the durations in [2**(i-1), 2**i), and the last bucket all the
+    longer ones. The histograms, maxima and minima are over the telemetry period, the loss counters are totals
+    since the start of the recording."""
+    (format_version, nbr_buckets) = struct.unpack_from('<HH', data, 0)
+    ras(format_version in (1, 2, 3), "unknown telemetry format version {}".format(format_version))
+
+    dict_telemetry = {}
+    dict_telemetry["format_version"] = format_version
+
+    (dict_telemetry["nbr_blocks_in_pool"], dict_telemetry["pool_min_nbr_free_blocks"],
+     dict_telemetry["nbr_adc_block_sets_in_queue"], dict_telemetry["adc_queue_max_nbr_block_sets"]) = \
+        struct.unpack_from('<HHHH', data, 4)
+    offset = 12
+
+    (dict_telemetry["nbr_blocks_written"], dict_telemetry["sd_write_max_micros"]) = struct.unpack_from('<LL', data, offset)
+    offset += 8
+    dict_telemetry["sd_write_micros_histogram"] = list(struct.unpack_from('<{}L'.format(nbr_buckets), data, offset))
+    offset += 4 * nbr_buckets
+
+    (dict_telemetry["internal_update_total_micros"], dict_telemetry["internal_update_max_micros"]) = \
+        struct.unpack_from('<LL', data, offset)
+    offset += 8
+    dict_telemetry["internal_update_micros_histogram"] = list(struct.unpack_from('<{}L'.format(nbr_buckets), data, offset))
+    offset += 4 * nbr_buckets
+
+    (dict_telemetry["adc_nbr_dropped_samples"], dict_telemetry["adc_nbr_conversion_overruns"],
+     dict_telemetry["nbr_dropped_chars"]) = struct.unpack_from('<LLL', data, offset)
+    offset += 12
+
+    # from version 2, the records are counted too, see parse_record_block
+    if format_version >= 2:
+        (dict_telemetry["nbr_dropped_records"],) = struct.unpack_from('<L', data, offset)
+    else:
+        dict_telemetry["nbr_dropped_records"] = 0
+    offset += 4
+
+    # from version 3, the lowest slack of the scheduler over the period, in micros: how long the free blocks of the
+    # pool would have lasted the ADC
+    if format_version >= 3:
+        (dict_telemetry["min_slack_micros"],) = struct.unpack_from('<L', data, offset)
+    else:
+        dict_telemetry["min_slack_micros"] = None
+
+    return dict_telemetry
+
+
+# the layout of each kind of record, by record tag, as (struct format, field names); these follow the record structs
+# of the firmware: 'S' ChannelStatsRecord and 'U' AdcUtcRecord (FastLogger.h), 'D' SonarRecord (SonarManager.h),
+# 'Z' TimebaseRecord (PpsTimebase.h); the 'T' TemperaturesRecord
+# (TemperatureSensors.h) has a variable nbr of sensors, and is decoded by parse_temperatures_record, and the 'P'
+# SonarProfileRecord (SonarManager.h) by parse_sonar_profile_record
+dict_record_layouts = {
+    "S": ('<HHLqqllLL', ("channel", "unused_0", "nbr_samples", "sum", "sum_of_squares", "max", "min",
+                         "extremal_count", "unused_1")),
+    "D": ('<LLHH', ("micros_request", "distance", "confidence", "is_valid")),
+    "U": ('<HHLq', ("block_number", "unused", "micros_start", "utc_micros_start")),
+    "Z": ('<LHHqlL', ("micros_reference", "nbr_edges_in_fit", "nbr_rejected_edges", "utc_micros_reference",
+                      "drift_ppb", "residual_rms_nanos")),
+}
+
+
+# the value of a temperature sensor that did not answer, see temperature_no_reading in TemperatureSensors.h
+temperature_no_reading = -32768
+
+
+def parse_temperatures_record(payload):
+    """Decode the payload of a 'T' record: the nbr of sensors, and the temperatures in degrees, NaN for a sensor
+    that did not answer."""
+    (nbr_sensors,) = struct.unpack_from('<H', payload, 0)
+    centi_degrees = struct.unpack_from('<{}h'.format(nbr_sensors), payload, 2)
+    return {"nbr_sensors": nbr_sensors,
+            "temperatures": [float("nan") if crrt_value == temperature_no_reading else crrt_value / 100.0
+                             for crrt_value in centi_degrees]}
+
+
+# the largest nbr of points of a sonar profile, see ping1d_max_profile_nbr_points in Ping1DParser.h
+sonar_max_profile_nbr_points = 200
+
+
+def parse_sonar_profile_record(payload):
+    """Decode the payload of a 'P' record: the fields of the Ping1D profile message, and its "profile" as a list of
+    echo strengths (0 to 255), evenly spaced over scan_length mm starting at scan_start mm."""
+    field_names = ("micros_request", "distance", "confidence", "transmit_duration", "ping_number", "scan_start",
+                   "scan_length", "gain_setting", "profile_data_length")
+    dict_record = dict(zip(field_names, struct.unpack_from('<LLHHLLLLH', payload, 0)))
+
+    nbr_points = min(dict_record["profile_data_length"], sonar_max_profile_nbr_points)
+    dict_record["profile"] = list(payload[30:30 + nbr_points])
+
+    return dict_record
+
+
+def parse_record_block(data):
+    """Decode the data part (500 bytes) of a 'B' record block, as written by FastLogger::log_record. Returns a
+    list of dicts, one per record, each with its "tag" (a one char string), the "micros" when it was logged, and
+    the fields of the record. The records with an unknown tag are kept, with their raw "payload"."""
+    list_records = []
+    offset = 0
+
+    while offset + 8 <= len(data):
+        (tag, nbr_bytes, _, micros) = struct.unpack_from('<BBHL', data, offset)
+
+        # the rest of the block is empty
+        if tag == 0:
+            break
+
+        payload = data[offset + 8: offset + 8 + nbr_bytes]
+        tag = chr(tag)
+
+        if tag in dict_record_layouts:
+            (format_struct, field_names) = dict_record_layouts[tag]
+            dict_record = dict(zip(field_names, struct.unpack_from(format_struct, payload, 0)))
+        elif tag == "T":
+            dict_record = parse_temperatures_record(payload)
+        elif tag == "P":
+            dict_record = parse_sonar_profile_record(payload)
+        else:
+            dict_record = {"payload": payload}
+
+        dict_record["tag"] = tag
+        dict_record["micros"] = micros
+        list_records.append(dict_record)
+
+        offset += 8 + nbr_bytes
+
+    return list_records
+
+
+def parse_header_block(data):
+    """Decode the data part (500 bytes) of the 'H' header block that starts each file, as written by
+    FastLogger::write_file_header. Returns a dict."""
+    (format_version, nbr_adc_channels) = struct.unpack_from('<HH', data, 0)
+    ras(format_version in (1, 2, 3), "unknown file format version {}".format(format_version))
+
+    dict_header = {}
+    dict_header["format_version"] = format_version
+    dict_header["nbr_adc_channels"] = nbr_adc_channels
+    dict_header["adc_channels"] = list(data[4:4 + nbr_adc_channels])
+
+    (dict_header["sampling_frequency"], acquisition_frequency_mHz, dict_header["adc_prescale"],
+     dict_header["adc_oversampling_ratio"], dict_header["adc_timer_rc"], dict_header["adc_logged_bits"],
+     dict_header["nbr_adc_measurements_per_block"], flags, dict_header["file_duration_seconds"],
+     dict_header["file_number"]) = struct.unpack_from('<LLHHLHHHHL', data, 20)
+
+    dict_header["acquisition_frequency"] = acquisition_frequency_mHz / 1000.0
+    dict_header["adc_compression"] = bool(flags & 0b1)
+    dict_header["event_logging"] = bool(flags & 0b10)
+    dict_header["firmware_build"] = data[48:80].split(b"\x00")[0].decode("ascii", errors="replace")
+
+    # from version 2, the files have check blocks, see parse_check_block
+    if format_version >= 2:
+        (dict_header["check_group_nbr_blocks"],) = struct.unpack_from('<H', data, 80)
+    else:
+        dict_header["check_group_nbr_blocks"] = None
+
+    return dict_header
+
+
+def parse_check_block(block):
+    """Decode a whole 512 bytes 'K' check block, as written by FastLogger::write_check_block. Returns a dict, or
+    None if the block is not a check block, or was not fully written (its own CRC does not match)."""
+    if block[0:1] != b"K" or zlib.crc32(block[0:508]) != struct.unpack_from('<L', block, 508)[0]:
+        return None
+
+    dict_check = {}
+    (dict_check["file_number"], dict_check["group_index"], dict_check["nbr_blocks_covered"],
+     is_final) = struct.unpack_from('<LLHH', block, 12)
+    dict_check["is_final"] = bool(is_final)
+    dict_check["block_crcs"] = list(struct.unpack_from('<{}L'.format(dict_check["nbr_blocks_covered"]), block, 24))
+
+    return dict_check
+
+
+def verify_file(path_to_file):
+    """Check the CRC of every block of a file, from the check blocks (file format version 2 on, see
+    BlockCheckWithMetadata in FastLogger.h). Returns None for the files without check blocks, otherwise a dict with:
+    - nbr_blocks_in_file
+    - nbr_verified_blocks: the blocks at the start of the file covered by check blocks, i.e. the data; after these,
+      the blocks were never written, or were lost at a power loss
+    - is_closed: if the file ends with the final check block, i.e. was closed normally
+    - bad_blocks: the offsets (in blocks from the start of the file) of the blocks whose CRC does not match."""
+    dict_header = read_file_header(path_to_file)
+
+    if dict_header is None or dict_header["check_group_nbr_blocks"] is None:
+        return None
+
+    group_nbr_blocks = dict_header["check_group_nbr_blocks"]
+
+    with open(path_to_file, "rb") as fh:
+        data = fh.read()
+
+    nbr_blocks_in_file = len(data) // 512
+    nbr_verified_blocks = 0
+    list_bad_blocks = []
+    is_closed = False
+    crrt_group = 0
+
+    def get_block(block_offset):
+        return data[512 * block_offset: 512 * (block_offset + 1)]
+
+    while True:
+        first_block_offset = crrt_group * group_nbr_blocks
+
+        # the check block is the last one of a full group, or the final one, anywhere in the last group
+        crrt_check = None
+        for crrt_block in range(min(group_nbr_blocks, nbr_blocks_in_file - first_block_offset)):
+            candidate = parse_check_block(get_block(first_block_offset + crrt_block))
+
+            if (candidate is not None and candidate["file_number"] == dict_header["file_number"] and
+                    candidate["group_index"] == crrt_group and candidate["nbr_blocks_covered"] == crrt_block):
+                crrt_check = candidate
+                break
+
+        if crrt_check is None:
+            break
+
+        for crrt_block, crrt_crc in enumerate(crrt_check["block_crcs"]):
+            if zlib.crc32(get_block(first_block_offset + crrt_block)) != crrt_crc:
+                list_bad_blocks.append(first_block_offset + crrt_block)
+
+        nbr_verified_blocks = first_block_offset + crrt_check["nbr_blocks_covered"] + 1
+
+        if crrt_check["is_final"]:
+            is_closed = True
+            break
+
+        crrt_group += 1
+
+    return {"nbr_blocks_in_file": nbr_blocks_in_file,
+            "nbr_verified_blocks": nbr_verified_blocks,
+            "is_closed": is_closed,
+            "bad_blocks": list_bad_blocks}
+
+
+def parse_index_block(data):
+    """Decode the data part (500 bytes) of an 'I' index block, as written by FastLogger::write_file_index.
+    Returns a list of entries, each a dict with the block type char, channel and sequence number of the
+    indexed block, its offset in blocks from the start of the file, and its micros start."""
+    (nbr_entries,) = struct.unpack_from('<H', data, 0)
+    list_entries = []
+
+    for crrt_entry_index in range(nbr_entries):
+        (metadata_id, block_number, block_offset, micros_start) = struct.unpack_from('<HHLL', data, 4 + 12 * crrt_entry_index)
+        list_entries.append({"block_type": chr(metadata_id & 0xFF),
+                             "channel": (metadata_id >> 8) & 0x7F,
+                             "sequence_number": block_number,
+                             "block_offset": block_offset,
+                             "micros_start": micros_start})
+
+    return list_entries
+
+
+def read_file_header(path_to_file):
+    """The header of a file (see parse_header_block), or None for the files written before the headers."""
+    with open(path_to_file, "rb") as fh:
+        first_block = fh.read(512)
+
+    if len(first_block) < 512 or first_block[0:1] != b"H":
+        return None
+
+    return parse_header_block(first_block[12:512])
+
+
+def read_file_index(path_to_file):
+    """The index of a file, read from its last blocks without reading the rest of it (see parse_index_block),
+    or None if it has no index, i.e. if it was written before the index, or never closed (power loss)."""
+    list_entries = []
+    found_index = False
+
+    with open(path_to_file, "rb") as fh:
+        fh.seek(0, 2)
+        crrt_block_offset = fh.tell() // 512 - 1
+
+        # the index blocks are numbered from 0, and are the last blocks of the file, but for the final check block
+        fh.seek(512 * max(crrt_block_offset, 0))
+        if fh.read(1) == b"K":
+            crrt_block_offset -= 1
+
+        while crrt_block_offset >= 0:
+            fh.seek(512 * crrt_block_offset)
+            crrt_block = fh.read(512)
+
+            if crrt_block[0:1] != b"I":
+                break
+
+            found_index = True
+            list_entries = parse_index_block(crrt_block[12:512]) + list_entries
+
+            if struct.unpack_from('<H', crrt_block, 2)[0] == 0:
+                break
+
+            crrt_block_offset -= 1
+
+    if not found_index:
+        return None
+
+    return list_entries
+
+
+def read_time_window(path_to_file, micros_start, micros_end, block_type="A"):
+    """Read only the blocks of a type (as on the SD card, i.e. "A", "R", "D", "C", "T") that overlap a micros
+    window, using the file index to go straight to them. Returns a list of (metadata, data) tuples, as from
+    BinaryFileParser.parse_data_block. Without index, the whole file is read. The micros are the raw ones of the
+    logger, so the window must not span a wrap of micros. The compressed "R" blocks are written once full, so
+    for these the window may need to start up to a block duration earlier."""
+    list_entries = read_file_index(path_to_file)
+
+    first_block_offset = 0
+
+    if list_entries is not None:
+        for crrt_entry in list_entries:
+            if crrt_entry["block_type"] == block_type and crrt_entry["micros_start"] <= micros_start:
+                first_block_offset = max(first_block_offset, crrt_entry["block_offset"])
+
+    list_blocks = []
+    set_channels_seen = set()
+    set_channels_done = set()
+
+    with open(path_to_file, "rb") as fh:
+        fh.seek(512 * first_block_offset)
+
+        while True:
+            crrt_block = fh.read(512)
+
+            if len(crrt_block) < 512 or crrt_block[0:2] in (b"\x00\x00", b"\xff\xff"):
+                break
+
+            if chr(crrt_block[0]) != block_type:
+                continue
+
+            crrt_metadata, crrt_data = BinaryFileParser.parse_data_block(crrt_block)
+
+            # the blocks of a type and channel are written in time order: stop once all the channels are past
+            # the window
+            set_channels_seen.add(crrt_metadata.index)
+
+            if crrt_metadata.start > micros_end:
+                set_channels_done.add(crrt_metadata.index)
+
+                if set_channels_done == set_channels_seen:
+                    break
+
+                continue
+
+            if crrt_metadata.end >= micros_start:
+                list_blocks.append((crrt_metadata, crrt_data))
+
+    return list_blocks
+
+
+def telemetry_histogram_bucket_bounds(nbr_buckets):
+    """The lower bound, in micros, of each bucket of the telemetry histograms."""
+    return [0] + [2**(crrt_bucket - 1) for crrt_bucket in range(1, nbr_buckets)]
+
+
 class BinaryFileParser():
     """Parse an individual file, by reading the binary data blocks,
     and generating micros timestamps and corresponding entry lists
     for both ADC and CHR."""
     ADC_indicator = 65
     CHR_indicator = 67
+    DEC_indicator = 68
+    RIC_indicator = 82
+    TEL_indicator = 84
+    HDR_indicator = 72
+    IDX_indicator = 73
+    CHK_indicator = 75
+    REC_indicator = 66
     n_ADC_entries_per_block = 250
+    # in metadata_id, the low byte is the block type; if this flag is set, the high byte also holds the channel,
+    # and the block number is a sequence number; otherwise the block number is the channel
+    sequenced_flag = 0x8000
+    sequence_number_modulo = 2**16
 
     def __init__(self, path_to_file, n_ADC_channels=5):
+        """n_ADC_channels is only used for the files written before the file headers; otherwise, the header tells."""
         ras(isinstance(path_to_file, Path))
 
-        self.n_ADC_channels = n_ADC_channels
         self.path_to_file = path_to_file
 
+        self.header = read_file_header(path_to_file)
+        if self.header is not None:
+            n_ADC_channels = self.header["nbr_adc_channels"]
+        self.n_ADC_channels = n_ADC_channels
+
         self.dict_parsed_data = {}
+        self.dict_parsed_data["header"] = self.header
+        # the CRC check of the blocks, see verify_file; None for the files written before the check blocks
+        self.dict_parsed_data["verification"] = verify_file(path_to_file)
+        # the file index, see parse_index_block
+        self.dict_parsed_data["index"] = []
         self.dict_parsed_data["ADC"] = {}
         for crrt_channel in range(self.n_ADC_channels):
             self.dict_parsed_data["ADC"][crrt_channel] = []
         self.dict_parsed_data["CHR"] = []
+        # the nbr of blocks missing, from the gaps in the sequence numbers, per (block type, channel)
+        self.dict_parsed_data["missing_blocks"] = {}
+        # the decimated ADC data, written instead of the ADC data when the logger does event triggered logging
+        self.dict_parsed_data["DEC"] = {}
+        for crrt_channel in range(self.n_ADC_channels):
+            self.dict_parsed_data["DEC"][crrt_channel] = []
+        # the telemetry blocks, one dict per block, see parse_telemetry_block
+        self.dict_parsed_data["TEL"] = []
+        # the binary records, one dict per record, see parse_record_block
+        self.dict_parsed_data["REC"] = []
 
         self.parse_file()
         self.generate_ADC_timeseries()
+        self.generate_ADC_timeseries(kind="DEC")
         self.assemble_char_data()
 
     def parse_file(self):
@@ -98,67 +575,153 @@ class BinaryFileParser():
 
         self.nbr_blocks = int(data_length / 512)
 
-        for crrt_block_ind in range(self.nbr_blocks):
+        # with check blocks, only what they cover is data, less the blocks that do not match their CRC
+        nbr_blocks_to_parse = self.nbr_blocks
+        set_bad_blocks = set()
+        dict_verification = self.dict_parsed_data["verification"]
+
+        if dict_verification is not None:
+            nbr_blocks_to_parse = dict_verification["nbr_verified_blocks"]
+            set_bad_blocks = set(dict_verification["bad_blocks"])
+
+        dict_last_sequence_numbers = {}
+
+        for crrt_block_ind in range(nbr_blocks_to_parse):
+            if crrt_block_ind in set_bad_blocks:
+                continue
+
             crrt_block = self.data[512 * crrt_block_ind: 512 * (crrt_block_ind + 1)]
+
+            # a file that was not closed (power loss) still has its pre-allocated size: the data end at the first
+            # empty or erased block (an erased sector reads as all 0x00 or all 0xFF, depending on the card)
+            if crrt_block[0:2] in (b"\x00\x00", b"\xff\xff"):
+                break
+
             crrt_metadata, crrt_data = self.parse_data_block(crrt_block)
             crrt_entry = DataEntry(crrt_metadata.start, crrt_metadata.end, crrt_data)
 
+            if crrt_metadata.sequence_number is not None:
+                crrt_stream = (crrt_metadata.block_type, crrt_metadata.index)
+                if crrt_stream not in dict_last_sequence_numbers:
+                    self.dict_parsed_data["missing_blocks"][crrt_stream] = 0
+                else:
+                    nbr_missing = (crrt_metadata.sequence_number - dict_last_sequence_numbers[crrt_stream] - 1) % self.sequence_number_modulo
+                    self.dict_parsed_data["missing_blocks"][crrt_stream] += nbr_missing
+                dict_last_sequence_numbers[crrt_stream] = crrt_metadata.sequence_number
+
             if crrt_metadata.metatype == "ADC":
                 self.dict_parsed_data["ADC"][crrt_metadata.index].append(crrt_entry)
 
             if crrt_metadata.metatype == "CHR":
                 self.dict_parsed_data["CHR"].append(crrt_entry)
 
-    def parse_data_block(self, block):
+            if crrt_metadata.metatype == "DEC":
+                self.dict_parsed_data["DEC"][crrt_metadata.index].append(crrt_entry)
+
+            if crrt_metadata.metatype == "IDX":
+                self.dict_parsed_data["index"].extend(crrt_data)
+
+            if crrt_metadata.metatype == "TEL":
+                crrt_data["micros_start"] = crrt_metadata.start
+                crrt_data["micros_end"] = crrt_metadata.end
+                self.dict_parsed_data["TEL"].append(crrt_data)
+
+            if crrt_metadata.metatype == "REC":
+                self.dict_parsed_data["REC"].extend(crrt_data)
+
+    @classmethod
+    def parse_data_block(cls, block):
         # first parse the metadata of the block
         metadata = block[0:12]
         parsed_metadata = struct.unpack('<HHLL', metadata)
 
-        metadata_type = parsed_metadata[0]
+        metadata_id = parsed_metadata[0]
+        metadata_type = metadata_id & 0xFF
+        block_type = chr(metadata_type)
+        compressed = False
 
-        if metadata_type == self.ADC_indicator:
+        if metadata_id & cls.sequenced_flag:
+            channel = (metadata_id >> 8) & 0x7F
+            sequence_number = parsed_metadata[1]
+        else:
+            channel = parsed_metadata[1]
+            sequence_number = None
+
+        if metadata_type == cls.ADC_indicator:
             metadata_type = "ADC"
-        elif metadata_type == self.CHR_indicator:
+        elif metadata_type == cls.CHR_indicator:
             metadata_type = "CHR"
+        elif metadata_type == cls.DEC_indicator:
+            metadata_type = "DEC"
+        elif metadata_type == cls.RIC_indicator:
+            # compressed ADC data: once decoded, these are ADC data with a variable nbr of samples
+            metadata_type = "ADC"
+            compressed = True
+        elif metadata_type == cls.TEL_indicator:
+            metadata_type = "TEL"
+        elif metadata_type == cls.HDR_indicator:
+            metadata_type = "HDR"
+        elif metadata_type == cls.IDX_indicator:
+            metadata_type = "IDX"
+        elif metadata_type == cls.CHK_indicator:
+            metadata_type = "CHK"
+        elif metadata_type == cls.REC_indicator:
+            metadata_type = "REC"
         else:
             raise ValueError("unknown metadata type")
 
-        metadata = BlockMetadata(metadata_type, parsed_metadata[1],
-                                 parsed_metadata[2], parsed_metadata[3])
+        metadata = BlockMetadata(metadata_type, channel,
+                                 parsed_metadata[2], parsed_metadata[3],
+                                 sequence_number=sequence_number, block_type=block_type)
 
         # then parse the block content depending on the block type
         data = block[12:512]
 
-        if metadata_type == "ADC":
+        if compressed:
+            data = decode_rice_block(data)
+        elif metadata_type in ["ADC", "DEC"]:
             format_struct = "<" + 250 * "H"
             data = struct.unpack(format_struct, data)
+        elif metadata_type == "TEL":
+            data = parse_telemetry_block(data)
+        elif metadata_type == "HDR":
+            data = parse_header_block(data)
+        elif metadata_type == "IDX":
+            data = parse_index_block(data)
+        elif metadata_type == "CHK":
+            data = parse_check_block(block)
+        elif metadata_type == "REC":
+            data = parse_record_block(data)
         elif metadata_type == "CHR":
             pass
 
         return metadata, data
 
-    def generate_ADC_timeseries(self):
-        self.dict_parsed_data["ADC_parsed"] = {}
+    def generate_ADC_timeseries(self, kind="ADC"):
+        """kind is either ADC, or DEC for the decimated data; both have the same block layout."""
+        self.dict_parsed_data["{}_parsed".format(kind)] = {}
 
         for crrt_channel in range(self.n_ADC_channels):
-            crrt_list_entries = self.dict_parsed_data["ADC"][crrt_channel]
+            crrt_list_entries = self.dict_parsed_data[kind][crrt_channel]
             list_times = []
             list_readings = []
 
             for crrt_entry in crrt_list_entries:
                 start = crrt_entry.start
                 end = crrt_entry.end
-                delta_time = float(end - start) / (self.n_ADC_entries_per_block - 1)
                 data = crrt_entry.data
+                # compressed blocks have a variable nbr of entries
+                nbr_entries = len(data)
+                delta_time = float(end - start) / max(nbr_entries - 1, 1)
 
-                for crrt_value_index in range(self.n_ADC_entries_per_block):
+                for crrt_value_index in range(nbr_entries):
                     crrt_time = start + crrt_value_index * delta_time
                     list_times.append(crrt_time)
                     list_readings.append(data[crrt_value_index])
 
-            self.dict_parsed_data["ADC_parsed"][crrt_channel] = {}
-            self.dict_parsed_data["ADC_parsed"][crrt_channel]["micros"] = list_times
-            self.dict_parsed_data["ADC_parsed"][crrt_channel]["readings"] = list_readings
+            self.dict_parsed_data["{}_parsed".format(kind)][crrt_channel] = {}
+            self.dict_parsed_data["{}_parsed".format(kind)][crrt_channel]["micros"] = list_times
+            self.dict_parsed_data["{}_parsed".format(kind)][crrt_channel]["readings"] = list_readings
 
     def assemble_char_data(self):
         crrt_list_entries = self.dict_parsed_data["CHR"]
@@ -240,9 +803,21 @@ class BinaryFolderParser():
             self.dict_data["ADC_{}".format(crrt_channel)] = {}
             self.dict_data["ADC_{}".format(crrt_channel)]["micros"] = []
             self.dict_data["ADC_{}".format(crrt_channel)]["readings"] = []
+            self.dict_data["DEC_{}".format(crrt_channel)] = {}
+            self.dict_data["DEC_{}".format(crrt_channel)]["micros"] = []
+            self.dict_data["DEC_{}".format(crrt_channel)]["readings"] = []
 
         self.dict_data["CHR"] = []
 
+        # the nbr of blocks missing within the files, per (block type, channel)
+        self.dict_data["missing_blocks"] = {}
+
+        # the telemetry blocks, with the name of their file
+        self.dict_data["TEL"] = []
+
+        # the binary records, with the name of their file
+        self.dict_data["REC"] = []
+
         # find the list of files to analyze
         if list_files is not None:
             self.list_files = list_files
@@ -267,6 +842,17 @@ class BinaryFolderParser():
 
             self.dict_data["CHR"].extend(str(binary_file_parser.dict_parsed_data["CHR_parsed"])[2:-1])
 
+            for crrt_telemetry in binary_file_parser.dict_parsed_data["TEL"]:
+                crrt_telemetry["filename"] = crrt_file.name
+                self.dict_data["TEL"].append(crrt_telemetry)
+
+            for crrt_record in binary_file_parser.dict_parsed_data["REC"]:
+                crrt_record["filename"] = crrt_file.name
+                self.dict_data["REC"].append(crrt_record)
+
+            for (crrt_stream, crrt_nbr_missing) in binary_file_parser.dict_parsed_data["missing_blocks"].items():
+                self.dict_data["missing_blocks"][crrt_stream] = self.dict_data["missing_blocks"].get(crrt_stream, 0) + crrt_nbr_missing
+
             for crrt_channel in range(self.n_ADC_channels):
                 self.dict_data["ADC_{}".format(crrt_channel)]["micros"].extend(
                     binary_file_parser.dict_parsed_data["ADC_parsed"][crrt_channel]["micros"]
@@ -274,6 +860,12 @@ class BinaryFolderParser():
                 self.dict_data["ADC_{}".format(crrt_channel)]["readings"].extend(
                     binary_file_parser.dict_parsed_data["ADC_parsed"][crrt_channel]["readings"]
                 )
+                self.dict_data["DEC_{}".format(crrt_channel)]["micros"].extend(
+                    binary_file_parser.dict_parsed_data["DEC_parsed"][crrt_channel]["micros"]
+                )
+                self.dict_data["DEC_{}".format(crrt_channel)]["readings"].extend(
+                    binary_file_parser.dict_parsed_data["DEC_parsed"][crrt_channel]["readings"]
+                )
 
         self.dict_data["CHR"] = "".join(self.dict_data["CHR"])
 
@@ -462,6 +1054,26 @@ class BinaryFolderParser():
         return (self.fn_unrolled_arduino_micros_to_datetime(self.dict_data["CHR_micros_unwrapped"]),
                 self.dict_data["CHR_messages"])
 
+    def get_telemetry(self):
+        """Get the telemetry blocks, as a list of dicts (see parse_telemetry_block), each with the name of
+        its file and the micros of the start and end of its telemetry period."""
+        return self.dict_data["TEL"]
+
+    def get_records(self):
+        """Get the binary records, as a list of dicts (see parse_record_block), each with the name of its file
+        and the UTC datetime when it was logged."""
+        list_records = self.dict_data["REC"]
+
+        if len(list_records) > 0:
+            list_datetimes = self.fn_unrolled_arduino_micros_to_datetime(
+                unwrapp_list_micros([crrt_record["micros"] for crrt_record in list_records])
+            )
+
+            for (crrt_record, crrt_datetime) in zip(list_records, list_datetimes):
+                crrt_record["timestamp"] = crrt_datetime
+
+        return list_records
+
 
 class SlidingParser():
     """Perform a 'sliding parsing' of all the files in a folder. This allows to
@@ -541,6 +1153,14 @@ class SlidingParser():
         self.dict_metadata["CHR"]["time_limits_{}".format(filename)] = \
             [timestamps_CHR[idx_timestamp_start], timestamps_CHR[-2]]
 
+        # the telemetry blocks of the last file only, as the previous one was already dumped
+        dict_data["TEL"] = [crrt_telemetry for crrt_telemetry in binary_folder_parser.get_telemetry()
+                            if crrt_telemetry["filename"] == path_dump.name]
+
+        # same for the binary records
+        dict_data["REC"] = [crrt_record for crrt_record in binary_folder_parser.get_records()
+                            if crrt_record["filename"] == path_dump.name]
+
         with open(str(dump_path), "wb") as fh:
             pickle.dump(dict_data, fh)
 
@@ -560,12 +1180,19 @@ def GPRMC_extractor(dict_data):
 
 
 def temperatures_extractor(dict_data):
+    """Get the temperatures, from the 'T' records, or from the TMP messages of the files written before the
+    records. Returns a tuple (timestamps, temperatures), with a list of temperatures per timestamp."""
     list_CHR_messages = dict_data["CHR"]["messages"]
     list_CHR_timestamps = dict_data["CHR"]["timestamps"]
 
     list_temperatures_timestamps = []
     list_temperatures_readings = []
 
+    for crrt_record in dict_data.get("REC", []):
+        if crrt_record["tag"] == "T":
+            list_temperatures_timestamps.append(crrt_record["timestamp"])
+            list_temperatures_readings.append(crrt_record["temperatures"])
+
     for (crrt_timestamp, crrt_message) in zip(list_CHR_timestamps, list_CHR_messages):
         if crrt_message[0:4] == "TMP,":
             crrt_list_temperatures = []
@@ -581,12 +1208,28 @@ def temperatures_extractor(dict_data):
     return (list_temperatures_timestamps, list_temperatures_readings)
 
 def channel_stats_extractor(dict_data):
+    """Get the ADC channels statistics, as ChannelStats, from the 'S' records, or from the STAT messages of the
+    files written before the records. Returns a tuple (timestamps, stats)."""
     list_CHR_messages = dict_data["CHR"]["messages"]
     list_CHR_timestamps = dict_data["CHR"]["timestamps"]
 
     list_stats_timestamps = []
     list_stats_readings = []
 
+    for crrt_record in dict_data.get("REC", []):
+        if crrt_record["tag"] == "S" and crrt_record["nbr_samples"] > 0:
+            crrt_stat = ChannelStats(
+                channel = crrt_record["channel"],
+                mean_x = crrt_record["sum"] / crrt_record["nbr_samples"],
+                mean_x2 = crrt_record["sum_of_squares"] / crrt_record["nbr_samples"],
+                min_val = crrt_record["min"],
+                max_val = crrt_record["max"],
+                count_extrema = crrt_record["extremal_count"]
+            )
+
+            list_stats_timestamps.append(crrt_record["timestamp"])
+            list_stats_readings.append(crrt_stat)
+
     for (crrt_timestamp, crrt_message) in zip(list_CHR_timestamps, list_CHR_messages):
         if crrt_message[0:4] == "STAT":
             crrt_chnl = int(crrt_message[4:6])
@@ -606,3 +1249,240 @@ def channel_stats_extractor(dict_data):
             list_stats_readings.append(crrt_stat)
 
     return (list_stats_timestamps, list_stats_readings)
+
+
+def channel_exact_stats_extractor(dict_data):
+    """Get the ADC channels statistics, as ChannelExactStats, from the 'S' records, or from the STEX messages of
+    the files written before the records. Returns a tuple (timestamps, stats)."""
+    list_CHR_messages = dict_data["CHR"]["messages"]
+    list_CHR_timestamps = dict_data["CHR"]["timestamps"]
+
+    list_stats_timestamps = []
+    list_stats_readings = []
+
+    for crrt_record in dict_data.get("REC", []):
+        if crrt_record["tag"] == "S" and crrt_record["nbr_samples"] > 0:
+            crrt_stat = ChannelExactStats(
+                channel = crrt_record["channel"],
+                nbr_samples = crrt_record["nbr_samples"],
+                sum_x = crrt_record["sum"],
+                sum_x2 = crrt_record["sum_of_squares"],
+                max_val = crrt_record["max"],
+                min_val = crrt_record["min"],
+                count_extrema = crrt_record["extremal_count"]
+            )
+
+            list_stats_timestamps.append(crrt_record["timestamp"])
+            list_stats_readings.append(crrt_stat)
+
+    for (crrt_timestamp, crrt_message) in zip(list_CHR_timestamps, list_CHR_messages):
+        if crrt_message[0:4] == "STEX":
+            crrt_chnl = int(crrt_message[4:6])
+
+            list_fields = [int(crrt_field) for crrt_field in crrt_message[7:].split(",")]
+
+            crrt_stat = ChannelExactStats(
+                channel = crrt_chnl,
+                nbr_samples = list_fields[0],
+                sum_x = list_fields[1],
+                sum_x2 = list_fields[2],
+                max_val = list_fields[3],
+                min_val = list_fields[4],
+                count_extrema = list_fields[5]
+            )
+
+            list_stats_timestamps.append(crrt_timestamp)
+            list_stats_readings.append(crrt_stat)
+
+    return (list_stats_timestamps, list_stats_readings)
+
+
+def sonar_extractor(dict_data):
+    """Get the sonar measurements, from the 'D' records. Returns a tuple (timestamps, distances, confidences),
+    with the distances in mm and the confidences in %, for the valid measurements only."""
+    list_sonar_timestamps = []
+    list_sonar_distances = []
+    list_sonar_confidences = []
+
+    for crrt_record in dict_data.get("REC", []):
+        if crrt_record["tag"] == "D" and crrt_record["is_valid"]:
+            list_sonar_timestamps.append(crrt_record["timestamp"])
+            list_sonar_distances.append(crrt_record["distance"])
+            list_sonar_confidences.append(crrt_record["confidence"])
+
+    return (list_sonar_timestamps, list_sonar_distances, list_sonar_confidences)
+
+
+def sonar_profile_extractor(dict_data):
+    """Get the full sonar profiles, from the 'P' records. Returns a tuple (timestamps, profiles), each profile being
+    the dict of parse_sonar_profile_record, with "scan_start" and "scan_length" in mm."""
+    list_profile_timestamps = []
+    list_profiles = []
+
+    for crrt_record in dict_data.get("REC", []):
+        if crrt_record["tag"] == "P":
+            list_profile_timestamps.append(crrt_record["timestamp"])
+            list_profiles.append(crrt_record)
+
+    return (list_profile_timestamps, list_profiles)
+
+
+def adc_utc_extractor(dict_data):
+    """Get the UTC time of the ADC block sets, as stamped on board from the PPS and RMC of the GPS, from the 'U'
+    records. Returns a tuple (block_numbers, micros_starts, utc_datetimes): the block_number and micros_start of the
+    metadata of the blocks of each set, and the UTC time of micros_start, as a timezone aware datetime."""
+    list_block_numbers = []
+    list_micros_starts = []
+    list_utc_datetimes = []
+
+    for crrt_record in dict_data.get("REC", []):
+        if crrt_record["tag"] == "U":
+            list_block_numbers.append(crrt_record["block_number"])
+            list_micros_starts.append(crrt_record["micros_start"])
+            list_utc_datetimes.append(
+                datetime.datetime(1970, 1, 1, tzinfo=datetime.timezone.utc) +
+                datetime.timedelta(microseconds=crrt_record["utc_micros_start"])
+            )
+
+    return (list_block_numbers, list_micros_starts, list_utc_datetimes)
+
+
+def timebase_extractor(dict_data):
+    """Get the on board clock model, from the 'Z' records logged at each PPS edge. Returns a tuple (timestamps,
+    drifts_ppm, residuals_rms_micros), the drift being how much faster than UTC the micros clock of the Due runs."""
+    list_timebase_timestamps = []
+    list_drifts_ppm = []
+    list_residuals_rms_micros = []
+
+    for crrt_record in dict_data.get("REC", []):
+        if crrt_record["tag"] == "Z":
+            list_timebase_timestamps.append(crrt_record["timestamp"])
+            list_drifts_ppm.append(crrt_record["drift_ppb"] / 1000.0)
+            list_residuals_rms_micros.append(crrt_record["residual_rms_nanos"] / 1000.0)
+
+    return (list_timebase_timestamps, list_drifts_ppm, list_residuals_rms_micros)
+
+
+def events_extractor(dict_data):
+    """Get the events logged with event triggered logging. Returns a tuple
+    (timestamps, events), where each event is a tuple (event_filename, "start" or "end", nbr_blocks).
+    For a start, nbr_blocks is the number of pre trigger blocks; for an end, it is the total
+    number of blocks (per channel) in the event file."""
+    list_CHR_messages = dict_data["CHR"]["messages"]
+    list_CHR_timestamps = dict_data["CHR"]["timestamps"]
+
+    list_events_timestamps = []
+    list_events = []
+
+    for (crrt_timestamp, crrt_message) in zip(list_CHR_timestamps, list_CHR_messages):
+        if crrt_message[0:5] == "EVNT,":
+            list_fields = crrt_message[5:].split(",")
+
+            list_events_timestamps.append(crrt_timestamp)
+            list_events.append((list_fields[0], list_fields[1], int(list_fields[2])))
+
+    return (list_events_timestamps, list_events)
+
+
+def rates_extractor(dict_data):
+    """Get the ADC settings logged at the start of the recording and at each change of the sampling
+    frequency. Returns a tuple (timestamps, rates), where each rate is a tuple
+    (sampling_frequency, prescale, timer_rc). Each ADC file has a single sampling frequency."""
+    list_CHR_messages = dict_data["CHR"]["messages"]
+    list_CHR_timestamps = dict_data["CHR"]["timestamps"]
+
+    list_rates_timestamps = []
+    list_rates = []
+
+    for (crrt_timestamp, crrt_message) in zip(list_CHR_timestamps, list_CHR_messages):
+        if crrt_message[0:5] == "RATE,":
+            list_fields = crrt_message[5:].split(",")
+
+            list_rates_timestamps.append(crrt_timestamp)
+            list_rates.append((int(list_fields[0]), int(list_fields[1]), int(list_fields[2])))
+
+    return (list_rates_timestamps, list_rates)
+
+
+def overrun_extractor(dict_data):
+    """Get the loss accounting telemetry. Returns a tuple (timestamps, overruns), where each overrun
+    is a tuple (next_adc_block_sequence_number, nbr_dropped_samples_per_channel, nbr_conversion_overruns,
+    nbr_dropped_chars, nbr_file_structure_failures). The counts are totals since the start of the recording;
+    nbr_file_structure_failures is the nbr of file header and index blocks that could not be written. The files
+    written before the block pool have no nbr_dropped_chars, which is then 0, and count the ADC samples overwritten
+    rather than dropped, which amounts to the same; the older files have no nbr_file_structure_failures either."""
+    list_CHR_messages = dict_data["CHR"]["messages"]
+    list_CHR_timestamps = dict_data["CHR"]["timestamps"]
+
+    list_overruns_timestamps = []
+    list_overruns = []
+
+    for (crrt_timestamp, crrt_message) in zip(list_CHR_timestamps, list_CHR_messages):
+        if crrt_message[0:5] == "OVRN,":
+            list_fields = crrt_message[5:].split(",")
+
+            nbr_dropped_chars = int(list_fields[3]) if len(list_fields) > 3 else 0
+            nbr_file_structure_failures = int(list_fields[4]) if len(list_fields) > 4 else 0
+
+            list_overruns_timestamps.append(crrt_timestamp)
+            list_overruns.append((int(list_fields[0]), int(list_fields[1]), int(list_fields[2]), nbr_dropped_chars,
+                                  nbr_file_structure_failures))
+
+    return (list_overruns_timestamps, list_overruns)
+
+
+def rotations_extractor(dict_data):
+    """Get the file switch latencies. Returns a tuple (timestamps, rotations), where each rotation is a
+    tuple (latency_micros, next_file_was_ready): next_file_was_ready is 1 if the next file had been fully
+    prepared in advance, and 0 if some of the preparation had to be done during the switch."""
+    list_CHR_messages = dict_data["CHR"]["messages"]
+    list_CHR_timestamps = dict_data["CHR"]["timestamps"]
+
+    list_rotations_timestamps = []
+    list_rotations = []
+
+    for (crrt_timestamp, crrt_message) in zip(list_CHR_timestamps, list_CHR_messages):
+        if crrt_message[0:5] == "ROTN,":
+            list_fields = crrt_message[5:].split(",")
+
+            list_rotations_timestamps.append(crrt_timestamp)
+            list_rotations.append((int(list_fields[0]), int(list_fields[1])))
+
+    return (list_rotations_timestamps, list_rotations)
+
+
+def telemetry_extractor(dict_data):
+    """Get the telemetry blocks of a dump. Returns a list of dicts, see parse_telemetry_block."""
+    return dict_data.get("TEL", [])
+
+
+def merge_telemetry(list_telemetry):
+    """Put the telemetry of several periods together, for example to qualify an SD card or a buffer size over
+    a whole deployment: the histograms and counts are summed, and the worst maxima and minima are kept. The
+    loss counters, which are totals since the start of the recording, are the ones of the last period."""
+    ras(len(list_telemetry) > 0, "no telemetry to merge")
+
+    merged = {}
+    merged["nbr_periods"] = len(list_telemetry)
+    merged["nbr_blocks_in_pool"] = list_telemetry[-1]["nbr_blocks_in_pool"]
+    merged["nbr_adc_block_sets_in_queue"] = list_telemetry[-1]["nbr_adc_block_sets_in_queue"]
+
+    for crrt_key in ["nbr_blocks_written", "internal_update_total_micros"]:
+        merged[crrt_key] = sum(crrt_telemetry[crrt_key] for crrt_telemetry in list_telemetry)
+
+    for crrt_key in ["sd_write_max_micros", "internal_update_max_micros", "adc_queue_max_nbr_block_sets"]:
+        merged[crrt_key] = max(crrt_telemetry[crrt_key] for crrt_telemetry in list_telemetry)
+
+    merged["pool_min_nbr_free_blocks"] = min(crrt_telemetry["pool_min_nbr_free_blocks"] for crrt_telemetry in list_telemetry)
+
+    list_min_slack_micros = [crrt_telemetry["min_slack_micros"] for crrt_telemetry in list_telemetry
+                             if crrt_telemetry.get("min_slack_micros") is not None]
+    merged["min_slack_micros"] = min(list_min_slack_micros) if len(list_min_slack_micros) > 0 else None
+
+    for crrt_key in ["sd_write_micros_histogram", "internal_update_micros_histogram"]:
+        merged[crrt_key] = [sum(crrt_counts) for crrt_counts in zip(*[crrt_telemetry[crrt_key] for crrt_telemetry in list_telemetry])]
+
+    for crrt_key in ["adc_nbr_dropped_samples", "adc_nbr_conversion_overruns", "nbr_dropped_chars", "nbr_dropped_records"]:
+        merged[crrt_key] = list_telemetry[-1].get(crrt_key, 0)
+
+    return merged
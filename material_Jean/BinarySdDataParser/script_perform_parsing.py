@@ -9,7 +9,7 @@ import pickle
 from pprint import PrettyPrinter
 
 from BinaryParser import SlidingParser
-from BinaryParser import GPRMC_extractor, temperatures_extractor, channel_stats_extractor
+from BinaryParser import GPRMC_extractor, temperatures_extractor, channel_stats_extractor, channel_exact_stats_extractor
 
 import matplotlib.pyplot as plt
 
@@ -99,3 +99,12 @@ if len(channel_stats_timestamps) > 0:
 else:
     print("no channel stats")
 
+channel_exact_stats_timestamps, channel_exact_stats_values = channel_exact_stats_extractor(dict_data_example)
+
+if len(channel_exact_stats_timestamps) > 0:
+    print()
+    for ind in range(min(6, len(channel_exact_stats_timestamps))):
+        print("{} : {}".format(channel_exact_stats_timestamps[ind],
+                               channel_exact_stats_values[ind]))
+else:
+    print("no exact channel stats")
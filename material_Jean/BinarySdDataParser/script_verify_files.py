@@ -0,0 +1,48 @@
+"""Check the CRCs of the F*.bin files of a folder, or of the files given on the command line, as written by the
+logger (file format version 2 on), for example on the SD card after a power loss:
+> python3 script_verify_files.py ./all_example_data/basic_example_data/
+"""
+
+import sys
+
+from pathlib import Path
+
+from BinaryParser import verify_file
+
+
+def list_files_to_verify(list_args):
+    list_files = []
+
+    for crrt_arg in list_args:
+        crrt_path = Path(crrt_arg)
+        if crrt_path.is_dir():
+            list_files.extend(sorted(crrt_path.glob("F*.bin")))
+        else:
+            list_files.append(crrt_path)
+
+    return list_files
+
+
+if __name__ == "__main__":
+    nbr_files_with_errors = 0
+
+    for crrt_file in list_files_to_verify(sys.argv[1:]):
+        dict_verification = verify_file(crrt_file)
+
+        if dict_verification is None:
+            print("{}: no check blocks (no header, or written before the file format version 2)".format(crrt_file.name))
+            continue
+
+        nbr_unverified_blocks = dict_verification["nbr_blocks_in_file"] - dict_verification["nbr_verified_blocks"]
+
+        print("{}: {} blocks verified, {} bad, {} after the data, {}".format(
+            crrt_file.name, dict_verification["nbr_verified_blocks"], len(dict_verification["bad_blocks"]),
+            nbr_unverified_blocks, "closed" if dict_verification["is_closed"] else "NOT CLOSED"))
+
+        for crrt_bad_block in dict_verification["bad_blocks"]:
+            print("    bad CRC at block {}".format(crrt_bad_block))
+
+        if dict_verification["bad_blocks"]:
+            nbr_files_with_errors += 1
+
+    sys.exit(1 if nbr_files_with_errors > 0 else 0)
@@ -0,0 +1,62 @@
+#ifndef ADC_CHANNELS
+#define ADC_CHANNELS
+
+#include "Arduino.h"
+
+#include <utility>
+
+template <uint8_t... channels>
+constexpr uint8_t highest_adc_channel(){
+    uint8_t highest_channel = 0;
+    ((highest_channel = (channels > highest_channel) ? channels : highest_channel), ...);
+    return highest_channel;
+}
+
+// the set of ADC channels to log, given at compile time as a list of channel numbers (in uC reference)
+// everything the ADC setup and ISR need is derived from it at compile time, so that:
+// - the channel enable mask is a constant
+// - reading the channels in the ISR is fully unrolled, with constant register addresses
+// - the position of each channel in a PDC scan is a constant
+template <uint8_t... channels>
+struct AdcChannelSet{
+    static_assert(sizeof...(channels) > 0, "need at least one ADC channel");
+    static_assert(((channels < 16) && ...), "the SAM3X ADC has 16 channels");
+
+    static constexpr int nbr_channels = sizeof...(channels);
+
+    // the channel numbers, in the order they are logged
+    static constexpr uint8_t channel_numbers[nbr_channels] = {channels...};
+
+    // value for ADC_CHER
+    static constexpr uint32_t enable_mask = ((1ul << channels) | ...);
+
+    // the ADC converts the enabled channels by increasing channel number, whatever the order above
+    // so the highest channel number is the last one of a scan
+    static constexpr uint8_t last_converted_channel = highest_adc_channel<channels...>();
+
+    // position of the channel channel_numbers[channel_index] within a scan, as stored by the PDC
+    static constexpr size_t pdc_scan_position(size_t channel_index){
+        size_t position = 0;
+        for (size_t other_index = 0; other_index < nbr_channels; other_index++){
+            if (channel_numbers[other_index] < channel_numbers[channel_index]){
+                position += 1;
+            }
+        }
+        return position;
+    }
+
+    // call action(channel_index, channel_number) for each channel, where both arguments are std::integral_constant
+    // this is unrolled at compile time, so the action can use them as constants (register addresses, array indexes...)
+    template <typename Action>
+    static inline __attribute__((always_inline)) void for_each_channel(Action && action){
+        for_each_channel_impl(action, std::make_index_sequence<nbr_channels>{});
+    }
+
+    private:
+        template <typename Action, size_t... channel_indexes>
+        static inline __attribute__((always_inline)) void for_each_channel_impl(Action & action, std::index_sequence<channel_indexes...>){
+            (action(std::integral_constant<size_t, channel_indexes>{}, std::integral_constant<uint8_t, channels>{}), ...);
+        }
+};
+
+#endif // !ADC_CHANNELS
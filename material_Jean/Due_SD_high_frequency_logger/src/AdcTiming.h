@@ -0,0 +1,72 @@
+#ifndef ADC_TIMING
+#define ADC_TIMING
+
+#include <stdint.h>
+
+// the ADC prescaler and trigger timer settings for a given acquisition frequency
+// the ADC clock is MCK / (2 * (prescale + 1)), the trigger timer runs at MCK / 8 and fires every timer_rc ticks
+struct AdcTiming{
+    bool valid;                     // false if the frequency cannot be reached with this nbr of channels
+    uint8_t prescale;               // value for ADC_MR_PRESCAL
+    uint32_t timer_rc;              // value for TC_RC of the trigger timer
+    uint32_t adc_clock_frequency;   // the resulting ADC clock, in Hz
+    uint32_t actual_frequency_mHz;  // the acquisition frequency actually obtained, in mHz (timer_rc is rounded)
+};
+
+// the nbr of ADC clock periods budgeted for each conversion of a scan; a 12 bits conversion with the default tracking
+// time takes about 20, so this leaves a factor 2 of margin for the startup, settling and transfer
+constexpr uint32_t adc_clock_periods_per_conversion = 40;
+
+// the SAM3X ADC clock must not be above 22MHz
+constexpr uint32_t adc_max_clock_frequency = 22000000UL;
+
+// compute the slowest ADC clock (the best accuracy) that still converts the nbr_channels of a scan within one
+// acquisition period, and the timer period giving the acquisition frequency
+// this replaces the hand made table (ps 2 @100kHz, 20 @10kHz, 200 @1kHz with 5 channels) of Due_ADC_reading
+// NOTE: at low rates, the prescaler saturates at 255 and the ADC clock goes below the 1MHz of the datasheet; this is
+// what was done so far, and works in practice
+// this is constexpr, so that the default settings can be checked at compile time
+constexpr AdcTiming compute_adc_timing(uint32_t master_clock_frequency, uint32_t acquisition_frequency, int nbr_channels){
+    AdcTiming timing {false, 0, 0, 0, 0};
+
+    if ((acquisition_frequency == 0) || (nbr_channels <= 0)){
+        return timing;
+    }
+
+    // the trigger timer, clocked at MCK / 8; the 32 bits RC register is never the limit, but it needs a few ticks
+    uint32_t const timer_clock_frequency = master_clock_frequency / 8;
+    uint32_t const timer_rc = (timer_clock_frequency + acquisition_frequency / 2) / acquisition_frequency;
+
+    if (timer_rc < 2){
+        return timing;
+    }
+
+    // a whole scan must fit in one actual acquisition period, i.e. timer_rc timer ticks of 8 MCK periods each, while
+    // a scan takes nbr_channels * adc_clock_periods_per_conversion ADC clocks of 2 * (prescale + 1) MCK periods each
+    // so the largest prescale is given by: 2 * (prescale + 1) * nbr_channels * adc_clock_periods_per_conversion <= 8 * timer_rc
+    uint64_t const nbr_adc_clock_periods_per_scan = static_cast<uint64_t>(nbr_channels) * adc_clock_periods_per_conversion;
+    uint64_t prescale_plus_one = (8 * static_cast<uint64_t>(timer_rc)) / (2 * nbr_adc_clock_periods_per_scan);
+
+    // within the 8 bits register
+    if (prescale_plus_one > 256){
+        prescale_plus_one = 256;
+    }
+
+    // and the ADC clock must stay below its maximum
+    uint64_t const min_prescale_plus_one = (master_clock_frequency + 2 * static_cast<uint64_t>(adc_max_clock_frequency) - 1)
+                                           / (2 * static_cast<uint64_t>(adc_max_clock_frequency));
+
+    if (prescale_plus_one < min_prescale_plus_one){
+        return timing;
+    }
+
+    timing.valid = true;
+    timing.prescale = static_cast<uint8_t>(prescale_plus_one - 1);
+    timing.timer_rc = timer_rc;
+    timing.adc_clock_frequency = static_cast<uint32_t>(master_clock_frequency / (2 * prescale_plus_one));
+    timing.actual_frequency_mHz = static_cast<uint32_t>(static_cast<uint64_t>(timer_clock_frequency) * 1000 / timer_rc);
+
+    return timing;
+}
+
+#endif // !ADC_TIMING
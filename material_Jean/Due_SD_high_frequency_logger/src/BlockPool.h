@@ -0,0 +1,182 @@
+#ifndef BLOCK_POOL
+#define BLOCK_POOL
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+// a pool of fixed size blocks, shared by all the producers of blocks, in the ISR as well as in the main loop
+// inspired from: LowLatencyLogger_Joey_v5, recordBinFile (emptyStack / fullQueue)
+//
+// the free blocks are kept on a lock-free stack (compare and swap on the head, which is LDREX / STREX on the
+// Cortex-M3), so that take and give_back can be called from the ISR and from the main loop, and interrupt each other
+// the head carries a tag, changed at each update, so that a take interrupted between reading the head and swapping it
+// cannot be fooled by the same block being taken and given back in the meantime (ABA)
+template <typename Block, size_t nbr_blocks>
+class BlockPool{
+    static_assert(nbr_blocks > 0 && nbr_blocks < 0xFFFF, "the block indexes are 16 bits, 0xFFFF meaning none");
+
+    public:
+        BlockPool(){
+            reset();
+        }
+
+        // put all the blocks back on the free stack; nothing may be using the pool
+        void reset(){
+            for (size_t i = 0; i < nbr_blocks; i++){
+                next_free[i].store(static_cast<uint16_t>((i + 1 < nbr_blocks) ? (i + 1) : no_block), std::memory_order_relaxed);
+            }
+            nbr_free.store(static_cast<int>(nbr_blocks), std::memory_order_relaxed);
+            min_nbr_free = static_cast<int>(nbr_blocks);
+            head.store(make_head(0, 0), std::memory_order_release);
+        }
+
+        // take a free block, or nullptr if none is left
+        Block * take(){
+            uint32_t crrt_head = head.load(std::memory_order_acquire);
+
+            while (true){
+                uint16_t const index = head_index(crrt_head);
+
+                if (index == no_block){
+                    return nullptr;
+                }
+
+                uint32_t const new_head = make_head(next_free[index].load(std::memory_order_relaxed), head_tag(crrt_head) + 1);
+
+                if (head.compare_exchange_weak(crrt_head, new_head, std::memory_order_acq_rel, std::memory_order_acquire)){
+                    int const nbr_free_now = nbr_free.fetch_sub(1, std::memory_order_relaxed) - 1;
+                    if (nbr_free_now < min_nbr_free){
+                        min_nbr_free = nbr_free_now;
+                    }
+                    return &blocks[index];
+                }
+            }
+        }
+
+        // give back a block obtained from take
+        void give_back(Block * block){
+            uint16_t const index = static_cast<uint16_t>(block - blocks);
+            uint32_t crrt_head = head.load(std::memory_order_acquire);
+
+            while (true){
+                next_free[index].store(head_index(crrt_head), std::memory_order_relaxed);
+                uint32_t const new_head = make_head(index, head_tag(crrt_head) + 1);
+
+                if (head.compare_exchange_weak(crrt_head, new_head, std::memory_order_acq_rel, std::memory_order_acquire)){
+                    nbr_free.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+            }
+        }
+
+        // the nbr of free blocks now, and the lowest it has been since the last reset_min_nbr_free
+        int get_nbr_free() const{
+            return nbr_free.load(std::memory_order_relaxed);
+        }
+
+        int get_min_nbr_free() const{
+            return min_nbr_free;
+        }
+
+        void reset_min_nbr_free(){
+            min_nbr_free = get_nbr_free();
+        }
+
+        static constexpr size_t get_nbr_blocks(){
+            return nbr_blocks;
+        }
+
+    private:
+        static constexpr uint16_t no_block = 0xFFFF;
+
+        static constexpr uint32_t make_head(uint16_t index, uint32_t tag){
+            return (tag << 16) | index;
+        }
+
+        static constexpr uint16_t head_index(uint32_t head_value){
+            return static_cast<uint16_t>(head_value & 0xFFFF);
+        }
+
+        static constexpr uint32_t head_tag(uint32_t head_value){
+            return head_value >> 16;
+        }
+
+        Block blocks[nbr_blocks];
+        std::atomic<uint16_t> next_free[nbr_blocks];
+        std::atomic<uint32_t> head;
+        std::atomic<int> nbr_free;
+
+        // only a statistic: a lost update between the ISR and the main loop does not matter
+        volatile int min_nbr_free;
+};
+
+// a lock-free queue with a single producer and a single consumer, e.g. the ADC ISR handing full blocks to the main
+// loop; holds up to capacity items
+template <typename Item, size_t capacity>
+class SpscQueue{
+    public:
+        // false if the queue is full
+        bool push(Item const & item){
+            size_t const crrt_tail = tail.load(std::memory_order_relaxed);
+            size_t const next_tail = (crrt_tail + 1) % nbr_slots;
+
+            if (next_tail == head.load(std::memory_order_acquire)){
+                return false;
+            }
+
+            items[crrt_tail] = item;
+            tail.store(next_tail, std::memory_order_release);
+
+            size_t const crrt_size = (next_tail + nbr_slots - head.load(std::memory_order_relaxed)) % nbr_slots;
+            if (crrt_size > max_size){
+                max_size = crrt_size;
+            }
+
+            return true;
+        }
+
+        // false if the queue is empty
+        bool pop(Item & item){
+            size_t const crrt_head = head.load(std::memory_order_relaxed);
+
+            if (crrt_head == tail.load(std::memory_order_acquire)){
+                return false;
+            }
+
+            item = items[crrt_head];
+            head.store((crrt_head + 1) % nbr_slots, std::memory_order_release);
+
+            return true;
+        }
+
+        bool is_empty() const{
+            return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+        }
+
+        size_t size() const{
+            return (tail.load(std::memory_order_acquire) + nbr_slots - head.load(std::memory_order_acquire)) % nbr_slots;
+        }
+
+        // the largest size seen by the producer, since the last reset_max_size
+        size_t get_max_size() const{
+            return max_size;
+        }
+
+        void reset_max_size(){
+            max_size = size();
+        }
+
+    private:
+        // one slot stays empty, to tell full from empty
+        static constexpr size_t nbr_slots = capacity + 1;
+
+        Item items[nbr_slots];
+        std::atomic<size_t> head {0};
+        std::atomic<size_t> tail {0};
+
+        // only a statistic
+        volatile size_t max_size = 0;
+};
+
+#endif // !BLOCK_POOL
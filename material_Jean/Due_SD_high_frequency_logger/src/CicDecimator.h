@@ -0,0 +1,105 @@
+#ifndef CIC_DECIMATOR
+#define CIC_DECIMATOR
+
+#include <stdint.h>
+#include <stddef.h>
+
+// compile time log2, rounded up
+constexpr int ceil_log2(uint64_t value){
+    int result = 0;
+    while ((1ull << result) < value){
+        result += 1;
+    }
+    return result;
+}
+
+constexpr uint64_t integer_power(uint64_t base, int exponent){
+    uint64_t result = 1;
+    for (int i = 0; i < exponent; i++){
+        result *= base;
+    }
+    return result;
+}
+
+// a CIC (cascaded integrator comb) decimator, for one channel
+// - order integrators running at the input rate, order combs (differential delay 1) running at the output rate
+// - the input is input_bits values (12 bits for raw ADC values), the output is 16 bits: the DC gain
+//   decimation_ratio**order is rescaled to 2**(16 - input_bits), so that the extra resolution gained by averaging
+//   is kept in the low bits
+// - all the arithmetic is modulo 2**32 on uint32_t, which is what makes a CIC work without overflow handling,
+//   as long as the register growth fits in 32 bits (checked at compile time)
+// the frequency response is H(f) = [sin(pi f R / fs) / (R sin(pi f / fs))]**order, with fs the input rate
+// and R the decimation ratio: the first nulls are on the multiples of the output rate, i.e. exactly where the
+// frequencies that would alias onto DC are
+template <int order, int decimation_ratio, int input_bits = 12>
+class CicDecimator{
+    public:
+        static_assert(order >= 1, "need at least one stage");
+        static_assert((input_bits >= 1) && (input_bits <= 16), "the output is 16 bits");
+        static_assert(decimation_ratio >= 1, "decimation ratio must be positive");
+
+        static constexpr int nbr_input_bits = input_bits;
+        static constexpr int nbr_output_bits = 16;
+        static_assert(nbr_input_bits + order * ceil_log2(decimation_ratio) <= 32, "CIC register growth does not fit 32 bits");
+
+        // DC gain of the filter
+        static constexpr uint64_t gain = integer_power(decimation_ratio, order);
+
+        // the output is comb_output * 2**(nbr_output_bits - nbr_input_bits) / gain,
+        // done as a 32 x 32 -> 64 bits multiplication by a Q32 constant rather than a division
+        static constexpr uint64_t output_scale_q32 = ((1ull << (32 + nbr_output_bits - nbr_input_bits)) + gain / 2) / gain;
+
+        void reset(void){
+            for (int stage = 0; stage < order; stage++){
+                integrators[stage] = 0;
+                comb_delays[stage] = 0;
+            }
+            crrt_phase = 0;
+        }
+
+        // eat nbr_inputs input_bits values, read every input_stride entries from input (to work directly on interleaved
+        // PDC scans), and write the decimated 16 bits values to output; return how many were written
+        // the phase is kept between calls, so the inputs can come in chunks of any length
+        template <typename Input, typename Output>
+        size_t process(Input const * input, size_t input_stride, size_t nbr_inputs, Output * output){
+            size_t nbr_outputs = 0;
+
+            for (size_t crrt_input = 0; crrt_input < nbr_inputs; crrt_input++){
+                uint32_t crrt_value = static_cast<uint32_t>(input[crrt_input * input_stride]);
+
+                for (int stage = 0; stage < order; stage++){
+                    integrators[stage] += crrt_value;
+                    crrt_value = integrators[stage];
+                }
+
+                crrt_phase += 1;
+
+                if (crrt_phase == decimation_ratio){
+                    crrt_phase = 0;
+
+                    for (int stage = 0; stage < order; stage++){
+                        uint32_t comb_output = crrt_value - comb_delays[stage];
+                        comb_delays[stage] = crrt_value;
+                        crrt_value = comb_output;
+                    }
+
+                    uint32_t scaled_value = static_cast<uint32_t>((static_cast<uint64_t>(crrt_value) * output_scale_q32 + (1ull << 31)) >> 32);
+                    if (scaled_value > 0xFFFF){
+                        scaled_value = 0xFFFF;
+                    }
+
+                    output[nbr_outputs] = static_cast<uint16_t>(scaled_value);
+                    nbr_outputs += 1;
+                }
+            }
+
+            return nbr_outputs;
+        }
+
+    private:
+        uint32_t integrators[order] {};
+        uint32_t comb_delays[order] {};
+        int crrt_phase {0};
+};
+
+#endif // !CIC_DECIMATOR
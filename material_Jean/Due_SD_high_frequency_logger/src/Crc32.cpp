@@ -0,0 +1,34 @@
+#include "Crc32.h"
+
+struct Crc32Table{
+    uint32_t values[256];
+};
+
+static constexpr Crc32Table make_crc32_table(){
+    Crc32Table table {};
+
+    for (uint32_t crrt_byte = 0; crrt_byte < 256; crrt_byte++){
+        uint32_t value = crrt_byte;
+        for (int crrt_bit = 0; crrt_bit < 8; crrt_bit++){
+            value = (value & 1) ? (value >> 1) ^ 0xEDB88320UL : (value >> 1);
+        }
+        table.values[crrt_byte] = value;
+    }
+
+    return table;
+}
+
+static constexpr Crc32Table crc32_table = make_crc32_table();
+
+static_assert(crc32_table.values[1] == 0x77073096UL);
+
+uint32_t crc32(void const * data, size_t nbr_bytes, uint32_t previous_crc){
+    uint8_t const * crrt_byte = static_cast<uint8_t const *>(data);
+    uint32_t crc = ~previous_crc;
+
+    for (size_t i = 0; i < nbr_bytes; i++){
+        crc = crc32_table.values[(crc ^ crrt_byte[i]) & 0xFF] ^ (crc >> 8);
+    }
+
+    return ~crc;
+}
@@ -0,0 +1,12 @@
+#ifndef CRC_32
+#define CRC_32
+
+#include <stdint.h>
+#include <stddef.h>
+
+// the usual CRC32 (polynomial 0x04C11DB7, reflected, as in zlib, Ethernet, etc), so that the host can check the blocks
+// with zlib.crc32; table driven, one byte at a time, the 1 KB table being in flash
+// a long message can be checked in parts: crc32(part_2, n_2, crc32(part_1, n_1)) == crc32(part_1 + part_2)
+uint32_t crc32(void const * data, size_t nbr_bytes, uint32_t previous_crc = 0);
+
+#endif // !CRC_32
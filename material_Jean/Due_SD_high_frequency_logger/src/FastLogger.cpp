@@ -3,29 +3,110 @@
 ////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////
 
-volatile bool blocks_to_write[nbr_blocks_per_adc_channel] = {false};
-
-volatile int crrt_adc_block_index_to_write = 0;
 volatile int crrt_adc_data_index_to_write = 0;
 
-volatile BlockADCWithMetadata blocks_adc_with_metdata[nbr_of_adc_channels][nbr_blocks_per_adc_channel];
+BlockPool<PoolBlock, nbr_blocks_in_pool> block_pool;
+SpscQueue<AdcBlockSet, nbr_adc_block_sets_in_pool> adc_full_queue;
+
+// the block set the ISR is filling, if it could take one at the start of the block period
+AdcBlockSet adc_crrt_block_set;
+volatile bool adc_crrt_block_set_is_taken = false;
+
+volatile uint16_t adc_block_sequence_number = 0;
+volatile uint32_t adc_nbr_dropped_samples = 0;
+volatile uint32_t adc_nbr_conversion_overruns = 0;
+
+volatile uint16_t adc_pdc_buffers[nbr_adc_pdc_buffers][nbr_adc_pdc_values_per_buffer];
+
+// where the decimators output while there is no block set to fill, so that they keep their state
+uint16_t adc_dropped_values[nbr_adc_values_per_pdc_buffer];
+
+// the PDC buffer currently being filled by the PDC, i.e. the one in ADC_RPR
+volatile int crrt_adc_pdc_buffer_index = 0;
+
+AdcDecimator adc_decimators[nbr_of_adc_channels];
+
+int adc_crrt_sampling_frequency = adc_sampling_frequency;
+AdcTiming adc_crrt_timing = compute_adc_timing(F_CPU, adc_acquisition_frequency, nbr_of_adc_channels);
+unsigned long adc_block_span_micros = (nbr_adc_measurements_per_block - 1) * 1000000UL / adc_sampling_frequency;
 
 TimeSeriesAnalyzer analyzers_adc_channels[nbr_of_adc_channels];
-char timeseries_buffer_stats_dump[256];
+StaLtaDetector detectors_adc_channels[nbr_of_adc_channels];
 
 void setup_adc_buffer_metadata()
 {
-    for (size_t crrt_adc_channel_index = 0; crrt_adc_channel_index < nbr_of_adc_channels; crrt_adc_channel_index++)
+    // start again with a new block period; the ADC must be stopped, and the block set it was filling is dropped
+    crrt_adc_data_index_to_write = 0;
+
+    if (adc_crrt_block_set_is_taken){
+        give_back_adc_block_set(adc_crrt_block_set);
+        adc_crrt_block_set_is_taken = false;
+    }
+}
+
+bool take_adc_block_set(AdcBlockSet & block_set)
+{
+    for (size_t crrt_adc_channel = 0; crrt_adc_channel < nbr_of_adc_channels; crrt_adc_channel++)
     {
-        unsigned long int crrt_micros = micros();
-        blocks_adc_with_metdata[crrt_adc_channel_index][0].metadata.micros_start = crrt_micros;
+        PoolBlock * crrt_block = block_pool.take();
 
-        for (size_t crrt_adc_block_index = 0; crrt_adc_block_index < nbr_blocks_per_adc_channel; crrt_adc_block_index++)
-        {
-            blocks_adc_with_metdata[crrt_adc_channel_index][crrt_adc_block_index].metadata.metadata_id = static_cast<uint16_t>('A');
-            blocks_adc_with_metdata[crrt_adc_channel_index][crrt_adc_block_index].metadata.block_number = static_cast<uint16_t>(crrt_adc_channel_index);
+        if (crrt_block == nullptr){
+            for (size_t crrt_taken_channel = 0; crrt_taken_channel < crrt_adc_channel; crrt_taken_channel++){
+                block_pool.give_back(reinterpret_cast<PoolBlock *>(block_set.blocks[crrt_taken_channel]));
+            }
+            return false;
         }
+
+        block_set.blocks[crrt_adc_channel] = &crrt_block->adc;
+        block_set.blocks[crrt_adc_channel]->metadata.metadata_id = make_metadata_id('A', crrt_adc_channel);
+    }
+
+    return true;
+}
+
+void give_back_adc_block_set(AdcBlockSet const & block_set)
+{
+    for (size_t crrt_adc_channel = 0; crrt_adc_channel < nbr_of_adc_channels; crrt_adc_channel++)
+    {
+        block_pool.give_back(reinterpret_cast<PoolBlock *>(block_set.blocks[crrt_adc_channel]));
+    }
+}
+
+bool adc_blocks_are_pending(){
+    return !adc_full_queue.is_empty();
+}
+
+int nbr_adc_blocks_for_seconds(float nbr_seconds)
+{
+    return static_cast<int>(nbr_seconds * adc_crrt_sampling_frequency / nbr_adc_measurements_per_block + 0.999f);
+}
+
+bool adc_set_sampling_frequency(int sampling_frequency)
+{
+    if (sampling_frequency <= 0){
+        return false;
+    }
+
+    AdcTiming const timing = compute_adc_timing(F_CPU, static_cast<uint32_t>(sampling_frequency) * adc_oversampling_ratio, nbr_of_adc_channels);
+
+    if (!timing.valid){
+        return false;
     }
+
+    adc_crrt_sampling_frequency = sampling_frequency;
+    adc_crrt_timing = timing;
+    adc_block_span_micros = static_cast<unsigned long>(static_cast<uint64_t>(nbr_adc_measurements_per_block - 1) * 1000000UL / sampling_frequency);
+
+    return true;
+}
+
+void adc_stop()
+{
+    TC0->TC_CHANNEL[2].TC_CCR = TC_CCR_CLKDIS;              // no more conversion triggers
+    NVIC_DisableIRQ(ADC_IRQn);
+    ADC->ADC_IDR = ~(0ul);
+    ADC->ADC_PTCR = ADC_PTCR_RXTDIS | ADC_PTCR_TXTDIS;     // Disable PDC DMA
+    NVIC_ClearPendingIRQ(ADC_IRQn);
 }
 
 void adc_setup()
@@ -34,20 +115,38 @@ void adc_setup()
     PMC->PMC_PCER1 |= PMC_PCER1_PID37;      // ADC power on
     ADC->ADC_CR = ADC_CR_SWRST;             // Reset ADC
     ADC->ADC_MR |= ADC_MR_TRGEN_EN |        // Hardware trigger select
-                   ADC_MR_PRESCAL(adc_prescale) |    // the pre-scaler: as high as possible for better accuracy, while still fast enough to measure everything
+                   ADC_MR_PRESCAL(adc_crrt_timing.prescale) |    // the pre-scaler: as high as possible for better accuracy, while still fast enough to measure everything
                                             // see: https://arduino.stackexchange.com/questions/12723/how-to-slow-adc-clock-speed-to-1mhz-on-arduino-due
                                             // unclear, asked: https://stackoverflow.com/questions/64243073/setting-right-adc-prescaler-on-the-arduino-due-in-timer-and-interrupt-driven-mul
-                                            // see the Due_ADC_reading sketch for more details, CCL was use ps 2 at 100kHz with 5 channels,  20 at 10kHz, 200 at 1kHz
+                                            // computed from the frequency and nbr of channels, see AdcTiming.h
                    ADC_MR_TRGSEL_ADC_TRIG3; // Trigger by TIOA2 Rising edge
 
     ADC->ADC_IDR = ~(0ul);
     ADC->ADC_CHDR = ~(0ul);
-    for (int i = 0; i < nbr_of_adc_channels; i++)
-    {
-        ADC->ADC_CHER |= ADC_CHER_CH0 << adc_channels[i];
+    ADC->ADC_CHER = AdcChannels::enable_mask;
+
+    if constexpr (adc_use_pdc){
+        // the PDC fills the current buffer, and the next one is already chained
+        crrt_adc_pdc_buffer_index = 0;
+        crrt_adc_data_index_to_write = 0;
+
+        for (auto & crrt_decimator : adc_decimators){
+            crrt_decimator.reset();
+        }
+
+        ADC->ADC_RPR = reinterpret_cast<uintptr_t>(adc_pdc_buffers[0]);
+        ADC->ADC_RCR = nbr_adc_pdc_values_per_buffer;
+        ADC->ADC_RNPR = reinterpret_cast<uintptr_t>(adc_pdc_buffers[1]);
+        ADC->ADC_RNCR = nbr_adc_pdc_values_per_buffer;
+
+        ADC->ADC_IER = ADC_IER_ENDRX;                       // interrupt when the current PDC buffer is full
+        ADC->ADC_PTCR = ADC_PTCR_RXTEN | ADC_PTCR_TXTDIS;   // Enable PDC DMA receive
     }
-    ADC->ADC_IER |= ADC_IER_EOC0 << adc_channels[nbr_of_adc_channels - 1];
-    ADC->ADC_PTCR |= ADC_PTCR_RXTDIS | ADC_PTCR_TXTDIS; // Disable PDC DMA
+    else{
+        ADC->ADC_IER |= ADC_IER_EOC0 << AdcChannels::last_converted_channel;  // the whole scan is available
+        ADC->ADC_PTCR |= ADC_PTCR_RXTDIS | ADC_PTCR_TXTDIS; // Disable PDC DMA
+    }
+
     NVIC_EnableIRQ(ADC_IRQn);                           // Enable ADC interrupt
 }
 
@@ -60,137 +159,207 @@ void tc_setup()
                                 | TC_CMR_ACPA_CLEAR        // Clear TIOA2 on RA compare match
                                 | TC_CMR_ACPC_SET;         // Set TIOA2 on RC compare match
 
-    constexpr int ticks_per_sample = F_CPU / 8 / adc_sampling_frequency; // F_CPU / 8 is the timer clock frequency, see MCK/8 setup
-    constexpr int ticks_duty_cycle = ticks_per_sample / 2;               // duty rate up vs down ticks over timer cycle; use 50%
+    uint32_t const ticks_per_sample = adc_crrt_timing.timer_rc;        // F_CPU / 8 is the timer clock frequency, see MCK/8 setup
+    uint32_t const ticks_duty_cycle = ticks_per_sample / 2;            // duty rate up vs down ticks over timer cycle; use 50%
     TC0->TC_CHANNEL[2].TC_RC = ticks_per_sample;
     TC0->TC_CHANNEL[2].TC_RA = ticks_duty_cycle;
 
     TC0->TC_CHANNEL[2].TC_CCR = TC_CCR_SWTRG | TC_CCR_CLKEN; // Software trigger TC2 counter and enable
 }
 
-void ADC_Handler()
+// the block period is over: number the block set, and hand it to the main loop; if there was no free block set to
+// fill, its samples are lost, and counted as such
+void adc_block_completed()
 {
+    uint16_t const sequence_number = adc_block_sequence_number;
+    adc_block_sequence_number = sequence_number + 1;
+
+    if (!adc_crrt_block_set_is_taken){
+        adc_nbr_dropped_samples += nbr_adc_measurements_per_block;
+        return;
+    }
+
+    adc_crrt_block_set_is_taken = false;
+
     for (size_t crrt_adc_channel = 0; crrt_adc_channel < nbr_of_adc_channels; crrt_adc_channel++)
     {
-        uint16_t crrt_value = static_cast<volatile uint16_t>(*(ADC->ADC_CDR + adc_channels[crrt_adc_channel]) & 0x0FFFF);
-        analyzers_adc_channels[crrt_adc_channel].register_value(static_cast<int>(crrt_value));
-        blocks_adc_with_metdata[crrt_adc_channel][crrt_adc_block_index_to_write].data[crrt_adc_data_index_to_write] = crrt_value;
+        adc_crrt_block_set.blocks[crrt_adc_channel]->metadata.block_number = sequence_number;
+    }
+
+    // the queue is as long as the pool, so this is only a safety
+    if (!adc_full_queue.push(adc_crrt_block_set)){
+        give_back_adc_block_set(adc_crrt_block_set);
+        adc_nbr_dropped_samples += nbr_adc_measurements_per_block;
+    }
+}
+
+// one scan is available in the ADC channel data registers
+void adc_scan_handler()
+{
+    // reading ADC_OVER clears it; a channel flag is set if a conversion of this channel was never read
+    if (ADC->ADC_OVER & AdcChannels::enable_mask){
+        adc_nbr_conversion_overruns += 1;
+    }
+
+    int const data_index = crrt_adc_data_index_to_write;
+
+    if (data_index == 0){
+        adc_crrt_block_set_is_taken = take_adc_block_set(adc_crrt_block_set);
     }
 
-    if (crrt_adc_data_index_to_write == 0){
+    bool const block_set_is_taken = adc_crrt_block_set_is_taken;
+
+    // unrolled at compile time: one constant address load and one store per channel
+    // the data registers are read even when the samples are dropped, to clear the end of conversion flags
+    AdcChannels::for_each_channel([block_set_is_taken, data_index](auto channel_index, auto channel_number){
+        uint16_t const crrt_value = static_cast<uint16_t>(ADC->ADC_CDR[channel_number] & 0x0FFFF);
+
+        if (block_set_is_taken){
+            adc_crrt_block_set.blocks[channel_index]->data[data_index] = crrt_value;
+        }
+    });
+
+    if ((data_index == 0) && block_set_is_taken){
         unsigned long crrt_micros = micros();
 
         for (size_t crrt_adc_channel = 0; crrt_adc_channel < nbr_of_adc_channels; crrt_adc_channel++)
         {
-            blocks_adc_with_metdata[crrt_adc_channel][crrt_adc_block_index_to_write].metadata.micros_start = crrt_micros;
+            adc_crrt_block_set.blocks[crrt_adc_channel]->metadata.micros_start = crrt_micros;
         }
     }
 
-    crrt_adc_data_index_to_write += 1;
+    crrt_adc_data_index_to_write = data_index + 1;
 
     if (crrt_adc_data_index_to_write == nbr_adc_measurements_per_block)
     {
         crrt_adc_data_index_to_write = 0;
-        blocks_to_write[crrt_adc_block_index_to_write] = true;
 
-        unsigned long crrt_micros = micros();
+        if (block_set_is_taken){
+            unsigned long crrt_micros = micros();
 
-        for (size_t crrt_adc_channel = 0; crrt_adc_channel < nbr_of_adc_channels; crrt_adc_channel++)
-        {
-            blocks_adc_with_metdata[crrt_adc_channel][crrt_adc_block_index_to_write].metadata.micros_end = crrt_micros;
+            for (size_t crrt_adc_channel = 0; crrt_adc_channel < nbr_of_adc_channels; crrt_adc_channel++)
+            {
+                adc_crrt_block_set.blocks[crrt_adc_channel]->metadata.micros_end = crrt_micros;
+            }
         }
 
-        crrt_adc_block_index_to_write = (crrt_adc_block_index_to_write + 1) % nbr_blocks_per_adc_channel;
+        adc_block_completed();
     }
 }
 
-////////////////////////////////////////////////////////////
-////////////////////////////////////////////////////////////
-
-// the statistics class
+// one PDC buffer is full, i.e. a full block of scans is available
+void adc_pdc_block_handler()
+{
+    // ENDRX stays up until ADC_RNCR is written, check it to not get confused by any other source
+    // reading ADC_ISR clears GOVRE, which is set if a conversion was overwritten before the PDC could move it, i.e.
+    // if the PDC ran out of buffers because this handler came too late
+    uint32_t const adc_status = ADC->ADC_ISR;
 
-void TimeSeriesAnalyzer::init(void){
-    flag_stats_available = false;
-    crrt_nbr_registered_values = 0;
-    reset_filling_stats();
-}
+    if (adc_status & ADC_ISR_GOVRE){
+        adc_nbr_conversion_overruns += 1;
+    }
 
-bool TimeSeriesAnalyzer::stats_are_available(void) const{
-    return flag_stats_available;
-}
+    if ((adc_status & ADC_ISR_ENDRX) == 0){
+        return;
+    }
 
-TimeSeriesStatistics const & TimeSeriesAnalyzer::get_stats(void){
-    flag_stats_available = false;
-    return available_stats;
-}
+    unsigned long crrt_micros = micros();
 
-void TimeSeriesAnalyzer::register_value(int value_in){
-    crrt_nbr_registered_values += 1;
+    // the PDC has already moved on to the buffer that was in ADC_RNPR; chain the one after it
+    // writing ADC_RNCR also clears the ENDRX flag
+    int full_pdc_buffer_index = crrt_adc_pdc_buffer_index;
+    crrt_adc_pdc_buffer_index = (full_pdc_buffer_index + 1) % nbr_adc_pdc_buffers;
+    int next_pdc_buffer_index = (full_pdc_buffer_index + 2) % nbr_adc_pdc_buffers;
 
-    double value_in_dbl = static_cast<double>(value_in - middle_adc_value);
+    ADC->ADC_RNPR = reinterpret_cast<uintptr_t>(adc_pdc_buffers[next_pdc_buffer_index]);
+    ADC->ADC_RNCR = nbr_adc_pdc_values_per_buffer;
 
-    // update the current working structure
-    crrt_filling_stats.mean += value_in_dbl / static_cast<double>(nbr_of_samples_per_analysis);
-    crrt_filling_stats.mean_of_square += value_in_dbl * value_in_dbl / static_cast<double>(nbr_of_samples_per_analysis);
-    crrt_filling_stats.max = max(value_in_dbl, crrt_filling_stats.max);
-    crrt_filling_stats.min = min(value_in_dbl, crrt_filling_stats.min);
+    int const data_index = crrt_adc_data_index_to_write;
 
-    if ( (value_in_dbl > threshold_high) || (value_in_dbl < threshold_low) ){
-        crrt_filling_stats.extremal_count += 1;
+    if (data_index == 0){
+        adc_crrt_block_set_is_taken = take_adc_block_set(adc_crrt_block_set);
     }
 
-    // what to do if finished with the current working structure
-    if (crrt_nbr_registered_values >= nbr_of_samples_per_analysis){
-        // copy the crrt struct to the output one
-        available_stats.mean = crrt_filling_stats.mean;
-        available_stats.mean_of_square = crrt_filling_stats.mean_of_square;
-        available_stats.max = crrt_filling_stats.max;
-        available_stats.min = crrt_filling_stats.min;
-        available_stats.extremal_count = crrt_filling_stats.extremal_count;
+    // de-interleave the scans into the per channel blocks, keeping the on-disk layout unchanged
+    // the channel loop is unrolled at compile time, so the position within the scan is a constant for each channel
+    // when oversampling, the scans go through the decimators, and only fill part of the block; the decimators run
+    // even when the samples are dropped, so that the samples after the gap are right
+    volatile uint16_t const * full_pdc_buffer = adc_pdc_buffers[full_pdc_buffer_index];
+    bool const block_set_is_taken = adc_crrt_block_set_is_taken;
+    bool const block_is_full = (data_index + nbr_adc_values_per_pdc_buffer == nbr_adc_measurements_per_block);
+
+    AdcChannels::for_each_channel([full_pdc_buffer, block_set_is_taken, data_index, block_is_full, crrt_micros](auto channel_index, auto){
+        constexpr size_t pdc_position = AdcChannels::pdc_scan_position(channel_index);
+
+        if constexpr (adc_oversampling_ratio > 1){
+            uint16_t * const output = block_set_is_taken ? &adc_crrt_block_set.blocks[channel_index]->data[data_index] : adc_dropped_values;
+            adc_decimators[channel_index].process(&full_pdc_buffer[pdc_position], nbr_of_adc_channels, nbr_adc_measurements_per_block, output);
+        }
+        else if (block_set_is_taken){
+            BlockADCWithMetadata & crrt_block = *adc_crrt_block_set.blocks[channel_index];
+
+            for (size_t crrt_scan = 0; crrt_scan < nbr_adc_measurements_per_block; crrt_scan++)
+            {
+                crrt_block.data[crrt_scan] = full_pdc_buffer[crrt_scan * nbr_of_adc_channels + pdc_position] & 0x0FFF;
+            }
+        }
 
-        // reset all crrt analysis values
-        reset_filling_stats();
-        crrt_nbr_registered_values = 0;
+        // the interrupt comes right after the last scan of the block
+        if (block_is_full && block_set_is_taken){
+            adc_crrt_block_set.blocks[channel_index]->metadata.micros_start = crrt_micros - adc_block_span_micros;
+            adc_crrt_block_set.blocks[channel_index]->metadata.micros_end = crrt_micros;
+        }
+    });
 
-        // stats are available now
-        flag_stats_available = true;
+    if (!block_is_full){
+        crrt_adc_data_index_to_write = data_index + nbr_adc_values_per_pdc_buffer;
+        return;
     }
-}
 
-void TimeSeriesAnalyzer::reset_filling_stats(void){
-    crrt_filling_stats.mean = 0;
-    crrt_filling_stats.mean_of_square = 0;
-    crrt_filling_stats.max = -999999.0;
-    crrt_filling_stats.min = 999999.0;
-    crrt_filling_stats.extremal_count = 0;
+    crrt_adc_data_index_to_write = 0;
+    adc_block_completed();
 }
 
-void append_buffer(char * main_buffer, char * to_add_buffer, int & pos_in_main_buffer){
-    strcpy(&main_buffer[pos_in_main_buffer], to_add_buffer);
-    pos_in_main_buffer += strlen(to_add_buffer);
+void ADC_Handler()
+{
+    if constexpr (adc_use_pdc){
+        adc_pdc_block_handler();
+    }
+    else{
+        adc_scan_handler();
+    }
 }
 
-int write_statistics(char * buffer, TimeSeriesStatistics const & to_dump){
-    char crrt_writeout[128];
-    for (size_t i=0; i<128; i++){
-        crrt_writeout[i] = '\0';
-    }
-    int crrt_buffer_pos_to_write = 0;
+////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////
 
-    sprintf(crrt_writeout, "%.3E,", to_dump.mean);
-    append_buffer(buffer, crrt_writeout, crrt_buffer_pos_to_write);
+// the message formatting
 
-    sprintf(crrt_writeout, "%.3E,", to_dump.mean_of_square);
-    append_buffer(buffer, crrt_writeout, crrt_buffer_pos_to_write);
+// write the decimal representation of value, with leading zeros up to min_nbr_digits, and return the number of chars
+// written; no printf, so that this is cheap enough for timestamping each logged message
+int write_uint32_decimal(char * buffer, uint32_t value, int min_nbr_digits){
+    char reversed_digits[10];
+    int nbr_digits = 0;
+    do {
+        reversed_digits[nbr_digits] = static_cast<char>('0' + value % 10);
+        value /= 10;
+        nbr_digits += 1;
+    } while (value > 0);
+
+    int crrt_buffer_pos_to_write = 0;
 
-    sprintf(crrt_writeout, "%.3E,", to_dump.max);
-    append_buffer(buffer, crrt_writeout, crrt_buffer_pos_to_write);
+    while (crrt_buffer_pos_to_write < min_nbr_digits - nbr_digits){
+        buffer[crrt_buffer_pos_to_write] = '0';
+        crrt_buffer_pos_to_write += 1;
+    }
 
-    sprintf(crrt_writeout, "%.3E,", to_dump.min);
-    append_buffer(buffer, crrt_writeout, crrt_buffer_pos_to_write);
+    while (nbr_digits > 0){
+        nbr_digits -= 1;
+        buffer[crrt_buffer_pos_to_write] = reversed_digits[nbr_digits];
+        crrt_buffer_pos_to_write += 1;
+    }
 
-    sprintf(crrt_writeout, "%.3E", static_cast<double>(to_dump.extremal_count));
-    append_buffer(buffer, crrt_writeout, crrt_buffer_pos_to_write);
+    buffer[crrt_buffer_pos_to_write] = '\0';
 
     return crrt_buffer_pos_to_write;
 }
@@ -200,22 +369,115 @@ int write_statistics(char * buffer, TimeSeriesStatistics const & to_dump){
 
 // the wrapper class stuff
 
-bool FastLogger::start_recording()
+void FastLogger::init_processing()
 {
     // prepare all analyzers
     for (size_t crrt_channel = 0; crrt_channel < nbr_of_adc_channels; crrt_channel++){
-        analyzers_adc_channels[crrt_channel].init();
+        analyzers_adc_channels[crrt_channel].init(nbr_of_seconds_per_analysis * adc_crrt_sampling_frequency, middle_adc_value, threshold_low, threshold_high);
+    }
+
+    // prepare the compressed logging
+    if constexpr (adc_compression){
+        for (size_t crrt_channel = 0; crrt_channel < nbr_of_adc_channels; crrt_channel++){
+            blocks_compressed_with_metadata[crrt_channel].metadata.metadata_id = make_metadata_id('R', crrt_channel);
+            rice_encoders[crrt_channel].start_block(blocks_compressed_with_metadata[crrt_channel].data, sizeof(blocks_compressed_with_metadata[crrt_channel].data));
+        }
+    }
+
+    // prepare the event logging
+    if constexpr (event_logging){
+        for (size_t crrt_channel = 0; crrt_channel < nbr_of_adc_channels; crrt_channel++){
+            detectors_adc_channels[crrt_channel].init(event_sta_shift, event_lta_shift, event_trigger_ratio_x16, event_detrigger_ratio_x16);
+            event_decimators[crrt_channel].reset();
+
+            blocks_decimated_with_metadata[crrt_channel].metadata.metadata_id = make_metadata_id('D', crrt_channel);
+        }
+
+        crrt_decimated_data_index_to_write = 0;
+        event_file_is_open = false;
+
+        // a pre trigger does not carry over to a new sampling frequency
+        release_pretrigger_block_sets();
+    }
+}
+
+void FastLogger::apply_sampling_frequency()
+{
+    // the request was checked, so this only fails if nothing was requested yet at all
+    if (!adc_set_sampling_frequency(requested_sampling_frequency)){
+        requested_sampling_frequency = adc_crrt_sampling_frequency;
+    }
+
+    adc_block_period_micros = static_cast<uint32_t>(nbr_adc_measurements_per_block * 1000000ULL / adc_crrt_sampling_frequency);
+
+    event_nbr_pretrigger_blocks = nbr_adc_blocks_for_seconds(event_pretrigger_seconds);
+    event_nbr_posttrigger_blocks = nbr_adc_blocks_for_seconds(event_posttrigger_seconds);
+    event_max_nbr_blocks = nbr_adc_blocks_for_seconds(event_max_duration_seconds);
+
+    // at high rates, the block pool covers a shorter pre trigger than asked for
+    if (event_nbr_pretrigger_blocks > event_max_nbr_pretrigger_blocks){
+        event_nbr_pretrigger_blocks = event_max_nbr_pretrigger_blocks;
+    }
+
+    uint64_t const event_preallocate_nbr_blocks = static_cast<uint64_t>(event_nbr_pretrigger_blocks + event_max_nbr_blocks) * nbr_of_adc_channels;
+    event_preallocate_size = event_preallocate_nbr_blocks << 9;
+
+    if (serial_debug_output_is_active){
+        Serial.print(F("sampling frequency "));
+        Serial.print(adc_crrt_sampling_frequency);
+        Serial.print(F(" prescale "));
+        Serial.print(adc_crrt_timing.prescale);
+        Serial.print(F(" timer RC "));
+        Serial.println(adc_crrt_timing.timer_rc);
     }
 
-    // setup the metadata in char data
-    for (size_t crrt_char_block = 0; crrt_char_block < nbr_blocks_char; crrt_char_block++){
-        blocks_cstring_with_metadata[crrt_char_block].metadata.metadata_id = 'C';
-        blocks_cstring_with_metadata[crrt_char_block].metadata.block_number = crrt_char_block;
+    // keep track of the ADC settings in the logged data: RATE,sampling_frequency,prescale,timer_rc
+    char rate_message[48];
+    sprintf(rate_message, "RATE,%i,%i,%lu", adc_crrt_sampling_frequency, static_cast<int>(adc_crrt_timing.prescale),
+            static_cast<unsigned long>(adc_crrt_timing.timer_rc));
+    log_cstring(rate_message);
+}
+
+void FastLogger::change_sampling_frequency()
+{
+    // stop the ADC, and write out all the blocks it completed; the block it was filling is dropped
+    adc_stop();
+    process_available_adc_blocks(true);
+
+    if (event_file_is_open){
+        close_event_file();
     }
 
+    // the next file is prepared for requested_sampling_frequency
+    switch_to_next_file();
+
+    // the decimators, detectors, etc, do not carry over to the new frequency; a partly filled decimated block is dropped
+    apply_sampling_frequency();
+    init_processing();
+
+    setup_adc_buffer_metadata();
+    adc_setup();
+    tc_setup();
+}
+
+bool FastLogger::start_recording()
+{
+    apply_sampling_frequency();
+    init_processing();
+
+    // the loss accounting is over the whole recording, across files
+    adc_block_sequence_number = 0;
+    adc_nbr_dropped_samples = 0;
+    adc_nbr_conversion_overruns = 0;
+    nbr_dropped_chars = 0;
+    nbr_dropped_records = 0;
+    nbr_file_structure_failures = 0;
+    time_last_telemetry = millis();
+    reset_telemetry();
+
     // setup the SD card
     const uint8_t SD_CS_PIN = sd_card_select_pin;
-    SdSpiConfig sd_config{SD_CS_PIN, DEDICATED_SPI, SD_SCK_MHZ(25)};
+    SdSpiConfig sd_config{SD_CS_PIN, DEDICATED_SPI, SD_SCK_MHZ(sd_spi_clock_mhz)};
 
     if (sd_is_active){
         while (!sd_object.begin(sd_config))
@@ -227,11 +489,14 @@ bool FastLogger::start_recording()
 
     delay(5);
 
-    // create a new file
-    while (!open_new_file()){
-        delay(100);
+    // the files that were being written when the power was lost
+    if (sd_is_active){
+        recover_last_files();
     }
 
+    // create a new file
+    switch_to_next_file();
+
     // set the timer and ADC
     setup_adc_buffer_metadata();
     adc_setup();
@@ -245,6 +510,12 @@ bool FastLogger::start_recording()
 bool FastLogger::stop_recording()
 {
     logging_is_active = false;
+
+    // first, as closing the event file logs a message to the main file
+    if (event_file_is_open){
+        close_event_file();
+    }
+
     close_crrt_file();
 
     return true;
@@ -254,242 +525,1027 @@ bool FastLogger::is_active(){
     return logging_is_active;
 }
 
-void FastLogger::log_char(const char crrt_char)
-{
-    // add to char buffer
-    blocks_cstring_with_metadata[crrt_char_block_index_to_write].data[crrt_char_data_index_to_write] = crrt_char;
-    crrt_char_data_index_to_write += 1;
+bool FastLogger::request_sampling_frequency(int sampling_frequency){
+    if ((sampling_frequency <= 0) ||
+        !compute_adc_timing(F_CPU, static_cast<uint32_t>(sampling_frequency) * adc_oversampling_ratio, nbr_of_adc_channels).valid){
+        return false;
+    }
 
-    // if end of block, update metadata, write to SD, update indexes etc
-    if (crrt_char_data_index_to_write >= nbr_chars_per_block)
-    {
-        if (serial_debug_output_is_active){
-            Serial.println(F("chars dump"));
-        }
+    requested_sampling_frequency = sampling_frequency;
 
-        unsigned long int crrt_micros = micros();
-        blocks_cstring_with_metadata[crrt_char_block_index_to_write].metadata.micros_end = crrt_micros;
+    // the next file may already be pre-allocated for the previous frequency
+    if (((next_file_step == NextFileStep::erase) || (next_file_step == NextFileStep::ready))
+        && (next_file_sampling_frequency != requested_sampling_frequency)){
+        next_file_step = NextFileStep::pre_allocate;
+    }
 
-        crrt_char_data_index_to_write = 0;
-        write_block_to_sd_card(&blocks_cstring_with_metadata[crrt_char_block_index_to_write]);
+    return true;
+}
 
-        crrt_char_block_index_to_write = (crrt_char_block_index_to_write + 1) % nbr_blocks_char;
-        blocks_cstring_with_metadata[crrt_char_block_index_to_write].metadata.micros_start = crrt_micros;
-    }
+int FastLogger::get_sampling_frequency(){
+    return adc_crrt_sampling_frequency;
 }
 
-void FastLogger::log_cstring(const char *cstring)
-{
-    // log the time
-    unsigned long crrt_micros = micros();
+uint32_t FastLogger::get_min_slack_micros() const{
+    return min_slack_micros;
+}
 
-    log_char('M');
+void FastLogger::log_char(const char crrt_char)
+{
+    log_chars(&crrt_char, 1, false);
+}
 
-    char micros_timestamp[32];
-    for (size_t i=0; i<32; i++){
-        micros_timestamp[i] = '\0';
-    }
-    sprintf(micros_timestamp, "%09lu", crrt_micros);
-    for (int i = 0; i < 9; i++)
-    {
-        log_char(micros_timestamp[i]);
-    }
+void FastLogger::log_chars(char const * chars, size_t nbr_chars, bool replace_delimiter)
+{
+    while (nbr_chars > 0){
+        // start a new block if needed
+        if (crrt_char_block == nullptr){
+            PoolBlock * new_block = block_pool.take();
+
+            // nothing to write to: the SD card or the main loop is far behind
+            if (new_block == nullptr){
+                nbr_dropped_chars += nbr_chars;
+                return;
+            }
 
-    log_char(';');
+            crrt_char_block = &new_block->chars;
+            crrt_char_block->metadata.metadata_id = make_metadata_id('C', 0);
+            crrt_char_block->metadata.micros_start = micros();
+        }
 
-    // log the data string
-    size_t i = 0;
-    while (cstring[i] != '\0')
-    {
-        // put a max length to the string, in case the string in is not 0 terminated
-        if (i > 1024){
-            break;
+        // as much as fits in the block, in one go
+        size_t nbr_chars_to_copy = nbr_chars_per_block - crrt_char_data_index_to_write;
+        if (nbr_chars_to_copy > nbr_chars){
+            nbr_chars_to_copy = nbr_chars;
         }
 
-        char crrt_char = cstring[i];
+        char * const copy_start = &crrt_char_block->data[crrt_char_data_index_to_write];
+        memcpy(copy_start, chars, nbr_chars_to_copy);
 
-        if (crrt_char == ';'){
-            crrt_char = ':';
+        if (replace_delimiter){
+            char * crrt_delimiter = static_cast<char *>(memchr(copy_start, ';', nbr_chars_to_copy));
+            while (crrt_delimiter != nullptr){
+                *crrt_delimiter = ':';
+                crrt_delimiter = static_cast<char *>(memchr(crrt_delimiter + 1, ';', copy_start + nbr_chars_to_copy - (crrt_delimiter + 1)));
+            }
         }
 
-        log_char(crrt_char);
-        i++;
-    }
+        crrt_char_data_index_to_write += nbr_chars_to_copy;
+        chars += nbr_chars_to_copy;
+        nbr_chars -= nbr_chars_to_copy;
 
-    log_char(';');
+        if (crrt_char_data_index_to_write >= nbr_chars_per_block){
+            queue_crrt_char_block();
+        }
+    }
 }
 
-void FastLogger::internal_update(){
-    if (logging_is_active)
-    {
-        // check if some data to write from the ADC
-        // for this check if some readily available data in blocks, starting at the next one to be over-written, checking
-        // until the current block being written non included to avoid overlapping read and writes
-        for (size_t offset_block_index = 0; offset_block_index < nbr_blocks_per_adc_channel - 1; offset_block_index++)
-        {
-            int index_to_examine = (crrt_adc_block_index_to_write + 1 + offset_block_index) % nbr_blocks_per_adc_channel;
+void FastLogger::queue_crrt_char_block()
+{
+    crrt_char_block->metadata.micros_end = micros();
 
-            if (blocks_to_write[index_to_examine])
-            {
-                if (serial_debug_output_is_active)
-                {
-                    Serial.println(F("ADC dump"));
-                }
-                blocks_to_write[index_to_examine] = false;
-                write_adc_blocks_to_sd_card(index_to_examine);
-            }
-        }
+    crrt_char_data_index_to_write = 0;
+    crrt_char_block->metadata.block_number = char_block_sequence_number;
+    char_block_sequence_number += 1;
 
-        // check if some stats data to write
-        for (size_t crrt_channel = 0; crrt_channel < nbr_of_adc_channels; crrt_channel++){
-            if (analyzers_adc_channels[crrt_channel].stats_are_available()){
-                if (serial_debug_output_is_active){
-                    Serial.println(F("stats avail"));
-                }
+    if (!queue_log_block(reinterpret_cast<PoolBlock *>(crrt_char_block))){
+        nbr_dropped_chars += nbr_chars_per_block;
+    }
+    crrt_char_block = nullptr;
+}
 
-                // post the current stats
-                TimeSeriesStatistics const & crrt_stats = analyzers_adc_channels[crrt_channel].get_stats();
+void FastLogger::log_record_bytes(uint8_t tag, void const * record, size_t nbr_bytes)
+{
+    size_t const nbr_bytes_with_header = sizeof(RecordHeader) + nbr_bytes;
 
-                for (size_t i=0; i<256; i++){
-                    timeseries_buffer_stats_dump[i] = '\0';
-                }
+    // records are not split between blocks
+    if ((crrt_record_block != nullptr) && (crrt_record_data_index_to_write + nbr_bytes_with_header > nbr_record_bytes_per_block)){
+        queue_crrt_record_block();
+    }
 
-                // packet information
-                timeseries_buffer_stats_dump[0] = 'S';
-                timeseries_buffer_stats_dump[1] = 'T';
-                timeseries_buffer_stats_dump[2] = 'A';
-                timeseries_buffer_stats_dump[3] = 'T';
-                char crrt_chnl[32];
-                for (size_t i=0; i<32; i++){
-                    crrt_chnl[i] = '\0';
-                }
-                sprintf(crrt_chnl, "%02i", crrt_channel);
-                timeseries_buffer_stats_dump[4] = crrt_chnl[0];
-                timeseries_buffer_stats_dump[5] = crrt_chnl[1];
-                timeseries_buffer_stats_dump[6] = ',';
+    if (crrt_record_block == nullptr){
+        PoolBlock * new_block = block_pool.take();
+
+        // nothing to write to: the SD card or the main loop is far behind
+        if (new_block == nullptr){
+            nbr_dropped_records += 1;
+            return;
+        }
 
-                // where to start writing the stats information
-                int nbr_chars_written = 0;
+        crrt_record_block = &new_block->records;
+        memset(crrt_record_block, 0, sizeof(BlockRecordsWithMetadata));
+        crrt_record_block->metadata.metadata_id = make_metadata_id('B', 0);
+        crrt_record_block->metadata.micros_start = micros();
+        crrt_record_block_nbr_records = 0;
+    }
 
-                nbr_chars_written = write_statistics(&timeseries_buffer_stats_dump[7], crrt_stats);
+    RecordHeader header;
+    header.tag = tag;
+    header.nbr_bytes = static_cast<uint8_t>(nbr_bytes);
+    header.unused = 0;
+    header.micros = micros();
 
-                timeseries_buffer_stats_dump[7 + nbr_chars_written + 1] = '\0';
+    memcpy(&crrt_record_block->data[crrt_record_data_index_to_write], &header, sizeof(RecordHeader));
+    memcpy(&crrt_record_block->data[crrt_record_data_index_to_write + sizeof(RecordHeader)], record, nbr_bytes);
+    crrt_record_data_index_to_write += nbr_bytes_with_header;
+    crrt_record_block_nbr_records += 1;
+}
 
-                log_cstring(timeseries_buffer_stats_dump);
+void FastLogger::queue_crrt_record_block()
+{
+    crrt_record_block->metadata.micros_end = micros();
 
-                if (serial_debug_output_is_active){
-                    Serial.println(timeseries_buffer_stats_dump);
-                }
-            }
-        }
+    crrt_record_data_index_to_write = 0;
+    crrt_record_block->metadata.block_number = record_block_sequence_number;
+    record_block_sequence_number += 1;
 
-        // check if should use new file
-        if (need_new_file())
-        {
-            close_crrt_file();
-            while (!open_new_file()){
-                delay(100);
-            }
-        }
+    if (!queue_log_block(reinterpret_cast<PoolBlock *>(crrt_record_block))){
+        nbr_dropped_records += crrt_record_block_nbr_records;
     }
+    crrt_record_block = nullptr;
 }
 
-void FastLogger::enable_serial_debug_output()
+bool FastLogger::queue_log_block(PoolBlock * block)
 {
-    serial_debug_output_is_active = true;
-    Serial.println(F("FastLogger enable serial debug"));
-}
+    if (log_write_queue.push(block)){
+        return true;
+    }
 
-void FastLogger::disable_SD(){
-    sd_is_active = false;
+    // the queue is full, i.e. internal_update has not been able to write for a while: drop the block rather than wait
+    // for the card; its block number is skipped, so that the gap shows in the file
+    block_pool.give_back(block);
+    return false;
 }
 
-bool FastLogger::write_block_to_sd_card(void *block_start)
+void FastLogger::write_queued_log_blocks(bool drain)
 {
-    if (serial_debug_output_is_active){
-        for (size_t crrt_byte = 0; crrt_byte<20; crrt_byte++){
-            Serial.print(static_cast<uint8_t *>(block_start)[crrt_byte], HEX);
-            Serial.print(" ");
+    PoolBlock * crrt_block;
+
+    while (!log_write_queue.is_empty()){
+        if (!drain && sd_is_active && SdBlockStream::card_is_busy(&sd_object)){
+            break;
         }
-        Serial.println();
-    }
 
-    if (sd_is_active){
-        if (binary_file.write(block_start, 512) != 512)
-        {
-            if (serial_debug_output_is_active)
-            {
-                Serial.println(F("problem writing block"));
-            }
-            return false;
+        log_write_queue.pop(crrt_block);
+
+        if (serial_debug_output_is_active){
+            Serial.println(F("log block dump"));
         }
-    }
 
-    return true;
+        write_block_to_sd_card(crrt_block);
+        block_pool.give_back(crrt_block);
+    }
 }
 
-bool FastLogger::write_adc_blocks_to_sd_card(int adc_blocks_index)
+void FastLogger::log_cstring(const char *cstring)
 {
-    for (int crrt_adc_ind = 0; crrt_adc_ind < nbr_of_adc_channels; crrt_adc_ind++)
-    {
-        write_block_to_sd_card(
-            const_cast<void *>(
-                static_cast<volatile void *>(
-                    &blocks_adc_with_metdata[crrt_adc_ind][adc_blocks_index])));
-    }
-
-    return true;
+    // put a max length to the string, in case the string in is not 0 terminated
+    log_message(cstring, strnlen(cstring, max_cstring_length));
 }
 
-bool FastLogger::open_new_file()
+void FastLogger::log_message(char const * chars, size_t nbr_chars, char const * chars_continued, size_t nbr_chars_continued)
 {
-    // generate the right filename and increment future filename
-    uint32_t file_number;
-    file_number = persistent_filenumber.get_file_number();
-    persistent_filenumber.increment_file_number();
+    // log the time: M, then the first 9 digits of the micros (with leading zeros), then the delimiter; the parser
+    // expects exactly 9 chars
+    char micros_timestamp[12];
+    micros_timestamp[0] = 'M';
+    write_uint32_decimal(&micros_timestamp[1], static_cast<uint32_t>(micros()), 9);
+    micros_timestamp[10] = ';';
+
+    log_chars(micros_timestamp, 11, false);
+
+    log_chars(chars, nbr_chars, true);
+    if (nbr_chars_continued > 0){
+        log_chars(chars_continued, nbr_chars_continued, true);
+    }
 
-    // TODO: check that this is ok, possibly needs %08d instead
-    sprintf(filename, "F%08lu.bin", file_number);
+    log_char(';');
+}
+
+void FastLogger::process_available_adc_blocks(bool drain){
+    // the block sets come in the order the ISR completed them
+    while (adc_blocks_are_pending())
+    {
+        // an SD write while the card is busy would wait here, while there may be other things to do in the main loop
+        if (!drain && sd_is_active && SdBlockStream::card_is_busy(&sd_object)){
+            break;
+        }
+
+        AdcBlockSet crrt_block_set;
+        adc_full_queue.pop(crrt_block_set);
+
+        if (serial_debug_output_is_active)
+        {
+            Serial.println(F("ADC dump"));
+        }
+
+        // the statistics are computed on whole blocks here, rather than sample by sample in the ISR
+        for (size_t crrt_channel = 0; crrt_channel < nbr_of_adc_channels; crrt_channel++){
+            analyzers_adc_channels[crrt_channel].register_block(crrt_block_set.blocks[crrt_channel]->data, nbr_adc_measurements_per_block);
+        }
+
+        if ((timebase != nullptr) && timebase->is_valid()){
+            BlockMetadata const & metadata = crrt_block_set.blocks[0]->metadata;
+
+            AdcUtcRecord utc_record {};
+            utc_record.block_number = metadata.block_number;
+            utc_record.micros_start = metadata.micros_start;
+            utc_record.utc_micros_start = timebase->utc_micros(metadata.micros_start);
+
+            log_record(utc_record);
+        }
+
+        if constexpr (event_logging){
+            if (process_adc_blocks_for_events(crrt_block_set)){
+                give_back_adc_block_set(crrt_block_set);
+            }
+            else{
+                keep_for_pretrigger(crrt_block_set);
+            }
+        }
+        else{
+            if constexpr (adc_compression){
+                write_compressed_adc_blocks_to_sd_card(crrt_block_set);
+            }
+            else{
+                write_adc_blocks_to_sd_card(crrt_block_set);
+            }
+
+            give_back_adc_block_set(crrt_block_set);
+        }
+    }
+}
+
+int FastLogger::get_slack_block_sets(){
+    int const nbr_free_blocks = block_pool.get_nbr_free() + static_cast<int>(pretrigger_block_sets.size()) * nbr_of_adc_channels;
+    return nbr_free_blocks / nbr_of_adc_channels;
+}
+
+void FastLogger::log_available_stats(){
+    for (size_t crrt_channel = 0; crrt_channel < nbr_of_adc_channels; crrt_channel++){
+        if (analyzers_adc_channels[crrt_channel].stats_are_available()){
+            if (serial_debug_output_is_active){
+                Serial.println(F("stats avail"));
+            }
+
+            // post the current stats, as the exact integer sums
+            TimeSeriesIntegerStatistics const & crrt_integer_stats = analyzers_adc_channels[crrt_channel].get_integer_stats();
+
+            ChannelStatsRecord stats_record {};
+            stats_record.channel = static_cast<uint16_t>(crrt_channel);
+            stats_record.nbr_samples = crrt_integer_stats.nbr_samples;
+            stats_record.sum = crrt_integer_stats.sum;
+            stats_record.sum_of_squares = crrt_integer_stats.sum_of_squares;
+            stats_record.max = crrt_integer_stats.max;
+            stats_record.min = crrt_integer_stats.min;
+            stats_record.extremal_count = crrt_integer_stats.extremal_count;
+
+            log_record(stats_record);
+        }
+    }
+}
+
+void FastLogger::internal_update(){
+    if (logging_is_active)
+    {
+        unsigned long const micros_start = micros();
+
+        // the ADC blocks are the closest to their deadline: once the pool is empty, the ADC drops samples
+        process_available_adc_blocks();
+
+        int const slack_block_sets = get_slack_block_sets();
+        uint32_t const slack_micros = static_cast<uint32_t>(slack_block_sets) * adc_block_period_micros;
+        if (slack_micros < min_slack_micros){
+            min_slack_micros = slack_micros;
+        }
+
+        bool const has_slack = !adc_blocks_are_pending() && (slack_block_sets >= scheduler_min_slack_block_sets);
+
+        // the chars and records logged since the last call; these hold pool blocks too, so they cannot wait forever
+        if (has_slack || (log_write_queue.size() >= log_write_queue_nbr_blocks / 2)){
+            write_queued_log_blocks();
+        }
+
+        // check if the loss accounting and telemetry are due; a deferred telemetry period is only longer, but not by
+        // more than a period, as the telemetry matters most when there is no slack
+        unsigned long const millis_since_telemetry = millis() - time_last_telemetry;
+        if ((has_slack && (millis_since_telemetry >= telemetry_period_milliseconds))
+            || (millis_since_telemetry >= 2 * telemetry_period_milliseconds)){
+            time_last_telemetry += telemetry_period_milliseconds;
+            log_overrun_telemetry();
+            write_telemetry_block();
+        }
+
+        if (has_slack){
+            log_available_stats();
+
+            // use the idle time to get the next file ready, so that switching to it is quick
+            if (log_write_queue.is_empty() && !(sd_is_active && SdBlockStream::card_is_busy(&sd_object))){
+                prepare_next_file_step();
+            }
+        }
+
+        // check if should use new file; this is also where a new sampling frequency takes effect
+        // this is not deferred, so that the files keep their duration; switch_to_next_file finishes getting the file ready
+        // if the idle time was not enough
+        if (need_new_file())
+        {
+            if (requested_sampling_frequency != adc_crrt_sampling_frequency){
+                change_sampling_frequency();
+            }
+            else{
+                switch_to_next_file();
+            }
+        }
+
+        uint32_t const duration = static_cast<uint32_t>(micros() - micros_start);
+        internal_update_micros.register_value(duration);
+        internal_update_total_micros += duration;
+    }
+}
+
+void FastLogger::set_timebase(PpsTimebase const * timebase)
+{
+    this->timebase = timebase;
+}
+
+void FastLogger::enable_serial_debug_output()
+{
+    serial_debug_output_is_active = true;
+    Serial.println(F("FastLogger enable serial debug"));
+}
+
+void FastLogger::disable_SD(){
+    sd_is_active = false;
+}
+
+bool FastLogger::write_block_to_sd_card(void *block_start)
+{
+    // the check block of a full group comes first: as long as it is not written, the next blocks cannot be either,
+    // otherwise they would be at its offset
+    if ((crrt_check_block.nbr_blocks_covered == file_check_group_nbr_blocks - 1) && !write_check_block(false)){
+        return false;
+    }
+
+    // the index and the check block only count the blocks actually in the file, so that the offsets stay right
+    if (!write_block_to_stream(binary_streams[crrt_binary_file_index], block_start)){
+        return false;
+    }
+
+    register_in_file_index(*static_cast<BlockMetadata const *>(block_start));
+    nbr_blocks_in_crrt_file += 1;
+
+    crrt_check_block.block_crcs[crrt_check_block.nbr_blocks_covered] = crc32(block_start, 512);
+    crrt_check_block.nbr_blocks_covered += 1;
+
+    if (crrt_check_block.nbr_blocks_covered == file_check_group_nbr_blocks - 1){
+        write_check_block(false);
+    }
+
+    return true;
+}
+
+bool FastLogger::write_check_block(bool is_final)
+{
+    BlockCheckWithMetadata & check_block = crrt_check_block;
+
+    check_block.metadata.metadata_id = make_metadata_id('K', 0);
+    check_block.metadata.block_number = static_cast<uint16_t>(check_block.group_index);
+    check_block.metadata.micros_start = time_opening_crrt_file;
+    check_block.metadata.micros_end = micros();
+    check_block.file_number = file_numbers[crrt_binary_file_index];
+    check_block.is_final = is_final ? 1 : 0;
+    check_block.crc = crc32(&check_block, offsetof(BlockCheckWithMetadata, crc));
+
+    if (!write_block_to_stream(binary_streams[crrt_binary_file_index], &check_block)){
+        return false;
+    }
+
+    nbr_blocks_in_crrt_file += 1;
+
+    // the next group
+    check_block.group_index += 1;
+    check_block.nbr_blocks_covered = 0;
+    memset(check_block.block_crcs, 0, sizeof(check_block.block_crcs));
+
+    return true;
+}
+
+void FastLogger::register_in_file_index(BlockMetadata const & metadata)
+{
+    int const type_index = static_cast<int>(metadata.metadata_id & 0xFF) - 'A';
+
+    // only the data blocks are indexed, not the header and the index itself
+    if ((type_index < 0) || (type_index >= 26) || (type_index == 'H' - 'A') || (type_index == 'I' - 'A')){
+        return;
+    }
+
+    uint32_t const type_mask = 0b1ul << type_index;
+
+    if ((file_index_types_seen & type_mask) && (metadata.micros_start - file_index_last_micros[type_index] < file_index_period_micros)){
+        return;
+    }
+
+    if (nbr_file_index_entries_used >= nbr_file_index_entries){
+        return;
+    }
+
+    FileIndexEntry & new_entry = file_index_entries[nbr_file_index_entries_used];
+    new_entry.metadata_id = metadata.metadata_id;
+    new_entry.block_number = metadata.block_number;
+    new_entry.block_offset = nbr_blocks_in_crrt_file;
+    new_entry.micros_start = metadata.micros_start;
+    nbr_file_index_entries_used += 1;
+
+    file_index_types_seen |= type_mask;
+    file_index_last_micros[type_index] = metadata.micros_start;
+}
+
+bool FastLogger::write_file_header()
+{
+    // the header is written right after the switch, while the ADC is (re)started at requested_sampling_frequency
+    AdcTiming const timing = compute_adc_timing(F_CPU, static_cast<uint32_t>(requested_sampling_frequency) * adc_oversampling_ratio, nbr_of_adc_channels);
+
+    BlockHeaderWithMetadata & header_block = file_structure_block.header;
+    memset(&header_block, 0, sizeof(header_block));
+
+    header_block.metadata.metadata_id = make_metadata_id('H', 0);
+    header_block.metadata.block_number = 0;
+    header_block.metadata.micros_start = time_opening_crrt_file;
+    header_block.metadata.micros_end = time_opening_crrt_file;
+
+    header_block.format_version = file_format_version;
+    header_block.nbr_adc_channels = nbr_of_adc_channels;
+    for (size_t crrt_channel = 0; crrt_channel < nbr_of_adc_channels; crrt_channel++){
+        header_block.adc_channels[crrt_channel] = adc_channels[crrt_channel];
+    }
+
+    header_block.sampling_frequency = requested_sampling_frequency;
+    header_block.acquisition_frequency_mHz = timing.actual_frequency_mHz;
+    header_block.adc_prescale = static_cast<uint16_t>(timing.prescale);
+    header_block.adc_oversampling_ratio = adc_oversampling_ratio;
+    header_block.adc_timer_rc = timing.timer_rc;
+    header_block.adc_logged_bits = adc_logged_bits;
+    header_block.nbr_adc_measurements_per_block = nbr_adc_measurements_per_block;
+
+    header_block.flags = (adc_compression ? file_header_flag_adc_compression : 0) | (event_logging ? file_header_flag_event_logging : 0);
+    header_block.file_duration_seconds = file_duration_seconds;
+    header_block.file_number = file_numbers[crrt_binary_file_index];
+    header_block.check_group_nbr_blocks = file_check_group_nbr_blocks;
+
+    strncpy(header_block.firmware_build, __DATE__ " " __TIME__, sizeof(header_block.firmware_build) - 1);
+
+    bool const result = write_block_to_sd_card(&header_block);
+    if (!result){
+        nbr_file_structure_failures += 1;
+    }
+
+    return result;
+}
+
+bool FastLogger::write_file_index()
+{
+    BlockIndexWithMetadata & index_block = file_structure_block.index;
+    bool result = true;
+    int nbr_entries_written = 0;
+    uint16_t index_block_number = 0;
+
+    // at least one block, so that a closed file always ends with its index, even if empty
+    do {
+        memset(&index_block, 0, sizeof(index_block));
+
+        int nbr_entries_in_block = nbr_file_index_entries_used - nbr_entries_written;
+        if (nbr_entries_in_block > nbr_file_index_entries_per_block){
+            nbr_entries_in_block = nbr_file_index_entries_per_block;
+        }
+
+        index_block.metadata.metadata_id = make_metadata_id('I', 0);
+        index_block.metadata.block_number = index_block_number;
+        index_block.metadata.micros_start = time_opening_crrt_file;
+        index_block.metadata.micros_end = micros();
+        index_block.nbr_entries = static_cast<uint16_t>(nbr_entries_in_block);
+        memcpy(index_block.entries, &file_index_entries[nbr_entries_written], nbr_entries_in_block * sizeof(FileIndexEntry));
+
+        result &= write_block_to_sd_card(&index_block);
+
+        nbr_entries_written += nbr_entries_in_block;
+        index_block_number += 1;
+    } while (nbr_entries_written < nbr_file_index_entries_used);
+
+    if (!result){
+        nbr_file_structure_failures += 1;
+    }
+
+    return result;
+}
+
+bool FastLogger::write_block_to_stream(SdBlockStream & stream, void *block_start)
+{
+    if (serial_debug_output_is_active){
+        for (size_t crrt_byte = 0; crrt_byte<20; crrt_byte++){
+            Serial.print(static_cast<uint8_t *>(block_start)[crrt_byte], HEX);
+            Serial.print(" ");
+        }
+        Serial.println();
+    }
+
+    if (sd_is_active){
+        unsigned long const micros_start = micros();
+        bool const result = stream.write_block(block_start);
+        sd_write_micros.register_value(static_cast<uint32_t>(micros() - micros_start));
+
+        if (!result)
+        {
+            if (serial_debug_output_is_active)
+            {
+                Serial.println(F("problem writing block"));
+            }
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool FastLogger::write_adc_blocks_to_sd_card(AdcBlockSet const & block_set)
+{
+    for (int crrt_adc_ind = 0; crrt_adc_ind < nbr_of_adc_channels; crrt_adc_ind++)
+    {
+        write_block_to_sd_card(block_set.blocks[crrt_adc_ind]);
+    }
+
+    return true;
+}
+
+// the time of a sample within an ADC block, assuming regular sampling between the first and last sample
+unsigned long adc_sample_micros(BlockADCWithMetadata const & adc_block, size_t sample_index){
+    unsigned long const block_duration = adc_block.metadata.micros_end - adc_block.metadata.micros_start;
+    return adc_block.metadata.micros_start
+           + static_cast<unsigned long>(static_cast<uint64_t>(block_duration) * sample_index / (nbr_adc_measurements_per_block - 1));
+}
+
+bool FastLogger::write_compressed_adc_blocks_to_sd_card(AdcBlockSet const & block_set)
+{
+    for (int crrt_adc_ind = 0; crrt_adc_ind < nbr_of_adc_channels; crrt_adc_ind++)
+    {
+        BlockADCWithMetadata const & crrt_adc_block = *block_set.blocks[crrt_adc_ind];
+        uint16_t const * crrt_values = crrt_adc_block.data;
+        BlockCompressedADCWithMetadata & crrt_compressed_block = blocks_compressed_with_metadata[crrt_adc_ind];
+
+        size_t nbr_values_done = 0;
+        while (nbr_values_done < nbr_adc_measurements_per_block){
+            if (rice_encoders[crrt_adc_ind].get_nbr_samples() == 0){
+                crrt_compressed_block.metadata.micros_start = adc_sample_micros(crrt_adc_block, nbr_values_done);
+            }
+
+            nbr_values_done += rice_encoders[crrt_adc_ind].append(&crrt_values[nbr_values_done], nbr_adc_measurements_per_block - nbr_values_done);
+            crrt_compressed_block.metadata.micros_end = adc_sample_micros(crrt_adc_block, nbr_values_done - 1);
+
+            if (rice_encoders[crrt_adc_ind].is_full()){
+                flush_compressed_adc_block(crrt_adc_ind);
+            }
+        }
+    }
+
+    return true;
+}
+
+bool FastLogger::flush_compressed_adc_block(int adc_channel)
+{
+    rice_encoders[adc_channel].finish_block();
+    blocks_compressed_with_metadata[adc_channel].metadata.block_number = compressed_block_sequence_numbers[adc_channel];
+    compressed_block_sequence_numbers[adc_channel] += 1;
+    bool const result = write_block_to_sd_card(&blocks_compressed_with_metadata[adc_channel]);
+    rice_encoders[adc_channel].start_block(blocks_compressed_with_metadata[adc_channel].data, sizeof(blocks_compressed_with_metadata[adc_channel].data));
+
+    return result;
+}
+
+void FastLogger::flush_compressed_adc_blocks()
+{
+    // so that each file can be decoded on its own, the partially filled compressed blocks end with it
+    if constexpr (adc_compression){
+        for (int crrt_adc_ind = 0; crrt_adc_ind < nbr_of_adc_channels; crrt_adc_ind++){
+            if (rice_encoders[crrt_adc_ind].get_nbr_samples() > 0){
+                flush_compressed_adc_block(crrt_adc_ind);
+            }
+        }
+    }
+}
+
+bool FastLogger::process_adc_blocks_for_events(AdcBlockSet const & block_set)
+{
+    bool block_is_active = false;
+
+    for (size_t crrt_channel = 0; crrt_channel < nbr_of_adc_channels; crrt_channel++){
+        if (event_detection_channel_mask & (0b1ul << crrt_channel)){
+            block_is_active |= detectors_adc_channels[crrt_channel].register_block(block_set.blocks[crrt_channel]->data, nbr_adc_measurements_per_block);
+        }
+    }
+
+    // the continuous, decimated data, goes to the F file whatever happens
+    write_decimated_adc_blocks(block_set);
+
+    if (block_is_active){
+        crrt_event_nbr_quiet_blocks = 0;
+
+        if (!event_file_is_open){
+            open_event_file();
+        }
+    }
+    else if (event_file_is_open){
+        crrt_event_nbr_quiet_blocks += 1;
+    }
+
+    if (!event_file_is_open){
+        return false;
+    }
+
+    for (int crrt_adc_ind = 0; crrt_adc_ind < nbr_of_adc_channels; crrt_adc_ind++)
+    {
+        write_block_to_stream(event_stream, block_set.blocks[crrt_adc_ind]);
+    }
+    crrt_event_nbr_blocks += 1;
+
+    if ((crrt_event_nbr_quiet_blocks >= event_nbr_posttrigger_blocks) || (crrt_event_nbr_blocks >= event_max_nbr_blocks)){
+        close_event_file();
+    }
+
+    // in an event file, so a next event must not take it again as pre trigger
+    return true;
+}
+
+void FastLogger::keep_for_pretrigger(AdcBlockSet const & block_set)
+{
+    AdcBlockSet oldest_block_set;
+
+    // make room: at most event_nbr_pretrigger_blocks sets are kept, which is not above the length of the queue
+    while ((static_cast<int>(pretrigger_block_sets.size()) >= event_nbr_pretrigger_blocks) && pretrigger_block_sets.pop(oldest_block_set)){
+        give_back_adc_block_set(oldest_block_set);
+    }
+
+    if ((event_nbr_pretrigger_blocks == 0) || !pretrigger_block_sets.push(block_set)){
+        give_back_adc_block_set(block_set);
+        return;
+    }
+
+    // the ISR and the chars come first
+    while ((block_pool.get_nbr_free() < event_pretrigger_min_nbr_free_pool_blocks) && pretrigger_block_sets.pop(oldest_block_set)){
+        give_back_adc_block_set(oldest_block_set);
+    }
+}
+
+void FastLogger::release_pretrigger_block_sets()
+{
+    AdcBlockSet oldest_block_set;
+
+    while (pretrigger_block_sets.pop(oldest_block_set)){
+        give_back_adc_block_set(oldest_block_set);
+    }
+}
+
+void FastLogger::write_decimated_adc_blocks(AdcBlockSet const & block_set)
+{
+    for (size_t crrt_channel = 0; crrt_channel < nbr_of_adc_channels; crrt_channel++){
+        BlockADCWithMetadata const & crrt_adc_block = *block_set.blocks[crrt_channel];
+        BlockADCWithMetadata & crrt_decimated_block = blocks_decimated_with_metadata[crrt_channel];
+
+        event_decimators[crrt_channel].process(crrt_adc_block.data, 1, nbr_adc_measurements_per_block,
+                                               &crrt_decimated_block.data[crrt_decimated_data_index_to_write]);
+
+        // a decimated value is output at the last ADC value of its decimation window
+        if (crrt_decimated_data_index_to_write == 0){
+            crrt_decimated_block.metadata.micros_start = crrt_adc_block.metadata.micros_start
+                                                         + (event_decimation_ratio - 1) * 1000000UL / adc_crrt_sampling_frequency;
+        }
+        crrt_decimated_block.metadata.micros_end = crrt_adc_block.metadata.micros_end;
+    }
+
+    crrt_decimated_data_index_to_write += nbr_decimated_values_per_adc_block;
+
+    if (crrt_decimated_data_index_to_write == nbr_adc_measurements_per_block){
+        crrt_decimated_data_index_to_write = 0;
+
+        for (size_t crrt_channel = 0; crrt_channel < nbr_of_adc_channels; crrt_channel++){
+            blocks_decimated_with_metadata[crrt_channel].metadata.block_number = decimated_block_sequence_number;
+            write_block_to_sd_card(&blocks_decimated_with_metadata[crrt_channel]);
+        }
+        decimated_block_sequence_number += 1;
+    }
+}
+
+bool FastLogger::open_event_file()
+{
+    // the file system needs the card
+    if (sd_is_active){
+        SdBlockStream::pause_active_stream();
+    }
+
+    // the event numbering restarts at each boot: skip the names already used
+    do {
+        sprintf(event_filename, "E%08lu.bin", event_file_number);
+        event_file_number += 1;
+    } while (sd_is_active && sd_object.exists(event_filename));
 
     if (serial_debug_output_is_active)
     {
-        Serial.print(F("new filename "));
-        Serial.println(filename);
+        Serial.print(F("new event filename "));
+        Serial.println(event_filename);
     }
 
     if (sd_is_active){
-        if (sd_object.exists(filename))
+        if (!event_file.open(event_filename, O_RDWR | O_CREAT))
         {
             if (serial_debug_output_is_active)
             {
-                Serial.println(F("file already exists"));
+                Serial.println(F("cannot open event file"));
             }
             return false;
         }
 
-        // create and pre-allocate the file
-        if (!binary_file.open(filename, O_RDWR | O_CREAT))
+        if (!event_file.preAllocate(event_preallocate_size))
         {
             if (serial_debug_output_is_active)
             {
-                Serial.println(F("cannot open file"));
+                Serial.println(F("cannot pre-allocate event file"));
             }
+            event_file.close();
             return false;
         }
 
-        if (!binary_file.preAllocate(preallocate_size))
+        event_stream.begin(&sd_object, &event_file);
+    }
+
+    event_file_is_open = true;
+    crrt_event_nbr_blocks = 0;
+    crrt_event_nbr_quiet_blocks = 0;
+
+    // the pre trigger: the block sets kept since the last event, oldest first, as long as the pool could spare them
+    int const nbr_pretrigger_blocks = static_cast<int>(pretrigger_block_sets.size());
+    AdcBlockSet pretrigger_block_set;
+
+    while (pretrigger_block_sets.pop(pretrigger_block_set)){
+        for (int crrt_adc_ind = 0; crrt_adc_ind < nbr_of_adc_channels; crrt_adc_ind++)
+        {
+            write_block_to_stream(event_stream, pretrigger_block_set.blocks[crrt_adc_ind]);
+        }
+        give_back_adc_block_set(pretrigger_block_set);
+        crrt_event_nbr_blocks += 1;
+    }
+
+    // keep track of the event in the main file
+    char event_message[48];
+    sprintf(event_message, "EVNT,%s,start,%i", event_filename, nbr_pretrigger_blocks);
+    log_cstring(event_message);
+
+    return true;
+}
+
+bool FastLogger::close_event_file()
+{
+    if (serial_debug_output_is_active)
+    {
+        Serial.println(F("close event file"));
+    }
+
+    event_file_is_open = false;
+
+    char event_message[48];
+    sprintf(event_message, "EVNT,%s,end,%i", event_filename, crrt_event_nbr_blocks);
+    log_cstring(event_message);
+
+    if (sd_is_active){
+        event_stream.end();
+
+        if (!event_file.close())
         {
             if (serial_debug_output_is_active)
             {
-                Serial.println(F("cannot pre-allocate file"));
+                Serial.println(F("cannot close event file"));
             }
             return false;
         }
     }
 
+    return true;
+}
+
+uint64_t FastLogger::file_preallocate_size(int sampling_frequency) const
+{
+    // all channels, plus the chars, the header and the index, plus a margin, plus the check blocks
+    uint64_t const nbr_adc_blocks = (static_cast<uint64_t>(file_duration_seconds) * sampling_frequency + nbr_adc_measurements_per_block - 1)
+                                    / nbr_adc_measurements_per_block;
+    uint64_t const nbr_data_blocks = nbr_adc_blocks * nbr_of_adc_channels + file_duration_seconds * 2 + 1 + file_index_nbr_blocks + 10;
+
+    // and the check blocks
+    uint64_t const preallocate_nbr_blocks = nbr_data_blocks + nbr_data_blocks / (file_check_group_nbr_blocks - 1) + 1;
+
+    return preallocate_nbr_blocks << 9;
+}
+
+bool FastLogger::prepare_next_file_step()
+{
+    if (next_file_step == NextFileStep::ready){
+        return true;
+    }
+
+    int const next_file_index = 1 - crrt_binary_file_index;
+    file_t & next_file = binary_files[next_file_index];
+
+    // the file system needs the card
+    if (sd_is_active){
+        SdBlockStream::pause_active_stream();
+    }
+
+    switch (next_file_step){
+        case NextFileStep::close_previous:
+            if (sd_is_active){
+                binary_streams[next_file_index].end();
+
+                if (!next_file.close() && serial_debug_output_is_active)
+                {
+                    Serial.println(F("cannot close file"));
+                }
+            }
+
+            next_file_step = NextFileStep::choose_name;
+            break;
+
+        case NextFileStep::choose_name: {
+            // generate the right filename and increment future filename
+            uint32_t const file_number = persistent_filenumber.get_file_number();
+            persistent_filenumber.increment_file_number();
+            file_numbers[next_file_index] = file_number;
+
+            sprintf(filenames[next_file_index], "F%08lu.bin", file_number);
+
+            if (serial_debug_output_is_active)
+            {
+                Serial.print(F("next filename "));
+                Serial.println(filenames[next_file_index]);
+            }
+
+            next_file_step = sd_is_active ? NextFileStep::check_name : NextFileStep::ready;
+            break;
+        }
+
+        case NextFileStep::check_name:
+            if (sd_object.exists(filenames[next_file_index]))
+            {
+                if (serial_debug_output_is_active)
+                {
+                    Serial.println(F("file already exists"));
+                }
+                next_file_step = NextFileStep::choose_name;
+            }
+            else{
+                next_file_step = NextFileStep::open;
+            }
+            break;
+
+        case NextFileStep::open:
+            // if this fails, it is tried again at the next step
+            if (!next_file.open(filenames[next_file_index], O_RDWR | O_CREAT))
+            {
+                if (serial_debug_output_is_active)
+                {
+                    Serial.println(F("cannot open file"));
+                }
+            }
+            else{
+                next_file_step = NextFileStep::pre_allocate;
+            }
+            break;
+
+        case NextFileStep::pre_allocate:
+            next_file_sampling_frequency = requested_sampling_frequency;
+
+            // a pre-allocation for another sampling frequency must be released first
+            if ((next_file.fileSize() > 0) && !next_file.truncate(0))
+            {
+                if (serial_debug_output_is_active)
+                {
+                    Serial.println(F("cannot release pre-allocation"));
+                }
+                break;
+            }
+
+            if (!next_file.preAllocate(file_preallocate_size(next_file_sampling_frequency)))
+            {
+                if (serial_debug_output_is_active)
+                {
+                    Serial.println(F("cannot pre-allocate file"));
+                }
+                break;
+            }
+
+            // the pre-allocation only changes the directory entry in the cache; without the sync, the size and the
+            // clusters of the file would only reach the card when it is closed, and recover_file would find an empty
+            // file after a power loss
+            if (!next_file.sync())
+            {
+                if (serial_debug_output_is_active)
+                {
+                    Serial.println(F("cannot sync file"));
+                }
+                break;
+            }
+
+            if (next_file.contiguousRange(&next_file_crrt_erase_sector, &next_file_last_erase_sector)){
+                next_file_step = NextFileStep::erase;
+            }
+            else{
+                next_file_step = NextFileStep::ready;
+            }
+            break;
+
+        case NextFileStep::erase: {
+            uint32_t last_sector_to_erase = next_file_crrt_erase_sector + sd_nbr_sectors_erased_per_step - 1;
+            if (last_sector_to_erase > next_file_last_erase_sector){
+                last_sector_to_erase = next_file_last_erase_sector;
+            }
+
+            // this is only an optimization: if the card does not support it, just go on
+            if (!sd_object.card()->erase(next_file_crrt_erase_sector, last_sector_to_erase)){
+                next_file_step = NextFileStep::ready;
+                break;
+            }
+
+            next_file_crrt_erase_sector = last_sector_to_erase + 1;
+
+            if (next_file_crrt_erase_sector > next_file_last_erase_sector){
+                next_file_step = NextFileStep::ready;
+            }
+            break;
+        }
+
+        case NextFileStep::ready:
+            break;
+    }
+
+    return next_file_step == NextFileStep::ready;
+}
+
+bool FastLogger::switch_to_next_file()
+{
+    unsigned long const micros_start = micros();
+
+    // the preparation must match the frequency at which the next file will be written
+    if ((next_file_step == NextFileStep::ready) && sd_is_active && (next_file_sampling_frequency != requested_sampling_frequency)){
+        next_file_step = NextFileStep::pre_allocate;
+    }
+
+    bool const next_file_was_ready = (next_file_step == NextFileStep::ready);
+
+    // if the idle calls to internal_update were not enough, finish now; the erase is only an optimization, so it is
+    // not worth the wait
+    while (!prepare_next_file_step()){
+        if (next_file_step == NextFileStep::erase){
+            next_file_step = NextFileStep::ready;
+        }
+    }
+
+    if (crrt_file_is_open){
+        flush_compressed_adc_blocks();
+        write_queued_log_blocks(true);
+        write_file_index();
+        write_check_block(true);
+    }
+
+    // the actual switch; the previous file is closed in the background
+    next_file_step = crrt_file_is_open ? NextFileStep::close_previous : NextFileStep::choose_name;
+    crrt_binary_file_index = 1 - crrt_binary_file_index;
+    crrt_file_is_open = true;
+
+    if (sd_is_active){
+        if (!binary_streams[crrt_binary_file_index].begin(&sd_object, &binary_files[crrt_binary_file_index]) && serial_debug_output_is_active)
+        {
+            Serial.println(F("file written through the file system"));
+        }
+    }
+
     // keep track of start of file time
     time_opening_crrt_file = micros();
 
+    // the new file starts with its header, an empty index, and its first check group
+    nbr_blocks_in_crrt_file = 0;
+    nbr_file_index_entries_used = 0;
+    file_index_types_seen = 0;
+    memset(&crrt_check_block, 0, sizeof(crrt_check_block));
+    write_file_header();
+
+    // how long the ADC blocks were left alone: ROTN,micros,next_file_was_ready
+    char rotation_message[48];
+    sprintf(rotation_message, "ROTN,%lu,%i", static_cast<unsigned long>(time_opening_crrt_file - micros_start), next_file_was_ready ? 1 : 0);
+    log_cstring(rotation_message);
+
+    if (serial_debug_output_is_active)
+    {
+        Serial.print(F("new file "));
+        Serial.println(filenames[crrt_binary_file_index]);
+        Serial.println(rotation_message);
+    }
+
     return true;
 }
 
@@ -500,18 +1556,297 @@ bool FastLogger::close_crrt_file()
         Serial.println(F("close crrt file"));
     }
 
+    flush_compressed_adc_blocks();
+    write_queued_log_blocks(true);
+
+    if (crrt_file_is_open){
+        write_file_index();
+        write_check_block(true);
+    }
+
+    bool result = true;
+
     if (sd_is_active){
-        if (!binary_file.close())
+        binary_streams[crrt_binary_file_index].end();
+
+        if (!binary_files[crrt_binary_file_index].close())
         {
             if (serial_debug_output_is_active)
             {
                 Serial.println(F("cannot close file"));
             }
+            result = false;
+        }
+
+        // the other file: the previous one if not closed yet, or the next one if already created, which is left
+        // empty so that the file numbers stay consecutive
+        int const other_file_index = 1 - crrt_binary_file_index;
+
+        if (next_file_step == NextFileStep::close_previous){
+            binary_streams[other_file_index].end();
+            binary_files[other_file_index].close();
+        }
+        else if ((next_file_step == NextFileStep::pre_allocate) || (next_file_step == NextFileStep::erase) || (next_file_step == NextFileStep::ready)){
+            binary_files[other_file_index].truncate(0);
+            binary_files[other_file_index].close();
+        }
+    }
+
+    crrt_file_is_open = false;
+    next_file_step = NextFileStep::choose_name;
+
+    return result;
+}
+
+// is this the check block of a group of a given file, fully written
+static bool check_block_is_valid(BlockCheckWithMetadata const & check_block, uint32_t file_number, uint32_t group_index){
+    return (check_block.metadata.metadata_id == make_metadata_id('K', 0))
+           && (check_block.file_number == file_number)
+           && (check_block.group_index == group_index)
+           && (check_block.nbr_blocks_covered < file_check_group_nbr_blocks)
+           && (check_block.crc == crc32(&check_block, offsetof(BlockCheckWithMetadata, crc)));
+}
+
+// a sector that was never written since pre-allocated and erased
+static bool block_is_erased(uint8_t const * block_start){
+    for (size_t crrt_byte = 1; crrt_byte < 512; crrt_byte++){
+        if (block_start[crrt_byte] != block_start[0]){
             return false;
         }
     }
 
-    return true;
+    return (block_start[0] == 0x00) || (block_start[0] == 0xFF);
+}
+
+void FastLogger::recover_last_files()
+{
+    // the file being written, and the previous (still being closed) or the next (being prepared) one
+    uint32_t const next_file_number = persistent_filenumber.get_file_number();
+
+    for (uint32_t crrt_file_number = (next_file_number >= 2) ? next_file_number - 2 : 0; crrt_file_number < next_file_number; crrt_file_number++){
+        recover_file(crrt_file_number);
+    }
+}
+
+int32_t FastLogger::recover_file(uint32_t file_number)
+{
+    char filename[14];
+    sprintf(filename, "F%08lu.bin", static_cast<unsigned long>(file_number));
+
+    file_t file;
+
+    if (!sd_object.exists(filename) || !file.open(filename, O_RDWR)){
+        return -1;
+    }
+
+    // at boot, the pool is all free
+    PoolBlock * const check_block_buffer = block_pool.take();
+    PoolBlock * const data_block_buffer = block_pool.take();
+
+    if ((check_block_buffer == nullptr) || (data_block_buffer == nullptr)){
+        if (check_block_buffer != nullptr){
+            block_pool.give_back(check_block_buffer);
+        }
+        if (data_block_buffer != nullptr){
+            block_pool.give_back(data_block_buffer);
+        }
+        file.close();
+        return -1;
+    }
+
+    BlockCheckWithMetadata const & check_block = check_block_buffer->check;
+
+    auto read_block = [&](uint32_t block_offset, PoolBlock * block_out) -> bool {
+        return file.seekSet(static_cast<uint64_t>(block_offset) << 9) && (file.read(block_out, 512) == 512);
+    };
+
+    constexpr uint32_t group_nbr_blocks = file_check_group_nbr_blocks;
+    uint32_t const nbr_blocks_in_file = static_cast<uint32_t>(file.fileSize() >> 9);
+
+    // -1: leave the file as it is
+    int32_t nbr_blocks_to_keep = -1;
+
+    if ((nbr_blocks_in_file > 0) && read_block(0, data_block_buffer)){
+        BlockHeaderWithMetadata const & header_block = data_block_buffer->header;
+
+        if ((header_block.metadata.metadata_id == make_metadata_id('H', 0)) && (header_block.format_version >= 2)
+            && (header_block.file_number == file_number) && (header_block.check_group_nbr_blocks == group_nbr_blocks)){
+            // the full groups [0, nbr_valid_groups) have their check block; the check blocks are written in order,
+            // so this is a binary search
+            uint32_t nbr_valid_groups = 0;
+            uint32_t first_invalid_group = nbr_blocks_in_file / group_nbr_blocks;
+
+            while (nbr_valid_groups < first_invalid_group){
+                uint32_t const crrt_group = (nbr_valid_groups + first_invalid_group) / 2;
+
+                if (read_block(crrt_group * group_nbr_blocks + group_nbr_blocks - 1, check_block_buffer)
+                    && check_block_is_valid(check_block, file_number, crrt_group)){
+                    nbr_valid_groups = crrt_group + 1;
+                }
+                else{
+                    first_invalid_group = crrt_group;
+                }
+            }
+
+            // the blocks of a group are written before its check block, but check the last group to be sure
+            while (nbr_valid_groups > 0){
+                uint32_t const first_block_offset = (nbr_valid_groups - 1) * group_nbr_blocks;
+                bool group_is_valid = read_block(first_block_offset + group_nbr_blocks - 1, check_block_buffer);
+
+                for (uint32_t crrt_block = 0; group_is_valid && (crrt_block < group_nbr_blocks - 1); crrt_block++){
+                    group_is_valid = read_block(first_block_offset + crrt_block, data_block_buffer)
+                                     && (crc32(data_block_buffer, 512) == check_block.block_crcs[crrt_block]);
+                }
+
+                if (group_is_valid){
+                    break;
+                }
+
+                nbr_valid_groups -= 1;
+            }
+
+            nbr_blocks_to_keep = nbr_valid_groups * group_nbr_blocks;
+
+            // after the last full group, only a final check block (the file was closed) makes the blocks valid
+            uint32_t crcs_after_last_group[group_nbr_blocks - 1];
+
+            for (uint32_t crrt_block = 0; crrt_block < group_nbr_blocks; crrt_block++){
+                uint32_t const crrt_block_offset = nbr_valid_groups * group_nbr_blocks + crrt_block;
+
+                if ((crrt_block_offset >= nbr_blocks_in_file) || !read_block(crrt_block_offset, data_block_buffer)){
+                    break;
+                }
+
+                BlockCheckWithMetadata const & final_check_block = data_block_buffer->check;
+
+                if (check_block_is_valid(final_check_block, file_number, nbr_valid_groups) && final_check_block.is_final
+                    && (final_check_block.nbr_blocks_covered == crrt_block)
+                    && (memcmp(final_check_block.block_crcs, crcs_after_last_group, crrt_block * sizeof(uint32_t)) == 0)){
+                    nbr_blocks_to_keep = crrt_block_offset + 1;
+                    break;
+                }
+
+                if (crrt_block < group_nbr_blocks - 1){
+                    crcs_after_last_group[crrt_block] = crc32(data_block_buffer, 512);
+                }
+            }
+        }
+        else if (block_is_erased(reinterpret_cast<uint8_t const *>(data_block_buffer))){
+            // the next file, prepared but not written to yet: left empty, as when closed normally
+            nbr_blocks_to_keep = 0;
+        }
+    }
+
+    bool const must_truncate = (nbr_blocks_to_keep >= 0) && (static_cast<uint32_t>(nbr_blocks_to_keep) < nbr_blocks_in_file);
+
+    if (must_truncate && !file.truncate(static_cast<uint64_t>(nbr_blocks_to_keep) << 9)){
+        nbr_blocks_to_keep = -1;
+    }
+
+    file.close();
+
+    block_pool.give_back(check_block_buffer);
+    block_pool.give_back(data_block_buffer);
+
+    // what was recovered: RCVR,file_number,nbr_blocks_kept,nbr_blocks_before
+    if (must_truncate){
+        char recovery_message[48];
+        sprintf(recovery_message, "RCVR,%lu,%li,%lu", static_cast<unsigned long>(file_number), static_cast<long>(nbr_blocks_to_keep),
+                static_cast<unsigned long>(nbr_blocks_in_file));
+        log_cstring(recovery_message);
+
+        if (serial_debug_output_is_active){
+            Serial.println(recovery_message);
+        }
+    }
+
+    return nbr_blocks_to_keep;
+}
+
+void FastLogger::log_overrun_telemetry()
+{
+    // each counter is a single 32 bits read, so consistent on its own, which is all that is needed here
+    char overrun_message[64];
+    sprintf(overrun_message, "OVRN,%u,%lu,%lu,%lu,%lu", static_cast<unsigned int>(adc_block_sequence_number),
+            static_cast<unsigned long>(adc_nbr_dropped_samples), static_cast<unsigned long>(adc_nbr_conversion_overruns),
+            static_cast<unsigned long>(nbr_dropped_chars), static_cast<unsigned long>(nbr_file_structure_failures));
+    log_cstring(overrun_message);
+
+    if (serial_debug_output_is_active){
+        Serial.println(overrun_message);
+    }
+}
+
+void FastLogger::reset_telemetry()
+{
+    micros_last_telemetry = micros();
+
+    sd_write_micros.reset();
+    internal_update_micros.reset();
+    internal_update_total_micros = 0;
+
+    block_pool.reset_min_nbr_free();
+    adc_full_queue.reset_max_size();
+    min_slack_micros = 0xFFFFFFFF;
+}
+
+bool FastLogger::write_telemetry_block()
+{
+    PoolBlock * new_block = block_pool.take();
+
+    // the period goes on, and is written next time
+    if (new_block == nullptr){
+        return false;
+    }
+
+    BlockTelemetryWithMetadata & telemetry_block = new_block->telemetry;
+    memset(&telemetry_block, 0, sizeof(telemetry_block));
+
+    telemetry_block.metadata.metadata_id = make_metadata_id('T', 0);
+    telemetry_block.metadata.block_number = telemetry_block_sequence_number;
+    telemetry_block.metadata.micros_start = micros_last_telemetry;
+    telemetry_block.metadata.micros_end = micros();
+    telemetry_block_sequence_number += 1;
+
+    telemetry_block.format_version = telemetry_format_version;
+    telemetry_block.nbr_histogram_buckets = nbr_telemetry_histogram_buckets;
+    telemetry_block.nbr_blocks_in_pool = static_cast<uint16_t>(nbr_blocks_in_pool);
+    telemetry_block.pool_min_nbr_free_blocks = static_cast<uint16_t>(block_pool.get_min_nbr_free());
+    telemetry_block.nbr_adc_block_sets_in_queue = static_cast<uint16_t>(nbr_adc_block_sets_in_pool);
+    telemetry_block.adc_queue_max_nbr_block_sets = static_cast<uint16_t>(adc_full_queue.get_max_size());
+
+    telemetry_block.nbr_blocks_written = sd_write_micros.get_nbr_values();
+    telemetry_block.sd_write_max_micros = sd_write_micros.get_max_value();
+    memcpy(telemetry_block.sd_write_micros_histogram, sd_write_micros.get_counts(), sizeof(telemetry_block.sd_write_micros_histogram));
+
+    telemetry_block.internal_update_total_micros = internal_update_total_micros;
+    telemetry_block.internal_update_max_micros = internal_update_micros.get_max_value();
+    memcpy(telemetry_block.internal_update_micros_histogram, internal_update_micros.get_counts(), sizeof(telemetry_block.internal_update_micros_histogram));
+
+    telemetry_block.adc_nbr_dropped_samples = adc_nbr_dropped_samples;
+    telemetry_block.adc_nbr_conversion_overruns = adc_nbr_conversion_overruns;
+    telemetry_block.nbr_dropped_chars = nbr_dropped_chars;
+    telemetry_block.nbr_dropped_records = nbr_dropped_records;
+    telemetry_block.min_slack_micros = min_slack_micros;
+
+    reset_telemetry();
+
+    if (serial_debug_output_is_active){
+        Serial.print(F("telemetry: max SD write "));
+        Serial.print(telemetry_block.sd_write_max_micros);
+        Serial.print(F(" us, min free pool blocks "));
+        Serial.print(telemetry_block.pool_min_nbr_free_blocks);
+        Serial.print(F(", max ADC queue "));
+        Serial.print(telemetry_block.adc_queue_max_nbr_block_sets);
+        Serial.print(F(", min slack "));
+        Serial.print(telemetry_block.min_slack_micros);
+        Serial.println(F(" us"));
+    }
+
+    bool const result = write_block_to_sd_card(&telemetry_block);
+    block_pool.give_back(new_block);
+
+    return result;
 }
 
 bool FastLogger::need_new_file()
@@ -7,6 +7,16 @@
 #include "SdFat.h"
 
 #include <params.h>
+#include <TimeSeriesAnalyzer.h>
+#include <CicDecimator.h>
+#include <StaLtaDetector.h>
+#include <RiceBlockCodec.h>
+#include <AdcTiming.h>
+#include <SdBlockStream.h>
+#include <PpsTimebase.h>
+#include <BlockPool.h>
+#include <Log2Histogram.h>
+#include <Crc32.h>
 
 
 ////////////////////////////////////////////////////////////
@@ -23,9 +33,11 @@
 
 // metadata is a 12 bytes sub-block
 struct BlockMetadata{
-    // source ID
+    // source ID: the low byte is the block type ('A', 'C', etc), the high byte is
+    // metadata_id_sequenced_flag | channel, see make_metadata_id
     uint16_t metadata_id;
-    // block number, to keep track of dropouts 
+    // block number, to keep track of dropouts: a sequence number incremented for each block of a given type and channel,
+    // so that any lost block shows as a gap; wraps at 2**16
     uint16_t block_number;
 
     // start and end of the block in micros
@@ -35,6 +47,14 @@ struct BlockMetadata{
 
 static_assert(sizeof(BlockMetadata) == 12);
 
+// the files written before the block numbers were sequence numbers had a zero high byte in metadata_id, and the
+// channel in block_number; this flag tells the parser that block_number is a sequence number
+constexpr uint16_t metadata_id_sequenced_flag = 0x8000;
+
+constexpr uint16_t make_metadata_id(char block_type, int channel){
+    return static_cast<uint16_t>(metadata_id_sequenced_flag | (static_cast<uint16_t>(channel & 0x7F) << 8) | static_cast<uint8_t>(block_type));
+}
+
 // a block of 512 bytes including metadata
 // data are: 250 uint16_t entries i.e. 500 bytes
 struct BlockADCWithMetadata{
@@ -55,18 +75,245 @@ struct BlockCharsWithMetadata{
 
 static_assert(sizeof(BlockCharsWithMetadata) == 512);
 
-////////////////////////////////////////////////////////////
-////////////////////////////////////////////////////////////
+// a block of 512 bytes including metadata
+// data are the samples of one ADC channel, compressed; see RiceBlockCodec.h for the layout, including the nbr of samples
+struct BlockCompressedADCWithMetadata{
+    BlockMetadata metadata;
+
+    uint8_t data[500];
+};
+
+static_assert(sizeof(BlockCompressedADCWithMetadata) == 512);
+
+// the durations in the telemetry are in micros; the last bucket is for 4s and more
+constexpr int nbr_telemetry_histogram_buckets = 24;
+using TelemetryHistogram = Log2Histogram<nbr_telemetry_histogram_buckets>;
+
+// the layout of the telemetry blocks, to be changed if anything below changes
+// 2: nbr_dropped_records
+// 3: min_slack_micros
+constexpr uint16_t telemetry_format_version = 3;
+
+// a block of 512 bytes including metadata, written every telemetry_period_seconds, to qualify SD cards and buffer sizes
+// micros_start and micros_end are the period covered; the histograms, maxima and minima are over that period, while the
+// loss counters are totals since start_recording (as in the OVRN messages)
+struct BlockTelemetryWithMetadata{
+    BlockMetadata metadata;
+
+    uint16_t format_version;
+    uint16_t nbr_histogram_buckets;
+    uint16_t nbr_blocks_in_pool;
+    uint16_t pool_min_nbr_free_blocks;
+    uint16_t nbr_adc_block_sets_in_queue;
+    uint16_t adc_queue_max_nbr_block_sets;
+
+    // the time taken by each block write, see TelemetryHistogram for the buckets
+    uint32_t nbr_blocks_written;
+    uint32_t sd_write_max_micros;
+    uint32_t sd_write_micros_histogram[nbr_telemetry_histogram_buckets];
+
+    // the time spent in each call to internal_update while logging
+    uint32_t internal_update_total_micros;
+    uint32_t internal_update_max_micros;
+    uint32_t internal_update_micros_histogram[nbr_telemetry_histogram_buckets];
+
+    uint32_t adc_nbr_dropped_samples;
+    uint32_t adc_nbr_conversion_overruns;
+    uint32_t nbr_dropped_chars;
+    uint32_t nbr_dropped_records;
+
+    // the lowest slack seen by internal_update, see FastLogger::get_min_slack_micros
+    uint32_t min_slack_micros;
+
+    uint8_t unused[260];
+};
+
+static_assert(sizeof(BlockTelemetryWithMetadata) == 512);
+
+// the layout of the F files, to be changed if the header, the index, or the layout of any block changes
+// 1: header and index blocks
+// 2: check blocks, see BlockCheckWithMetadata
+// 3: record blocks, see BlockRecordsWithMetadata
+constexpr uint16_t file_format_version = 3;
+
+constexpr int max_nbr_adc_channels_in_header = 16;
+static_assert(nbr_of_adc_channels <= max_nbr_adc_channels_in_header);
+
+// the flags of the file header
+constexpr uint16_t file_header_flag_adc_compression = 0b1 << 0;
+constexpr uint16_t file_header_flag_event_logging = 0b1 << 1;
+
+// a block of 512 bytes including metadata, the first block of each F file: what is needed to parse the file without
+// knowing how the logger was set up; micros_start and micros_end are when the file was opened
+struct BlockHeaderWithMetadata{
+    BlockMetadata metadata;
+
+    uint16_t format_version;
+    uint16_t nbr_adc_channels;
+    // the uC channel numbers, in the order of the channel field of the block ids
+    uint8_t adc_channels[max_nbr_adc_channels_in_header];
+
+    // the logged sampling frequency, and the actual ADC trigger frequency (including the oversampling and the
+    // rounding of the trigger timer)
+    uint32_t sampling_frequency;
+    uint32_t acquisition_frequency_mHz;
+    uint16_t adc_prescale;
+    uint16_t adc_oversampling_ratio;
+    uint32_t adc_timer_rc;
+    uint16_t adc_logged_bits;
+    uint16_t nbr_adc_measurements_per_block;
+
+    uint16_t flags;
+    uint16_t file_duration_seconds;
+    uint32_t file_number;
+
+    // the date and time FastLogger.cpp was compiled, as a null terminated string
+    char firmware_build[32];
+
+    // every check_group_nbr_blocks-th block of the file is a check block (from format version 2)
+    uint16_t check_group_nbr_blocks;
+    uint16_t unused_0;
+
+    uint8_t unused[416];
+};
+
+static_assert(sizeof(BlockHeaderWithMetadata) == 512);
+
+// where to find the blocks of a type around a given time: the block at block_offset (in 512 bytes blocks from the start
+// of the file) has this metadata_id, block_number and micros_start; the index has an entry every
+// file_duration / file_index_nbr_entries_per_type for each block type, so the blocks of a time window are found by
+// starting from the last entry of their type before the window, and reading on
+struct FileIndexEntry{
+    uint16_t metadata_id;
+    uint16_t block_number;
+    uint32_t block_offset;
+    uint32_t micros_start;
+};
+
+static_assert(sizeof(FileIndexEntry) == 12);
+
+constexpr int nbr_file_index_entries_per_block = 41;
+
+// a block of 512 bytes including metadata; the index blocks are the last blocks of each F file that was closed
+struct BlockIndexWithMetadata{
+    BlockMetadata metadata;
+
+    uint16_t nbr_entries;
+    uint16_t unused_0;
+    FileIndexEntry entries[nbr_file_index_entries_per_block];
+
+    uint8_t unused[4];
+};
+
+static_assert(sizeof(BlockIndexWithMetadata) == 512);
+
+// the blocks of the F files are checked in groups of file_check_group_nbr_blocks: the last block of each group, i.e. at
+// the offsets (in 512 bytes blocks from the start of the file) k * file_check_group_nbr_blocks + file_check_group_nbr_blocks - 1,
+// is a check block with the CRC32 (see Crc32.h) of each of the other blocks of the group; when a file is closed, a last
+// check block covers what is left after the last full group, and has is_final set
+// so the valid part of a file that was never closed (power loss) is found by a binary search on the check blocks,
+// without reading the rest of the file: these are written in order, and a check block that is not from this file
+// (erased sector, old data left by a previous file) does not have the right file_number and crc
+// block_number is group_index, wrapping at 2**16; micros_start is when the file was opened, micros_end when written
+struct BlockCheckWithMetadata{
+    BlockMetadata metadata;
+
+    uint32_t file_number;
+    uint32_t group_index;
+    uint16_t nbr_blocks_covered;
+    uint16_t is_final;
+    uint32_t block_crcs[file_check_group_nbr_blocks - 1];
+
+    uint8_t unused[512 - 12 - 12 - 4 * (file_check_group_nbr_blocks - 1) - 4];
+
+    // the CRC32 of all the above
+    uint32_t crc;
+};
+
+static_assert(sizeof(BlockCheckWithMetadata) == 512);
+
+// the auxiliary data (stats, temperatures, sonar) are logged as binary records, i.e. fixed layout structs copied as
+// they are, rather than formatted as text: no printf of floats in the main loop, less data, and the host reads them
+// with a struct layout
+// each record is a RecordHeader followed by the record struct; the struct has no implicit padding, its size is a
+// multiple of 4, and it has a record_tag, unique among:
+// - 'S': ChannelStatsRecord (below)
+// - 'T': TemperaturesRecord (TemperatureSensors.h)
+// - 'D': SonarRecord (SonarManager.h)
+// - 'P': SonarProfileRecord (SonarManager.h)
+// - 'U': AdcUtcRecord (below)
+// - 'Z': TimebaseRecord (PpsTimebase.h)
+// a layout change needs a new file_format_version, and the parser (BinaryParser.py, dict_record_layouts) to follow
+struct RecordHeader{
+    uint8_t tag;
+    // the size of the record struct, after this header
+    uint8_t nbr_bytes;
+    uint16_t unused;
+    // when the record was logged
+    uint32_t micros;
+};
+
+static_assert(sizeof(RecordHeader) == 8);
+
+constexpr size_t nbr_record_bytes_per_block = 500;
+
+// a block of 512 bytes including metadata, holding records one after the other; a record is never split between
+// blocks, and the bytes after the last record are 0s (i.e. a 0 tag)
+// micros_start is when the first record was logged, micros_end when the block was written
+struct BlockRecordsWithMetadata{
+    BlockMetadata metadata;
+
+    uint8_t data[nbr_record_bytes_per_block];
+};
 
-// a struct containing statistics about a time series
-struct TimeSeriesStatistics{
-    double mean; // mean(X)
-    double mean_of_square; // mean(X**2)
-    double max; // max value reached
-    double min; // min value reached
-    unsigned long extremal_count; // nbr of readings over or under mean +- percent_threshold
+static_assert(sizeof(BlockRecordsWithMetadata) == 512);
+
+// the statistics of an ADC channel over nbr_of_seconds_per_analysis, as the exact integer sums (see
+// TimeSeriesIntegerStatistics), from which the host gets the means, std, etc
+struct ChannelStatsRecord{
+    static constexpr uint8_t record_tag = 'S';
+
+    uint16_t channel;
+    uint16_t unused_0;
+    uint32_t nbr_samples;
+    int64_t sum;
+    int64_t sum_of_squares;
+    int32_t max;
+    int32_t min;
+    uint32_t extremal_count;
+    uint32_t unused_1;
 };
 
+static_assert(sizeof(ChannelStatsRecord) == 40);
+
+// the UTC time of an ADC block set, from the PPS timebase (see FastLogger::set_timebase): block_number and micros_start
+// are those of the metadata of the blocks of the set (all the channels have the same), utc_micros_start the UTC time of
+// micros_start, in micros since the Unix epoch; only logged while the timebase is valid
+struct AdcUtcRecord{
+    static constexpr uint8_t record_tag = 'U';
+
+    uint16_t block_number;
+    uint16_t unused;
+    uint32_t micros_start;
+    int64_t utc_micros_start;
+};
+
+static_assert(sizeof(AdcUtcRecord) == 16);
+
+// any of the blocks above; this is what the block pool hands out, whatever the block type
+union PoolBlock{
+    BlockADCWithMetadata adc;
+    BlockCharsWithMetadata chars;
+    BlockCompressedADCWithMetadata compressed;
+    BlockTelemetryWithMetadata telemetry;
+    BlockHeaderWithMetadata header;
+    BlockIndexWithMetadata index;
+    BlockCheckWithMetadata check;
+    BlockRecordsWithMetadata records;
+};
+
+static_assert(sizeof(PoolBlock) == 512);
+
 ////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////
 
@@ -74,20 +321,105 @@ struct TimeSeriesStatistics{
 // TODO: read about ISRs, classes, etc
 // TODO: ask for explanation why did not work in SO issue
 
-constexpr int nbr_blocks_per_adc_channel = 16;
-
 constexpr int nbr_adc_measurements_per_block = 250;
 
-extern volatile bool blocks_to_write[nbr_blocks_per_adc_channel];
-
-extern volatile int crrt_adc_block_index_to_write;
 extern volatile int crrt_adc_data_index_to_write;
+// the nbr of times the ADC itself overwrote a conversion that was not read yet, i.e. the ISR did not keep up;
+// each is at least one lost sample
+extern volatile uint32_t adc_nbr_conversion_overruns;
+
+// the PDC (DMA) buffers, used only when adc_use_pdc
+// each buffer holds one full block worth of scans, i.e. nbr_adc_measurements_per_block scans of all channels, interleaved
+// while the PDC fills one buffer, the next one is already chained in ADC_RNPR, and the last one can be de-interleaved
+constexpr int nbr_adc_pdc_buffers = 3;
+constexpr int nbr_adc_pdc_values_per_buffer = nbr_adc_measurements_per_block * nbr_of_adc_channels;
+
+extern volatile uint16_t adc_pdc_buffers[nbr_adc_pdc_buffers][nbr_adc_pdc_values_per_buffer];
+
+// all the blocks (ADC, chars, etc) come from a single pool, so that whichever producer needs more buffering at a given
+// time can use it: the SRAM left by the rest of the firmware (see params.h) and by the PDC buffers, less the free
+// stack links of the pool
+constexpr size_t block_pool_nbr_bytes = sram_nbr_bytes - sram_nbr_bytes_reserved - sizeof(adc_pdc_buffers);
+constexpr size_t nbr_blocks_in_pool = block_pool_nbr_bytes / (sizeof(PoolBlock) + sizeof(uint16_t));
+
+extern BlockPool<PoolBlock, nbr_blocks_in_pool> block_pool;
+
+// the ISR fills one ADC block per channel at a time, taken together from the pool at the start of each block period,
+// and hands them together to the main loop once full
+struct AdcBlockSet{
+    BlockADCWithMetadata * blocks[nbr_of_adc_channels];
+};
+
+constexpr int nbr_adc_block_sets_in_pool = nbr_blocks_in_pool / nbr_of_adc_channels;
+static_assert(nbr_adc_block_sets_in_pool >= 4, "the block pool is too small for the nbr of ADC channels");
+static_assert(scheduler_min_slack_block_sets < nbr_adc_block_sets_in_pool, "the deferred work would never run");
+
+// the completed ADC block sets, waiting for the main loop; as long as the pool, so never full
+extern SpscQueue<AdcBlockSet, nbr_adc_block_sets_in_pool> adc_full_queue;
+
+// take one block per channel from the pool; return false, taking nothing, if the pool runs out
+bool take_adc_block_set(AdcBlockSet & block_set);
+
+// give the blocks of a set back to the pool
+void give_back_adc_block_set(AdcBlockSet const & block_set);
+
+// is any completed ADC block set still waiting for the main loop
+bool adc_blocks_are_pending();
+
+// the loss accounting, kept by the ISR
+// the sequence number given to the next completed ADC block, the same for all channels
+extern volatile uint16_t adc_block_sequence_number;
+// the nbr of samples (per channel) lost because the pool had no free blocks at the start of their block period, i.e.
+// the SD card or the main loop did not keep up; the sequence numbers of the lost blocks are skipped
+extern volatile uint32_t adc_nbr_dropped_samples;
+
+// when oversampling, a PDC buffer still holds nbr_adc_measurements_per_block scans, which the per channel decimators
+// turn into nbr_adc_values_per_pdc_buffer logged values; adc_oversampling_ratio PDC buffers fill one ADC block exactly
+static_assert(nbr_adc_measurements_per_block % adc_oversampling_ratio == 0, "the oversampling ratio must divide the block size");
+constexpr int nbr_adc_values_per_pdc_buffer = nbr_adc_measurements_per_block / adc_oversampling_ratio;
 
-extern volatile BlockADCWithMetadata blocks_adc_with_metdata[nbr_of_adc_channels][nbr_blocks_per_adc_channel];
+using AdcDecimator = CicDecimator<adc_cic_order, adc_oversampling_ratio>;
+extern AdcDecimator adc_decimators[nbr_of_adc_channels];
+
+// the sampling frequency can be changed at runtime (see FastLogger::request_sampling_frequency), so the ADC timing and
+// everything derived from it are variables; they are only changed while the ADC is stopped
+extern int adc_crrt_sampling_frequency;
+extern AdcTiming adc_crrt_timing;
+
+// duration between the first and the last logged sample of a block, used to timestamp the PDC blocks at completion
+extern unsigned long adc_block_span_micros;
+
+// the boot frequency must be reachable
+static_assert(compute_adc_timing(F_CPU, adc_acquisition_frequency, nbr_of_adc_channels).valid, "adc_sampling_frequency cannot be reached with these channels");
+
+// the nbr of ADC blocks (per channel) covering a duration at the current sampling frequency, rounded up
+int nbr_adc_blocks_for_seconds(float nbr_seconds);
+
+// event logging, see params.h; all durations are counted in ADC blocks, and depend on the sampling frequency
+// the pre trigger blocks are the last processed ADC block sets, kept out of the pool until they are too old; the ISR
+// is filling one more set, and at least one more is left spare for the next block period
+constexpr int event_max_nbr_pretrigger_blocks = nbr_adc_block_sets_in_pool - 3;
+
+// the pre trigger only uses idle pool capacity: its oldest blocks are given back as soon as the pool runs lower
+constexpr int event_pretrigger_min_nbr_free_pool_blocks = 2 * nbr_of_adc_channels + 2;
+
+// the decimated 'D' blocks have the same layout as the ADC blocks; event_decimation_ratio ADC blocks fill one of them
+static_assert(nbr_adc_measurements_per_block % event_decimation_ratio == 0, "the event decimation ratio must divide the block size");
+constexpr int nbr_decimated_values_per_adc_block = nbr_adc_measurements_per_block / event_decimation_ratio;
+
+using EventDecimator = CicDecimator<event_decimation_cic_order, event_decimation_ratio, adc_logged_bits>;
+
+// set the sampling frequency and the matching ADC prescaler and timer RC, to be used by the next adc_setup and tc_setup
+// return false, and change nothing, if the frequency cannot be reached with the nbr of channels
+bool adc_set_sampling_frequency(int sampling_frequency);
+
+// stop the trigger timer, the ADC interrupt and the PDC, so that the ADC can be set up again
+void adc_stop();
 
 // start ADC conversion on rising edge on time counter 0 channel 2
 // perform ADC conversion on several adc_channels in a row one after the other
-// report finished conversion using ADC interrupt
+// report finished conversion using ADC interrupt; if adc_use_pdc, the conversions are moved by the PDC
+// and the interrupt only fires once a full block of scans is available
 void adc_setup();
 
 // use time counter 0 channel 2 to generate the ADC start of conversion signal
@@ -100,45 +432,9 @@ void tc_setup();
 // push the current ADC data on all adc_channels to the buffer
 // update the time index
 // set flag conversion ready
+// if adc_use_pdc, this is called once per full PDC buffer: chain the next PDC buffer and de-interleave the full one
 void ADC_Handler();
 
-// a class to take care of tracking time series statistics
-// this will "eat" readings from an ADC channel, and generate on-the-fly stats about this channel
-// the stats are the ones descrived in the TimeSeriesStatistics
-// an updated stat struct is made available regularly, as soon as fully computed
-class TimeSeriesAnalyzer{
-    public:
-        void init(void);
-
-        // is there a stat struct available readily computed?
-        bool stats_are_available(void) const;
-
-        // get access to the computed stat struct available, and reset the availability flag
-        TimeSeriesStatistics const & get_stats(void);
-
-        // register a new value inside the current building stat
-        void register_value(int value_in);
-
-    private:
-        // if an unread TimeSeriesStatistics is available
-        bool flag_stats_available;
-
-        // how many points we have currently been registering into the stat under building
-        int crrt_nbr_registered_values;
-
-        // reset the stat under buildind and the nbr of registered values
-        void reset_filling_stats(void);
-
-        // the stats under building
-        TimeSeriesStatistics crrt_filling_stats;
-
-        // the available stat
-        TimeSeriesStatistics available_stats;
-};
-
-// return the position where the next write must be done
-int write_statistics(char * buffer, TimeSeriesStatistics const & to_dump);
-
 // the wrapper class for simple user interface
 // this will allow to log fast both chars and ADC channels
 class FastLogger
@@ -161,10 +457,42 @@ public:
     // NOTE that the char ";" is used as a delimiter internally, so cannot be part of the cstring!
     void log_cstring(const char * cstring_start);
 
+    // as log_cstring, for chars that are not a cstring, possibly in 2 parts (e.g. wrapping around the end of a ring
+    // buffer, see NmeaSentenceView): they are logged as one message, straight from where they are
+    void log_message(char const * chars, size_t nbr_chars, char const * chars_continued = nullptr, size_t nbr_chars_continued = 0);
+
+    // append chars to the char blocks, as many at a time as fit in the current block; if replace_delimiter, the ";"
+    // are logged as ":"
+    void log_chars(char const * chars, size_t nbr_chars, bool replace_delimiter);
+
+    // log a binary record to the record blocks, see RecordHeader; Record is one of the record structs
+    template <typename Record>
+    void log_record(Record const & record){
+        static_assert((sizeof(Record) % 4 == 0) && (sizeof(RecordHeader) + sizeof(Record) <= nbr_record_bytes_per_block),
+                      "a record must keep the next one aligned, and fit in a block");
+        static_assert(sizeof(Record) <= UINT8_MAX, "the size of a record must fit in RecordHeader::nbr_bytes");
+        log_record_bytes(Record::record_tag, &record, sizeof(Record));
+    }
+
     // perform necessary internal requests, such as updating file number, dumping to SD card etc
     // must be called in the main loop at regular intervals
     void internal_update();
 
+    // ask for a new sampling frequency; it takes effect when the next file is opened, so that each file has a single
+    // sampling frequency; return false if the frequency cannot be reached with the nbr of channels
+    bool request_sampling_frequency(int sampling_frequency);
+
+    // the sampling frequency of the current file
+    int get_sampling_frequency();
+
+    // the slack is how long the ADC can go on with the free blocks of the pool, if nothing more gets written; this is
+    // the lowest seen by internal_update since the last telemetry block, in micros; a slack that goes down to one block
+    // period or so means that the sampling frequency is about as high as the SD card allows
+    uint32_t get_min_slack_micros() const;
+
+    // stamp each ADC block set with its UTC time from timebase, as an AdcUtcRecord; nullptr to stop
+    void set_timebase(PpsTimebase const * timebase);
+
     // enable Serial debug output on the "USB" serial
     void enable_serial_debug_output();
 
@@ -188,44 +516,263 @@ private:
 
     bool serial_debug_output_is_active = false;
 
+    // the UTC time of the ADC blocks, if any
+    PpsTimebase const * timebase = nullptr;
+
+    // the sampling frequency to use from the next file on
+    int requested_sampling_frequency = adc_sampling_frequency;
+
+    // the loss accounting and performance telemetry
+    static constexpr unsigned long telemetry_period_milliseconds = 1000UL * telemetry_period_seconds;
+    unsigned long time_last_telemetry = 0;
+    unsigned long micros_last_telemetry = 0;
+
+    // the scheduling of internal_update, see scheduler_min_slack_block_sets
+    uint32_t adc_block_period_micros = 0;
+    uint32_t min_slack_micros = 0xFFFFFFFF;
+    uint16_t telemetry_block_sequence_number = 0;
+
+    TelemetryHistogram sd_write_micros;
+    TelemetryHistogram internal_update_micros;
+    uint32_t internal_update_total_micros = 0;
+
     // the properties for char logging
-    static constexpr int nbr_blocks_char = 2;
-    BlockCharsWithMetadata blocks_cstring_with_metadata[nbr_blocks_char];
+    // the block being filled is taken from the pool at the first char, and given back once written
+    BlockCharsWithMetadata * crrt_char_block = nullptr;
 
     static constexpr int nbr_chars_per_block = 500;
 
-    int crrt_char_block_index_to_write = 0;
+    // the longest cstring logged, in case it is not 0 terminated
+    static constexpr size_t max_cstring_length = 1025;
+
     int crrt_char_data_index_to_write = 0;
+    uint16_t char_block_sequence_number = 0;
+
+    // the chars lost because the pool had no free block, or the write queue no room
+    uint32_t nbr_dropped_chars = 0;
+
+    // the properties for record logging, as for the chars
+    BlockRecordsWithMetadata * crrt_record_block = nullptr;
+    size_t crrt_record_data_index_to_write = 0;
+    // the records in the current block, to be counted as dropped if the block is
+    uint32_t crrt_record_block_nbr_records = 0;
+    uint16_t record_block_sequence_number = 0;
+    uint32_t nbr_dropped_records = 0;
+
+    // the full char and record blocks, waiting for internal_update to write them; only used from the main loop
+    SpscQueue<PoolBlock *, log_write_queue_nbr_blocks> log_write_queue;
+
+    // the properties for compressed ADC logging
+    // a compressed block gets samples from several ADC blocks, so it is filled in the main loop and lives here
+    BlockCompressedADCWithMetadata blocks_compressed_with_metadata[nbr_of_adc_channels];
+    RiceBlockEncoder rice_encoders[nbr_of_adc_channels];
+    uint16_t compressed_block_sequence_numbers[nbr_of_adc_channels] = {0};
+
+    // the properties for event logging
+    // the decimated blocks are only used in the main loop, so they live here rather than with the ISR blocks
+    BlockADCWithMetadata blocks_decimated_with_metadata[nbr_of_adc_channels];
+    EventDecimator event_decimators[nbr_of_adc_channels];
+    int crrt_decimated_data_index_to_write = 0;
+    uint16_t decimated_block_sequence_number = 0;
+
+    // the last processed ADC block sets that are not in an event file yet, oldest first, for the pre trigger
+    SpscQueue<AdcBlockSet, event_max_nbr_pretrigger_blocks> pretrigger_block_sets;
+
+    bool event_file_is_open = false;
+    int crrt_event_nbr_blocks = 0;
+    int crrt_event_nbr_quiet_blocks = 0;
+
+    // the event durations in ADC blocks, for the current sampling frequency
+    int event_nbr_pretrigger_blocks = 0;
+    int event_nbr_posttrigger_blocks = 0;
+    int event_max_nbr_blocks = 0;
 
     // the Sd interfacing and some SD file properties
 
     sd_t sd_object;
-    file_t binary_file;
+    file_t event_file;
+
+    // the F files are used in turn: binary_files[crrt_binary_file_index] is being written, while the other one is
+    // first the previous file, still being closed, and then the next file, being prepared
+    // all the blocks go to the files through the streams
+    file_t binary_files[2];
+    SdBlockStream binary_streams[2];
+    char filenames[2][14] = {"F00000000.bin", "F00000000.bin"};
+    uint32_t file_numbers[2] = {0, 0};
+    int crrt_binary_file_index = 0;
+    bool crrt_file_is_open = false;
+
+    SdBlockStream event_stream;
+
+    // getting the next file ready takes several SD card and flash operations; rather than doing them all when the
+    // file must be switched, while the ADC blocks pile up, they are done one per idle call to internal_update
+    enum class NextFileStep{
+        close_previous,     // end and close the previous file
+        choose_name,        // take the next file number (written to flash)
+        check_name,         // check that no such file exists yet
+        open,
+        pre_allocate,       // for requested_sampling_frequency; done again if it changes
+        erase,              // erase the pre-allocated sectors, sd_nbr_sectors_erased_per_step at a time
+        ready
+    };
+    NextFileStep next_file_step = NextFileStep::choose_name;
+    int next_file_sampling_frequency = 0;
+    uint32_t next_file_crrt_erase_sector = 0;
+    uint32_t next_file_last_erase_sector = 0;
+
+    char event_filename[14] = "E00000000.bin";
+    uint32_t event_file_number = 0;
 
-    char filename[14] = "F00000000.bin";
     static constexpr int nbr_of_zeros_in_filename = 8;
 
-    // the pre-allocated size in bytes; we count in number of 512 bytes blocks (2**9 = 512)
-    // the number of blocks is the sum of how many chars logging blocks, and how many ADC blocks
-    // to be on the safe side, be a bit generous
-    static constexpr uint64_t preallocate_nbr_blocks = file_duration_seconds * adc_sampling_frequency / nbr_adc_measurements_per_block
-                                                           + file_duration_seconds * 2 + 10;
-    static constexpr uint64_t preallocate_size = preallocate_nbr_blocks << 9;
+    // the index of the current file, written as its last blocks when it is closed
+    static constexpr int nbr_file_index_entries = file_index_nbr_blocks * nbr_file_index_entries_per_block;
+    static constexpr unsigned long file_index_period_micros = file_duration_microseconds / file_index_nbr_entries_per_type;
+    FileIndexEntry file_index_entries[nbr_file_index_entries];
+    int nbr_file_index_entries_used = 0;
+    uint32_t nbr_blocks_in_crrt_file = 0;
+
+    // per block type ('A' to 'Z'), if it is in the index yet, and when its last entry starts
+    uint32_t file_index_types_seen = 0;
+    unsigned long file_index_last_micros[26];
+
+    // the check block of the current group of the current file, getting the CRCs of the blocks as they are written
+    // it lives here rather than in the pool, as a missing check block would make the rest of the file look invalid
+    BlockCheckWithMetadata crrt_check_block;
 
-    // write a block, i.e. the next 512 bytes, to the SD card
+    // the header and index blocks are built here too, as they are written at a switch, when the ADC blocks may have
+    // taken all of the pool; they are never built at the same time, so they share the block
+    PoolBlock file_structure_block;
+
+    // the header and index blocks that could not be written, since start_recording
+    uint32_t nbr_file_structure_failures = 0;
+
+    // the pre-allocated size in bytes of a file logged at sampling_frequency; we count in number of 512 bytes blocks
+    // (2**9 = 512); the number of blocks is the sum of how many chars logging blocks, and how many ADC blocks of all
+    // channels; to be on the safe side, be a bit generous
+    uint64_t file_preallocate_size(int sampling_frequency) const;
+
+    // an event file holds at most the pre trigger and event_max_nbr_blocks, for all channels
+    uint64_t event_preallocate_size = 0;
+
+    // apply the requested sampling frequency to the ADC settings, and update all the properties that depend on it
+    void apply_sampling_frequency();
+
+    // reset the analyzers, encoders, detectors, etc, before starting to log data into a new file
+    void init_processing();
+
+    // process the ADC blocks the ISR has completed: write them, feed them to the analyzers, and give them back to the
+    // pool (or keep them for the pre trigger)
+    // unless drain, stop as soon as the card is busy, rather than waiting for it: the blocks are still there next time
+    void process_available_adc_blocks(bool drain = false);
+
+    // stop the ADC, and restart it at the requested sampling frequency with a new file
+    void change_sampling_frequency();
+
+    // the current slack (see get_min_slack_micros), in block periods; the pre trigger block sets count as free, as
+    // they are given back as soon as the pool runs low
+    int get_slack_block_sets();
+
+    // log the stats of the ADC channels that have new ones
+    void log_available_stats();
+
+    // hand the current char block, full, to the write queue
+    void queue_crrt_char_block();
+
+    // the part of log_record that does not depend on the record type
+    void log_record_bytes(uint8_t tag, void const * record, size_t nbr_bytes);
+
+    // hand the current record block to the write queue
+    void queue_crrt_record_block();
+
+    // put a full char or record block in the write queue; if the queue is full, the block is given back to the pool,
+    // and false returned for the caller to count what was dropped, as the producers never wait for the SD card
+    bool queue_log_block(PoolBlock * block);
+
+    // write the queued char and record blocks, and give them back to the pool
+    // unless drain, stop as soon as the card is busy, as for the ADC blocks
+    void write_queued_log_blocks(bool drain = false);
+
+    // write a block, i.e. the next 512 bytes, to the SD card, i.e. to the current file, and keep track of it in the
+    // file index
     bool write_block_to_sd_card(void * block_start);
 
+    // add the block about to be written at nbr_blocks_in_crrt_file to the file index, if its type is due an entry
+    void register_in_file_index(BlockMetadata const & metadata);
+
+    // write the header block of the file that was just switched to; a failure is counted in
+    // nbr_file_structure_failures
+    bool write_file_header();
+
+    // write the index blocks, at the end of the current file; a failure is counted as for the header
+    bool write_file_index();
+
+    // write the check block of the current group, once full or, with is_final, when the file is closed; start the
+    // next group
+    bool write_check_block(bool is_final);
+
+    // at boot, find where the last files written before the reboot end (see BlockCheckWithMetadata), and truncate
+    // them there, so that a power loss does not leave files with a pre-allocated tail of undefined content
+    void recover_last_files();
+
+    // same, for one file; return the nbr of blocks kept, or -1 if the file was left as is
+    int32_t recover_file(uint32_t file_number);
+
+    // same, to a given stream
+    bool write_block_to_stream(SdBlockStream & stream, void * block_start);
+
     // write the blocks for all active ADC channels
-    bool write_adc_blocks_to_sd_card(int adc_blocks_index);
+    bool write_adc_blocks_to_sd_card(AdcBlockSet const & block_set);
+
+    // compress the blocks for all active ADC channels, and write the compressed blocks once full
+    bool write_compressed_adc_blocks_to_sd_card(AdcBlockSet const & block_set);
+
+    // write the compressed block of a channel, even if not full, and start a new one
+    bool flush_compressed_adc_block(int adc_channel);
+
+    // same, for all the channels that have samples in their compressed block
+    void flush_compressed_adc_blocks();
+
+    // event logging: run the detectors on a completed ADC block set, write its decimated data, and write it to the
+    // event file if within an event; return true if it was written to an event file
+    bool process_adc_blocks_for_events(AdcBlockSet const & block_set);
+
+    // keep a processed ADC block set for the pre trigger of a next event, giving back the ones no longer needed
+    void keep_for_pretrigger(AdcBlockSet const & block_set);
 
-    // open and start logging on a new file
-    bool open_new_file();
+    // give back all the block sets kept for the pre trigger
+    void release_pretrigger_block_sets();
 
-    // close the current file
+    // feed the ADC blocks to the decimators, and write the decimated blocks once full
+    void write_decimated_adc_blocks(AdcBlockSet const & block_set);
+
+    // open a new event file, and write the pre trigger block sets to it
+    bool open_event_file();
+
+    // close the current event file
+    bool close_event_file();
+
+    // do the next step of getting the next file ready; return true once it is ready
+    bool prepare_next_file_step();
+
+    // switch to the next file, finishing to get it ready first if the idle calls were not enough, and log how long
+    // the switch took as a ROTN message
+    bool switch_to_next_file();
+
+    // close the current file, and the other one, for stopping
     bool close_crrt_file();
 
     // check if a new file is needed because of timer
     bool need_new_file();
+
+    // log the loss accounting counters, as an OVRN message
+    void log_overrun_telemetry();
+
+    // start a new telemetry period
+    void reset_telemetry();
+
+    // write the telemetry of the period that just ended as a 'T' block, and start a new period
+    bool write_telemetry_block();
 };
 
 #endif // FAST_LOGGER
\ No newline at end of file
@@ -10,7 +10,8 @@ void ISR_pps(void){
 
 bool GPSManager::pps_available(void){
     if (pps_read_available){
-        sprintf(&pps_message_buffer[4], "%010lu", pps_micros);
+        last_pps_micros = pps_micros;
+        sprintf(&pps_message_buffer[4], "%010lu", last_pps_micros);
     }
     return pps_read_available;
 }
@@ -23,9 +24,11 @@ char * GPSManager::get_pps_message(void){
     return pps_message_buffer;
 }
 
-void GPSManager::start_gps(void){
-    // TODO: init all buffers to \0
+unsigned long GPSManager::get_pps_micros(void) const{
+    return last_pps_micros;
+}
 
+void GPSManager::start_gps(void){
     adafruit_gps = Adafruit_GPS(serial_gps);
     adafruit_gps.begin(9600);
 
@@ -37,6 +40,12 @@ void GPSManager::start_gps(void){
     adafruit_gps.sendCommand(PMTK_SET_NMEA_UPDATE_1HZ);   // 1 Hz update rate
     adafruit_gps.sendCommand(PMTK_API_SET_FIX_CTL_1HZ);
 
+    // let the commands go out, then take over the receive side of the serial
+    serial_gps->flush();
+    usart_rx_ring.begin(selected_gps_usart, rx_ring, gps_rx_ring_nbr_chars);
+    nmea_framer.init(rx_ring, gps_rx_ring_nbr_chars);
+    nbr_chars_received = 0;
+
     // prepare the PPS pin
     pinMode(pps_pin, INPUT);
     attachInterrupt(digitalPinToInterrupt(pps_pin), ISR_pps, RISING);
@@ -45,10 +54,6 @@ void GPSManager::start_gps(void){
         pps_message_buffer[i] = '\0';
     }
 
-    for (size_t i=0; i<size_message_buffer; i++){
-        message_buffer[i] = '\0';
-    }
-
     pps_message_buffer[0] = 'P';
     pps_message_buffer[1] = 'P';
     pps_message_buffer[2] = 'S';
@@ -56,40 +61,22 @@ void GPSManager::start_gps(void){
     pps_message_buffer[14] = ';';
     pps_message_buffer[15] = '\0';
 
-    buffer_tail = 0;
     message_is_available = false;
 }
 
 void GPSManager::update_status(void){
-    if (!message_is_available){
-        while (serial_gps->available() > 0){
-            if (buffer_tail < size_message_buffer-1){
-                char crrt_char = serial_gps->read();
-                message_buffer[buffer_tail] = crrt_char;
-                buffer_tail += 1;
-
-                if (crrt_char == '\n'){
-                    message_is_available = true;
-                }
-            } 
-            else{
-                if (use_serial_debug_output){
-                    Serial.println(F("full GPS buffer, flush"));
-                }
-                // flush serial input buffer
-                while (serial_gps->available() > 0){
-                    serial_gps->read();
-                }
-                // reset buffer
-                buffer_tail = 0;
-            }
-        }
-    }
+    nbr_chars_received = usart_rx_ring.update();
 }
 
 bool GPSManager::message_available(void){
-    if (use_serial_debug_output && message_is_available){
-        Serial.print(message_buffer);
+    if (!message_is_available){
+        message_is_available = nmea_framer.find_sentence(nbr_chars_received, crrt_sentence);
+
+        if (use_serial_debug_output && message_is_available){
+            Serial.write(crrt_sentence.chars, crrt_sentence.nbr_chars);
+            Serial.write(crrt_sentence.chars_continued, crrt_sentence.nbr_chars_continued);
+            Serial.println();
+        }
     }
 
     return message_is_available;
@@ -99,10 +86,7 @@ void GPSManager::enable_serial_debug_output(void){
     use_serial_debug_output = true;
 }
 
-char * GPSManager::get_message(void){
-    message_buffer[buffer_tail] = '\0';
-    buffer_tail = 0;
+NmeaSentenceView const & GPSManager::get_message(void){
     message_is_available = false;
-    
-    return message_buffer;
-}
\ No newline at end of file
+    return crrt_sentence;
+}
@@ -1,49 +1,50 @@
-// start
-// set serial port rx
-// set PPS pin: any pin on the due
-// all messages are cstrings
-// function message_available, including PPS
-// get pointer to available message
-// TODO: make sure larger buffer on GPS serial receive
-
-// available_message: check PPS, check serial, generate message, return bool
-// get_message: pointer to the cstring message, anc reset
-// have an internal "ready to send message" cstring buffer, length 256 bytes
+// the GPS: its NMEA sentences, and the PPS
+// the GPS chars are received by the PDC into a ring (UsartRxRing), and the sentences are framed and checked in place
+// in the ring (NmeaFramer), so that they can be logged from there without any copy; the main loop being busy for a
+// while, for example with the SD card, does not lose any sentence, as long as it comes back within a ring of chars
+// the PPS is timestamped by its interrupt, and given as a cstring message
 
 #ifndef GPS_MANAGER
 #define GPS_MANAGER
 
 #include "params.h"
 #include "Adafruit_GPS.h"
-
-// make sure buffers are big enough
-// if necessary, modify in the core
-static_assert(SERIAL_BUFFER_SIZE >= 512);
+#include "UsartRxRing.h"
+#include "NmeaFramer.h"
 
 class GPSManager{
     public:
         void start_gps(void);
 
+        // look at the chars received since the last call
         void update_status(void);
 
+        // is there one more sentence with a valid checksum in the chars looked at by update_status
         bool message_available(void);
 
-        char * get_message(void);
+        // the sentence, valid until the next call to update_status
+        NmeaSentenceView const & get_message(void);
 
         bool pps_available(void);
 
         char * get_pps_message(void);
 
+        // the micros of the PPS edge of the last pps_available
+        unsigned long get_pps_micros(void) const;
+
         void enable_serial_debug_output(void);
 
     private:
         bool use_serial_debug_output = false;
-        static constexpr int size_message_buffer = 1024;
-        char message_buffer[size_message_buffer];
         static constexpr int size_pps_message_buffer = 3 + 1 + 10 + 2 + 16 + 32;
         char pps_message_buffer[size_pps_message_buffer];
+        unsigned long last_pps_micros = 0;
         bool message_is_available = false;
-        size_t buffer_tail;
+        char rx_ring[gps_rx_ring_nbr_chars];
+        UsartRxRing usart_rx_ring;
+        NmeaFramer nmea_framer;
+        uint32_t nbr_chars_received = 0;
+        NmeaSentenceView crrt_sentence;
         HardwareSerial * serial_gps = selected_gps_serial;
         uint8_t pps_pin = selected_PPS_digital_pin;
         Adafruit_GPS adafruit_gps;
@@ -0,0 +1,68 @@
+#ifndef LOG2_HISTOGRAM
+#define LOG2_HISTOGRAM
+
+#include <stdint.h>
+#include <stddef.h>
+
+// a histogram of durations (or any other non negative values) in log2 buckets, cheap enough to fill on every SD write:
+// bucket 0 counts the 0s, bucket i the values in [2**(i-1), 2**i), and the last bucket all the larger values
+// the counts are laid out as they are written to the telemetry blocks
+template <size_t nbr_buckets>
+class Log2Histogram{
+    static_assert((nbr_buckets >= 2) && (nbr_buckets <= 33), "from 2 buckets to one per bit of a 32 bits value");
+
+    public:
+        Log2Histogram(){
+            reset();
+        }
+
+        void reset(){
+            for (size_t crrt_bucket = 0; crrt_bucket < nbr_buckets; crrt_bucket++){
+                counts[crrt_bucket] = 0;
+            }
+            max_value = 0;
+            nbr_values = 0;
+        }
+
+        void register_value(uint32_t value){
+            counts[bucket_index(value)] += 1;
+            nbr_values += 1;
+
+            if (value > max_value){
+                max_value = value;
+            }
+        }
+
+        static constexpr size_t bucket_index(uint32_t value){
+            size_t const nbr_significant_bits = (value == 0) ? 0 : static_cast<size_t>(32 - __builtin_clz(value));
+            return (nbr_significant_bits < nbr_buckets) ? nbr_significant_bits : nbr_buckets - 1;
+        }
+
+        // the smallest value counted in a bucket
+        static constexpr uint32_t bucket_lower_bound(size_t bucket){
+            return (bucket == 0) ? 0 : (1UL << (bucket - 1));
+        }
+
+        uint32_t const * get_counts() const{
+            return counts;
+        }
+
+        uint32_t get_max_value() const{
+            return max_value;
+        }
+
+        uint32_t get_nbr_values() const{
+            return nbr_values;
+        }
+
+        static constexpr size_t get_nbr_buckets(){
+            return nbr_buckets;
+        }
+
+    private:
+        uint32_t counts[nbr_buckets];
+        uint32_t max_value;
+        uint32_t nbr_values;
+};
+
+#endif // !LOG2_HISTOGRAM
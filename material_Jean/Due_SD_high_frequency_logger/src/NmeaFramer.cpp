@@ -0,0 +1,118 @@
+#include "NmeaFramer.h"
+
+namespace{
+    // the value of an upper case hex digit, or -1
+    int hex_value(char hex_digit){
+        if ((hex_digit >= '0') && (hex_digit <= '9')){
+            return hex_digit - '0';
+        }
+        if ((hex_digit >= 'A') && (hex_digit <= 'F')){
+            return hex_digit - 'A' + 10;
+        }
+        return -1;
+    }
+}
+
+void NmeaFramer::init(char const * ring, size_t ring_nbr_chars){
+    this->ring = ring;
+    ring_mask = static_cast<uint32_t>(ring_nbr_chars - 1);
+    scan_position = 0;
+    sentence_start = 0;
+    in_sentence = false;
+    nbr_bad_sentences = 0;
+    nbr_lost_chars = 0;
+}
+
+bool NmeaFramer::find_sentence(uint32_t nbr_chars_written, NmeaSentenceView & sentence){
+    // the chars not looked at yet, or the start of the sentence in progress, have been written over
+    uint32_t const oldest_position_needed = in_sentence ? sentence_start : scan_position;
+    if (nbr_chars_written - oldest_position_needed > ring_mask + 1){
+        nbr_lost_chars += nbr_chars_written - scan_position;
+        scan_position = nbr_chars_written;
+        in_sentence = false;
+        return false;
+    }
+
+    while (scan_position != nbr_chars_written){
+        char const crrt_char = ring_char(scan_position);
+
+        if (crrt_char == '$'){
+            // a sentence that never ended
+            if (in_sentence){
+                nbr_bad_sentences += 1;
+            }
+            sentence_start = scan_position;
+            in_sentence = true;
+        }
+        else if (in_sentence && ((crrt_char == '\r') || (crrt_char == '\n'))){
+            uint32_t const sentence_end = scan_position;
+            in_sentence = false;
+            scan_position += 1;
+
+            if (!checksum_is_valid(sentence_end)){
+                nbr_bad_sentences += 1;
+                continue;
+            }
+
+            uint32_t const start_index = sentence_start & ring_mask;
+            size_t const nbr_chars = sentence_end - sentence_start;
+            size_t const nbr_chars_to_ring_end = ring_mask + 1 - start_index;
+
+            sentence.chars = &ring[start_index];
+            if (nbr_chars <= nbr_chars_to_ring_end){
+                sentence.nbr_chars = nbr_chars;
+                sentence.chars_continued = ring;
+                sentence.nbr_chars_continued = 0;
+            }
+            else{
+                sentence.nbr_chars = nbr_chars_to_ring_end;
+                sentence.chars_continued = ring;
+                sentence.nbr_chars_continued = nbr_chars - nbr_chars_to_ring_end;
+            }
+
+            return true;
+        }
+        else if (in_sentence && (scan_position - sentence_start >= nmea_max_sentence_nbr_chars)){
+            nbr_bad_sentences += 1;
+            in_sentence = false;
+        }
+
+        scan_position += 1;
+    }
+
+    return false;
+}
+
+uint32_t NmeaFramer::get_nbr_bad_sentences(void) const{
+    return nbr_bad_sentences;
+}
+
+uint32_t NmeaFramer::get_nbr_lost_chars(void) const{
+    return nbr_lost_chars;
+}
+
+char NmeaFramer::ring_char(uint32_t position) const{
+    return ring[position & ring_mask];
+}
+
+bool NmeaFramer::checksum_is_valid(uint32_t sentence_end) const{
+    // at least "$*hh"
+    if (sentence_end - sentence_start < 4){
+        return false;
+    }
+
+    uint32_t const position_star = sentence_end - 3;
+    if (ring_char(position_star) != '*'){
+        return false;
+    }
+
+    uint8_t checksum = 0;
+    for (uint32_t position = sentence_start + 1; position < position_star; position++){
+        checksum ^= static_cast<uint8_t>(ring_char(position));
+    }
+
+    int const high_digit = hex_value(ring_char(position_star + 1));
+    int const low_digit = hex_value(ring_char(position_star + 2));
+
+    return (high_digit >= 0) && (low_digit >= 0) && (checksum == ((high_digit << 4) | low_digit));
+}
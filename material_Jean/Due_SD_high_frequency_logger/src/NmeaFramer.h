@@ -0,0 +1,59 @@
+#ifndef NMEA_FRAMER
+#define NMEA_FRAMER
+
+#include <stdint.h>
+#include <stddef.h>
+
+// an NMEA sentence is "$" + fields + "*" + 2 hex digits checksum (the xor of the chars between "$" and "*") + "\r\n"
+// NMEA 0183 allows 82 chars; some receivers go a bit above in their proprietary sentences
+constexpr size_t nmea_max_sentence_nbr_chars = 100;
+
+// a sentence, from "$" to the checksum included, i.e. without the "\r\n", where it is in the ring; it is in 2 parts if
+// it wraps around the end of the ring, else nbr_chars_continued is 0
+// the chars are not a cstring, and are only valid until the ring is written over, i.e. they must be used at once
+struct NmeaSentenceView{
+    char const * chars;
+    size_t nbr_chars;
+    char const * chars_continued;
+    size_t nbr_chars_continued;
+};
+
+// find the NMEA sentences in a ring of chars filled by a producer (the UART DMA), in place: the sentences are never
+// copied out of the ring
+// the producer gives the total nbr of chars it has written so far, as a free running count; each call only looks at
+// the chars written since the previous call; if the producer got more than a whole ring ahead, the chars in between
+// are lost, and the framing starts again from the chars just received
+class NmeaFramer{
+    public:
+        // ring_nbr_chars must be a power of 2
+        void init(char const * ring, size_t ring_nbr_chars);
+
+        // look at the chars up to nbr_chars_written; return true and set sentence if they complete a sentence with a
+        // valid checksum, else false once all the chars are looked at
+        bool find_sentence(uint32_t nbr_chars_written, NmeaSentenceView & sentence);
+
+        // the nbr of sentences dropped: bad checksum, no checksum, or too long
+        uint32_t get_nbr_bad_sentences(void) const;
+
+        // the nbr of chars lost because the producer got more than a ring ahead
+        uint32_t get_nbr_lost_chars(void) const;
+
+    private:
+        char const * ring = nullptr;
+        uint32_t ring_mask = 0;
+
+        // the free running position of the next char to look at, and of the "$" of the sentence in progress
+        uint32_t scan_position = 0;
+        uint32_t sentence_start = 0;
+        bool in_sentence = false;
+
+        uint32_t nbr_bad_sentences = 0;
+        uint32_t nbr_lost_chars = 0;
+
+        char ring_char(uint32_t position) const;
+
+        // is the sentence from sentence_start to sentence_end (excluded) well formed, with a valid checksum
+        bool checksum_is_valid(uint32_t sentence_end) const;
+};
+
+#endif // !NMEA_FRAMER
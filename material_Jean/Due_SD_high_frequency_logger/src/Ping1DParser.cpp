@@ -0,0 +1,174 @@
+#include "Ping1DParser.h"
+
+#include <string.h>
+
+namespace{
+    uint16_t read_uint16(uint8_t const * bytes){
+        return static_cast<uint16_t>(bytes[0] | (bytes[1] << 8));
+    }
+
+    uint32_t read_uint32(uint8_t const * bytes){
+        return static_cast<uint32_t>(bytes[0]) | (static_cast<uint32_t>(bytes[1]) << 8) |
+               (static_cast<uint32_t>(bytes[2]) << 16) | (static_cast<uint32_t>(bytes[3]) << 24);
+    }
+
+    void write_uint16(uint8_t * bytes, uint16_t value){
+        bytes[0] = static_cast<uint8_t>(value & 0xFF);
+        bytes[1] = static_cast<uint8_t>(value >> 8);
+    }
+}
+
+size_t make_ping_general_request(uint8_t * buffer, uint16_t requested_id){
+    buffer[0] = 'B';
+    buffer[1] = 'R';
+    write_uint16(&buffer[2], 2);
+    write_uint16(&buffer[4], ping_message_id_general_request);
+    // from the host (0), to any device (0)
+    buffer[6] = 0;
+    buffer[7] = 0;
+    write_uint16(&buffer[8], requested_id);
+
+    uint16_t checksum = 0;
+    for (size_t i = 0; i < ping_general_request_nbr_bytes - ping_checksum_nbr_bytes; i++){
+        checksum += buffer[i];
+    }
+    write_uint16(&buffer[ping_general_request_nbr_bytes - ping_checksum_nbr_bytes], checksum);
+
+    return ping_general_request_nbr_bytes;
+}
+
+bool decode_ping1d_profile(uint8_t const * payload, size_t payload_length, Ping1DProfile & profile){
+    constexpr size_t nbr_fixed_bytes = 26;
+
+    memset(&profile, 0, sizeof(profile));
+
+    if (payload_length < nbr_fixed_bytes){
+        return false;
+    }
+
+    profile.distance = read_uint32(&payload[0]);
+    profile.confidence = read_uint16(&payload[4]);
+    profile.transmit_duration = read_uint16(&payload[6]);
+    profile.ping_number = read_uint32(&payload[8]);
+    profile.scan_start = read_uint32(&payload[12]);
+    profile.scan_length = read_uint32(&payload[16]);
+    profile.gain_setting = read_uint32(&payload[20]);
+
+    uint16_t const nbr_points = read_uint16(&payload[24]);
+
+    if (nbr_fixed_bytes + nbr_points > payload_length){
+        return false;
+    }
+
+    profile.profile_data_length = (nbr_points < ping1d_max_profile_nbr_points) ? nbr_points : ping1d_max_profile_nbr_points;
+    memcpy(profile.profile_data, &payload[nbr_fixed_bytes], profile.profile_data_length);
+
+    return true;
+}
+
+bool Ping1DParser::parse_byte(uint8_t byte){
+    switch (crrt_state){
+        case ParserState::wait_start_B:
+            if (byte == 'B'){
+                buffer[0] = byte;
+                crrt_state = ParserState::wait_start_R;
+            }
+            else{
+                nbr_skipped_bytes += 1;
+            }
+            return false;
+
+        case ParserState::wait_start_R:
+            if (byte == 'R'){
+                buffer[1] = byte;
+                nbr_bytes_in_buffer = 2;
+                crrt_state = ParserState::header;
+            }
+            // a 'B' may start the message just as well
+            else if (byte != 'B'){
+                nbr_skipped_bytes += 2;
+                crrt_state = ParserState::wait_start_B;
+            }
+            else{
+                nbr_skipped_bytes += 1;
+            }
+            return false;
+
+        case ParserState::header:
+            buffer[nbr_bytes_in_buffer] = byte;
+            nbr_bytes_in_buffer += 1;
+
+            if (nbr_bytes_in_buffer == ping_header_nbr_bytes){
+                payload_length = read_uint16(&buffer[2]);
+
+                if (payload_length > ping_max_payload_nbr_bytes){
+                    nbr_bad_messages += 1;
+                    reset();
+                    return false;
+                }
+
+                received_checksum = 0;
+                nbr_checksum_bytes = 0;
+                crrt_state = (payload_length == 0) ? ParserState::checksum : ParserState::payload;
+            }
+            return false;
+
+        case ParserState::payload:
+            buffer[nbr_bytes_in_buffer] = byte;
+            nbr_bytes_in_buffer += 1;
+
+            if (nbr_bytes_in_buffer == ping_header_nbr_bytes + payload_length){
+                crrt_state = ParserState::checksum;
+            }
+            return false;
+
+        case ParserState::checksum:
+            received_checksum |= static_cast<uint16_t>(byte) << (8 * nbr_checksum_bytes);
+            nbr_checksum_bytes += 1;
+
+            if (nbr_checksum_bytes < ping_checksum_nbr_bytes){
+                return false;
+            }
+
+            uint16_t crrt_checksum = 0;
+            for (size_t i = 0; i < nbr_bytes_in_buffer; i++){
+                crrt_checksum += buffer[i];
+            }
+
+            crrt_state = ParserState::wait_start_B;
+
+            if (crrt_checksum != received_checksum){
+                nbr_bad_messages += 1;
+                return false;
+            }
+
+            return true;
+    }
+
+    return false;
+}
+
+void Ping1DParser::reset(void){
+    crrt_state = ParserState::wait_start_B;
+    nbr_bytes_in_buffer = 0;
+}
+
+uint16_t Ping1DParser::get_message_id(void) const{
+    return read_uint16(&buffer[4]);
+}
+
+uint16_t Ping1DParser::get_payload_length(void) const{
+    return payload_length;
+}
+
+uint8_t const * Ping1DParser::get_payload(void) const{
+    return &buffer[ping_header_nbr_bytes];
+}
+
+uint32_t Ping1DParser::get_nbr_bad_messages(void) const{
+    return nbr_bad_messages;
+}
+
+uint32_t Ping1DParser::get_nbr_skipped_bytes(void) const{
+    return nbr_skipped_bytes;
+}
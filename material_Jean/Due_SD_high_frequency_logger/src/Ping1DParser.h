@@ -0,0 +1,98 @@
+#ifndef PING1D_PARSER
+#define PING1D_PARSER
+
+#include <stdint.h>
+#include <stddef.h>
+
+// the Ping protocol, as spoken by the Blue Robotics Ping1D sonar, see https://docs.bluerobotics.com/ping-protocol/
+// a message is, all little endian:
+// 'B' 'R' payload_length (u16) message_id (u16) src_device_id (u8) dst_device_id (u8) payload checksum (u16)
+// the checksum being the sum of all the bytes before it
+constexpr size_t ping_header_nbr_bytes = 8;
+constexpr size_t ping_checksum_nbr_bytes = 2;
+
+// the largest payload kept; the profile, the largest message used here, has 26 bytes and 200 points
+constexpr size_t ping_max_payload_nbr_bytes = 256;
+
+constexpr uint16_t ping_message_id_nack = 2;
+constexpr uint16_t ping_message_id_general_request = 6;
+constexpr uint16_t ping1d_message_id_firmware_version = 1200;
+constexpr uint16_t ping1d_message_id_distance_simple = 1211;
+constexpr uint16_t ping1d_message_id_profile = 1300;
+
+// a general_request has a payload of 2 bytes, the id of the message asked for
+constexpr size_t ping_general_request_nbr_bytes = ping_header_nbr_bytes + 2 + ping_checksum_nbr_bytes;
+
+// write the message asking the sonar for the message requested_id into buffer, that must hold
+// ping_general_request_nbr_bytes; return the nbr of bytes written
+size_t make_ping_general_request(uint8_t * buffer, uint16_t requested_id);
+
+constexpr size_t ping1d_max_profile_nbr_points = 200;
+
+// the payload of a profile message, in the order of the protocol, with the points as the sonar sends them
+// (0 to 255, the echo strength over scan_length starting at scan_start)
+// this is also the layout logged in the 'P' records (see SonarManager.h), so no implicit padding
+struct Ping1DProfile{
+    uint32_t distance;  // in mm
+    uint16_t confidence;  // in %
+    uint16_t transmit_duration;  // in us
+    uint32_t ping_number;
+    uint32_t scan_start;  // in mm
+    uint32_t scan_length;  // in mm
+    uint32_t gain_setting;
+    uint16_t profile_data_length;
+    uint8_t profile_data[ping1d_max_profile_nbr_points];
+    uint16_t unused;
+};
+
+static_assert(sizeof(Ping1DProfile) == 228);
+
+// decode the payload of a profile message; the points past ping1d_max_profile_nbr_points are dropped
+// return false if the payload is too short for what it announces
+bool decode_ping1d_profile(uint8_t const * payload, size_t payload_length, Ping1DProfile & profile);
+
+// parse the Ping protocol byte by byte, as the bytes come out of the UART, never waiting for the rest of a message
+// on a bad checksum or a too long payload, the message is dropped and the parser looks for the next 'B' 'R'
+class Ping1DParser{
+    public:
+        // take one more byte; return true if it completes a valid message, that is then available through the getters
+        // until the next call
+        bool parse_byte(uint8_t byte);
+
+        // forget any message in progress, for example after a timeout
+        void reset(void);
+
+        uint16_t get_message_id(void) const;
+        uint16_t get_payload_length(void) const;
+        uint8_t const * get_payload(void) const;
+
+        // the nbr of messages dropped on a bad checksum or a too long payload
+        uint32_t get_nbr_bad_messages(void) const;
+
+        // the nbr of bytes skipped while looking for the start of a message
+        uint32_t get_nbr_skipped_bytes(void) const;
+
+    private:
+        enum class ParserState{
+            wait_start_B,
+            wait_start_R,
+            header,
+            payload,
+            checksum
+        };
+
+        ParserState crrt_state = ParserState::wait_start_B;
+
+        // the header, then the payload, of the message in progress
+        uint8_t buffer[ping_header_nbr_bytes + ping_max_payload_nbr_bytes];
+        size_t nbr_bytes_in_buffer = 0;
+        uint16_t payload_length = 0;
+
+        uint16_t received_checksum = 0;
+        size_t nbr_checksum_bytes = 0;
+
+        uint32_t nbr_bad_messages = 0;
+        uint32_t nbr_skipped_bytes = 0;
+};
+
+#endif // !PING1D_PARSER
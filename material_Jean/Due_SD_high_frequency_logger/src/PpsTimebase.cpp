@@ -0,0 +1,245 @@
+#include "PpsTimebase.h"
+
+#include <math.h>
+#include <string.h>
+
+namespace{
+    // the value of the 2 decimal digits at chars, or -1
+    int two_digits(char const * chars){
+        if ((chars[0] < '0') || (chars[0] > '9') || (chars[1] < '0') || (chars[1] > '9')){
+            return -1;
+        }
+        return (chars[0] - '0') * 10 + (chars[1] - '0');
+    }
+
+    // the nbr of days from 1970-01-01 to year-month-day, in the proleptic gregorian calendar
+    int64_t days_from_civil(int64_t year, int month, int day){
+        year -= (month <= 2) ? 1 : 0;
+        int64_t const era = (year >= 0 ? year : year - 399) / 400;
+        int64_t const year_of_era = year - era * 400;
+        int64_t const day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+        int64_t const day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+        return era * 146097 + day_of_era - 719468;
+    }
+}
+
+bool parse_rmc_utc_seconds(char const * sentence, size_t nbr_chars, int64_t & utc_seconds){
+    // "$GPRMC,hhmmss.ss,A,llll.ll,a,yyyyy.yy,a,x.x,x.x,ddmmyy,...", with any talker ID
+    if ((nbr_chars < 6) || (sentence[0] != '$') || (memcmp(&sentence[3], "RMC", 3) != 0)){
+        return false;
+    }
+
+    // the start of the fields 1 (time), 2 (status) and 9 (date)
+    constexpr int nbr_fields_needed = 10;
+    size_t field_starts[nbr_fields_needed];
+    int nbr_fields = 0;
+
+    for (size_t i = 0; (i < nbr_chars) && (nbr_fields < nbr_fields_needed); i++){
+        if (sentence[i] == ','){
+            field_starts[nbr_fields] = i + 1;
+            nbr_fields += 1;
+        }
+    }
+
+    // field_starts[0] is the time, i.e. field 1
+    if (nbr_fields < nbr_fields_needed){
+        return false;
+    }
+
+    size_t const time_start = field_starts[0];
+    size_t const status_start = field_starts[1];
+    size_t const date_start = field_starts[8];
+
+    if ((time_start + 6 > nbr_chars) || (date_start + 6 > nbr_chars) || (sentence[status_start] != 'A')){
+        return false;
+    }
+
+    int const hours = two_digits(&sentence[time_start]);
+    int const minutes = two_digits(&sentence[time_start + 2]);
+    int const seconds = two_digits(&sentence[time_start + 4]);
+    int const day = two_digits(&sentence[date_start]);
+    int const month = two_digits(&sentence[date_start + 2]);
+    int const year = two_digits(&sentence[date_start + 4]);
+
+    if ((hours < 0) || (hours > 23) || (minutes < 0) || (minutes > 59) || (seconds < 0) || (seconds > 60) ||
+        (day < 1) || (day > 31) || (month < 1) || (month > 12) || (year < 0)){
+        return false;
+    }
+
+    // the 2 digits years are from 1980, the start of the GPS time
+    int64_t const full_year = (year >= 80) ? 1900 + year : 2000 + year;
+
+    utc_seconds = days_from_civil(full_year, month, day) * 86400 + hours * 3600 + minutes * 60 + seconds;
+    return true;
+}
+
+void PpsTimebase::reset(void){
+    nbr_edges = 0;
+    crrt_edge_index = 0;
+    nbr_consecutive_rejections = 0;
+    utc_is_known = false;
+    has_candidate_offset = false;
+    micros_per_second = 1e6;
+    correction_q32 = 0;
+    memset(&record, 0, sizeof(record));
+}
+
+void PpsTimebase::register_pps(uint32_t pps_micros){
+    if (nbr_edges == 0){
+        start_fit(pps_micros);
+        return;
+    }
+
+    int64_t const interval_micros = static_cast<uint32_t>(pps_micros - last_edge_micros);
+    int64_t const nbr_seconds = llround(interval_micros / micros_per_second);
+    int64_t const deviation_micros = interval_micros - llround(nbr_seconds * micros_per_second);
+
+    if ((nbr_seconds < 1) || (deviation_micros > pps_timebase_max_deviation_micros) || (deviation_micros < -pps_timebase_max_deviation_micros)){
+        record.nbr_rejected_edges += 1;
+        nbr_consecutive_rejections += 1;
+
+        // the model lost track of the edges, for example after a long gap
+        if (nbr_consecutive_rejections >= 2){
+            start_fit(pps_micros);
+        }
+        return;
+    }
+
+    nbr_consecutive_rejections = 0;
+    last_edge_micros = pps_micros;
+    last_edge_micros_unwrapped += interval_micros;
+    last_edge_second += nbr_seconds;
+
+    crrt_edge_index = (crrt_edge_index + 1) % pps_timebase_nbr_edges_in_fit;
+    edge_seconds[crrt_edge_index] = last_edge_second;
+    edge_micros[crrt_edge_index] = last_edge_micros_unwrapped;
+    if (nbr_edges < pps_timebase_nbr_edges_in_fit){
+        nbr_edges += 1;
+    }
+
+    fit();
+}
+
+void PpsTimebase::register_sentence(NmeaSentenceView const & sentence, uint32_t micros_received){
+    if (sentence.nbr_chars + sentence.nbr_chars_continued > nmea_max_sentence_nbr_chars){
+        return;
+    }
+
+    // the RMC of a second comes after the PPS edge that starts it
+    if ((nbr_edges == 0) || (static_cast<uint32_t>(micros_received - last_edge_micros) >= 1000000UL)){
+        return;
+    }
+
+    // the sentence may wrap around the end of the GPS ring
+    char chars[nmea_max_sentence_nbr_chars];
+    memcpy(chars, sentence.chars, sentence.nbr_chars);
+    memcpy(&chars[sentence.nbr_chars], sentence.chars_continued, sentence.nbr_chars_continued);
+
+    int64_t utc_seconds;
+    if (!parse_rmc_utc_seconds(chars, sentence.nbr_chars + sentence.nbr_chars_continued, utc_seconds)){
+        return;
+    }
+
+    int64_t const offset = utc_seconds - last_edge_second;
+
+    // once the UTC is known, an RMC that does not agree with the edges counted since may just be late, i.e. come after
+    // the next edge; the GPS only has the last word if 2 RMCs in a row agree on the new offset
+    if (utc_is_known && (offset != utc_seconds_offset)){
+        bool const is_confirmed = has_candidate_offset && (offset == candidate_utc_seconds_offset);
+        has_candidate_offset = !is_confirmed;
+        candidate_utc_seconds_offset = offset;
+
+        if (!is_confirmed){
+            return;
+        }
+    }
+    else{
+        has_candidate_offset = false;
+    }
+
+    utc_seconds_offset = offset;
+    utc_is_known = true;
+    record.utc_micros_reference = utc_seconds * 1000000;
+}
+
+bool PpsTimebase::is_valid(void) const{
+    return utc_is_known && (nbr_edges >= 2);
+}
+
+int64_t PpsTimebase::utc_micros(uint32_t micros) const{
+    int64_t const delta_micros = static_cast<int32_t>(micros - record.micros_reference);
+    return record.utc_micros_reference + delta_micros + ((delta_micros * correction_q32) >> 32);
+}
+
+TimebaseRecord const & PpsTimebase::get_record(void) const{
+    return record;
+}
+
+void PpsTimebase::start_fit(uint32_t pps_micros){
+    nbr_consecutive_rejections = 0;
+    utc_is_known = false;
+    has_candidate_offset = false;
+
+    last_edge_micros = pps_micros;
+    last_edge_micros_unwrapped = pps_micros;
+    last_edge_second = 0;
+
+    // the last estimate of the length of a second is kept, as the best guess until the next fit
+    crrt_edge_index = 0;
+    edge_seconds[0] = last_edge_second;
+    edge_micros[0] = last_edge_micros_unwrapped;
+    nbr_edges = 1;
+
+    fit();
+}
+
+void PpsTimebase::fit(void){
+    // relative to the last edge, so that the doubles keep all the micros
+    double intercept_micros = 0.0;
+    double residual_rms_micros = 0.0;
+
+    if (nbr_edges >= 2){
+        double mean_x = 0.0;
+        double mean_y = 0.0;
+        for (size_t i = 0; i < nbr_edges; i++){
+            mean_x += static_cast<double>(edge_seconds[i] - last_edge_second);
+            mean_y += static_cast<double>(edge_micros[i] - last_edge_micros_unwrapped);
+        }
+        mean_x /= nbr_edges;
+        mean_y /= nbr_edges;
+
+        double sum_xx = 0.0;
+        double sum_xy = 0.0;
+        for (size_t i = 0; i < nbr_edges; i++){
+            double const x = static_cast<double>(edge_seconds[i] - last_edge_second) - mean_x;
+            double const y = static_cast<double>(edge_micros[i] - last_edge_micros_unwrapped) - mean_y;
+            sum_xx += x * x;
+            sum_xy += x * y;
+        }
+
+        micros_per_second = sum_xy / sum_xx;
+
+        // the edges are checked against the model, so this would be a bug rather than a crystal
+        if (fabs(micros_per_second - 1e6) > 1000.0){
+            micros_per_second = 1e6;
+        }
+
+        intercept_micros = mean_y - micros_per_second * mean_x;
+
+        double sum_residuals_squared = 0.0;
+        for (size_t i = 0; i < nbr_edges; i++){
+            double const residual = static_cast<double>(edge_micros[i] - last_edge_micros_unwrapped) -
+                                    (intercept_micros + micros_per_second * static_cast<double>(edge_seconds[i] - last_edge_second));
+            sum_residuals_squared += residual * residual;
+        }
+        residual_rms_micros = sqrt(sum_residuals_squared / nbr_edges);
+    }
+
+    correction_q32 = llround((1e6 / micros_per_second - 1.0) * 4294967296.0);
+
+    record.micros_reference = static_cast<uint32_t>(last_edge_micros_unwrapped + llround(intercept_micros));
+    record.nbr_edges_in_fit = static_cast<uint16_t>(nbr_edges);
+    record.utc_micros_reference = utc_is_known ? (utc_seconds_offset + last_edge_second) * 1000000 : 0;
+    record.drift_ppb = static_cast<int32_t>(llround((micros_per_second - 1e6) * 1e3));
+    record.residual_rms_nanos = static_cast<uint32_t>(llround(residual_rms_micros * 1e3));
+}
@@ -0,0 +1,96 @@
+#ifndef PPS_TIMEBASE
+#define PPS_TIMEBASE
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "NmeaFramer.h"
+
+// the nbr of the last PPS edges the clock model is fitted on; about half a minute averages the jitter of the PPS
+// interrupt, while following the drift of the crystal with the temperature
+constexpr size_t pps_timebase_nbr_edges_in_fit = 32;
+
+// a PPS edge further than this from where the model expects it is a glitch, and is not used
+constexpr int64_t pps_timebase_max_deviation_micros = 500;
+
+// the model of the Due micros clock, as logged at each PPS edge in a 'Z' record (see FastLogger::log_record)
+// micros_reference is the micros of the last PPS edge, as fitted, and utc_micros_reference its UTC time, in micros
+// since the Unix epoch; drift_ppb is how much faster than UTC the micros clock runs, and residual_rms_nanos the rms
+// distance of the edges to the fit
+struct TimebaseRecord{
+    static constexpr uint8_t record_tag = 'Z';
+
+    uint32_t micros_reference;
+    uint16_t nbr_edges_in_fit;
+    uint16_t nbr_rejected_edges;
+    int64_t utc_micros_reference;
+    int32_t drift_ppb;
+    uint32_t residual_rms_nanos;
+};
+
+static_assert(sizeof(TimebaseRecord) == 24);
+
+// the UTC seconds since the Unix epoch of the time and date fields of an RMC sentence, if the fix is valid ('A')
+bool parse_rmc_utc_seconds(char const * sentence, size_t nbr_chars, int64_t & utc_seconds);
+
+// the UTC time of the micros clock, from the PPS edges and the RMC sentences of the GPS
+// the PPS edges are numbered by the whole seconds between them, and the micros of the last pps_timebase_nbr_edges_in_fit
+// edges are fitted linearly against their numbers (least squares), which gives the micros of the last edge and the
+// length of a UTC second in micros; an RMC sentence that comes less than a second after an edge gives the UTC second of
+// this edge, i.e. of all of them; once known, this only changes if 2 RMCs in a row disagree with it the same way, as a
+// single one may have been held up past the next edge
+// the micros are unwrapped into 64 bits from one edge to the next; a gap in the PPS is bridged by the model, unless the
+// model cannot tell the nbr of seconds in the gap any more, and then the fit starts again
+class PpsTimebase{
+    public:
+        void reset(void);
+
+        // an edge of the PPS, at pps_micros; an edge that does not fit the model is rejected as a glitch, and after 2
+        // rejections in a row, the fit starts again from the last edge
+        void register_pps(uint32_t pps_micros);
+
+        // an NMEA sentence, received at micros_received; only the RMC sentences are used
+        void register_sentence(NmeaSentenceView const & sentence, uint32_t micros_received);
+
+        // is the UTC time known
+        bool is_valid(void) const;
+
+        // the UTC time of micros, in micros since the Unix epoch; micros must be within about half an hour of the last
+        // PPS edge; only meaningful if is_valid
+        int64_t utc_micros(uint32_t micros) const;
+
+        // the current model, to be logged
+        TimebaseRecord const & get_record(void) const;
+
+    private:
+        // the edges in the fit, in a ring: their second nbr, and their unwrapped micros
+        int64_t edge_seconds[pps_timebase_nbr_edges_in_fit];
+        int64_t edge_micros[pps_timebase_nbr_edges_in_fit];
+        size_t nbr_edges = 0;
+        size_t crrt_edge_index = 0;
+
+        uint32_t last_edge_micros = 0;
+        int64_t last_edge_micros_unwrapped = 0;
+        int64_t last_edge_second = 0;
+        uint32_t nbr_consecutive_rejections = 0;
+
+        // the UTC second of the edge with second nbr 0
+        bool utc_is_known = false;
+        int64_t utc_seconds_offset = 0;
+
+        // an offset given by an RMC that disagrees with utc_seconds_offset, waiting for a second RMC to confirm it
+        bool has_candidate_offset = false;
+        int64_t candidate_utc_seconds_offset = 0;
+
+        // the model: the length of a second in micros, and the correction from micros to UTC micros,
+        // (1e6 / micros_per_second - 1) * 2**32; the reference is in the record
+        double micros_per_second = 1e6;
+        int64_t correction_q32 = 0;
+
+        TimebaseRecord record {};
+
+        void start_fit(uint32_t pps_micros);
+        void fit(void);
+};
+
+#endif // !PPS_TIMEBASE
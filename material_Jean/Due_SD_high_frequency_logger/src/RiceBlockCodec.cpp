@@ -0,0 +1,276 @@
+#include "RiceBlockCodec.h"
+
+#include <string.h>
+
+static inline uint32_t zigzag_encode(int32_t value){
+    return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+static inline int32_t zigzag_decode(uint32_t value){
+    return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+}
+
+void RiceBlockEncoder::start_block(uint8_t * data_out, size_t nbr_data_bytes){
+    data = data_out;
+    nbr_data_bits = (nbr_data_bytes - rice_nbr_header_bytes) * 8;
+
+    // so that the padding at the end of the block is deterministic
+    memset(data, 0, nbr_data_bytes);
+
+    crrt_bit_position = 0;
+    bit_accumulator = 0;
+    nbr_bits_in_accumulator = 0;
+
+    nbr_samples = 0;
+    previous_value = 0;
+    block_is_full = false;
+}
+
+size_t RiceBlockEncoder::append(uint16_t const * values_in, size_t nbr_values){
+    size_t nbr_values_taken = 0;
+
+    if (block_is_full){
+        return 0;
+    }
+
+    // the first sample goes raw in the header
+    if ((nbr_samples == 0) && (nbr_values > 0)){
+        previous_value = values_in[0];
+        data[2] = static_cast<uint8_t>(previous_value & 0xFF);
+        data[3] = static_cast<uint8_t>(previous_value >> 8);
+        nbr_samples = 1;
+        nbr_values_taken = 1;
+    }
+
+    while (nbr_values_taken < nbr_values){
+        int nbr_values_in_partition = rice_max_nbr_values_per_partition;
+        if (static_cast<size_t>(nbr_values_in_partition) > nbr_values - nbr_values_taken){
+            nbr_values_in_partition = static_cast<int>(nbr_values - nbr_values_taken);
+        }
+        // keep the sample count representable
+        if (nbr_values_in_partition > 0xFFFF - nbr_samples){
+            nbr_values_in_partition = 0xFFFF - nbr_samples;
+        }
+
+        uint32_t zigzag_values[rice_max_nbr_values_per_partition];
+        uint16_t crrt_previous_value = previous_value;
+        for (int i = 0; i < nbr_values_in_partition; i++){
+            uint16_t const crrt_value = values_in[nbr_values_taken + i];
+            zigzag_values[i] = zigzag_encode(static_cast<int32_t>(crrt_value) - static_cast<int32_t>(crrt_previous_value));
+            crrt_previous_value = crrt_value;
+        }
+
+        size_t cost = 0;
+        int k = best_k(zigzag_values, nbr_values_in_partition, cost);
+
+        // if the partition does not fit, take as much of it as fits, and the block is full
+        size_t const nbr_bits_left = nbr_data_bits - crrt_bit_position;
+        int const nbr_values_wanted = nbr_values_in_partition;
+
+        while ((nbr_values_in_partition > 0) && (8 + cost > nbr_bits_left)){
+            nbr_values_in_partition -= 1;
+            if (nbr_values_in_partition > 0){
+                k = best_k(zigzag_values, nbr_values_in_partition, cost);
+            }
+        }
+
+        if (nbr_values_in_partition == 0){
+            block_is_full = true;
+            break;
+        }
+
+        put_bits((static_cast<uint32_t>(k) << 4) | static_cast<uint32_t>(nbr_values_in_partition - 1), 8);
+
+        for (int i = 0; i < nbr_values_in_partition; i++){
+            if (k == rice_escape_k){
+                put_bits(values_in[nbr_values_taken + i], 16);
+            }
+            else{
+                uint32_t quotient = zigzag_values[i] >> k;
+
+                while (quotient >= 24){
+                    put_bits(0xFFFFFF, 24);
+                    quotient -= 24;
+                }
+                put_bits(((0b1ul << quotient) - 1) << 1, static_cast<int>(quotient) + 1);
+
+                if (k > 0){
+                    put_bits(zigzag_values[i] & ((0b1ul << k) - 1), k);
+                }
+            }
+        }
+
+        previous_value = values_in[nbr_values_taken + nbr_values_in_partition - 1];
+        nbr_samples += static_cast<uint16_t>(nbr_values_in_partition);
+        nbr_values_taken += static_cast<size_t>(nbr_values_in_partition);
+
+        if ((nbr_values_in_partition < nbr_values_wanted) || (nbr_samples == 0xFFFF)){
+            block_is_full = true;
+            break;
+        }
+    }
+
+    return nbr_values_taken;
+}
+
+bool RiceBlockEncoder::is_full(void) const{
+    return block_is_full;
+}
+
+uint16_t RiceBlockEncoder::get_nbr_samples(void) const{
+    return nbr_samples;
+}
+
+void RiceBlockEncoder::finish_block(void){
+    // flush the last bits, padded with zeros
+    if (nbr_bits_in_accumulator > 0){
+        put_bits(0, 8 - nbr_bits_in_accumulator);
+    }
+
+    data[0] = static_cast<uint8_t>(nbr_samples & 0xFF);
+    data[1] = static_cast<uint8_t>(nbr_samples >> 8);
+
+    block_is_full = true;
+}
+
+void RiceBlockEncoder::put_bits(uint32_t value, int nbr_bits){
+    // at most 7 bits are left in the accumulator between calls, so up to 24 bits can be added at once
+    bit_accumulator = (bit_accumulator << nbr_bits) | value;
+    nbr_bits_in_accumulator += nbr_bits;
+    crrt_bit_position += static_cast<size_t>(nbr_bits);
+
+    while (nbr_bits_in_accumulator >= 8){
+        nbr_bits_in_accumulator -= 8;
+        size_t const byte_index = rice_nbr_header_bytes + (crrt_bit_position - static_cast<size_t>(nbr_bits_in_accumulator)) / 8 - 1;
+        data[byte_index] = static_cast<uint8_t>(bit_accumulator >> nbr_bits_in_accumulator);
+    }
+
+    bit_accumulator &= (0b1ul << nbr_bits_in_accumulator) - 1;
+}
+
+size_t RiceBlockEncoder::partition_cost(uint32_t const * zigzag_values, int nbr_values, int k){
+    if (k == rice_escape_k){
+        return 16 * static_cast<size_t>(nbr_values);
+    }
+
+    size_t cost = static_cast<size_t>(nbr_values) * static_cast<size_t>(k + 1);
+    for (int i = 0; i < nbr_values; i++){
+        cost += zigzag_values[i] >> k;
+    }
+    return cost;
+}
+
+int RiceBlockEncoder::best_k(uint32_t const * zigzag_values, int nbr_values, size_t & cost){
+    uint32_t sum = 0;
+    for (int i = 0; i < nbr_values; i++){
+        sum += zigzag_values[i];
+    }
+
+    // the optimal k is close to log2 of the mean; only look around it
+    uint32_t const mean = sum / static_cast<uint32_t>(nbr_values);
+    int k_estimate = 0;
+    while ((mean >> k_estimate) > 0){
+        k_estimate += 1;
+    }
+
+    int best = rice_escape_k;
+    cost = partition_cost(zigzag_values, nbr_values, rice_escape_k);
+
+    for (int k = k_estimate - 2; k <= k_estimate; k++){
+        if ((k < 0) || (k >= rice_escape_k)){
+            continue;
+        }
+
+        size_t const crrt_cost = partition_cost(zigzag_values, nbr_values, k);
+        if (crrt_cost < cost){
+            cost = crrt_cost;
+            best = k;
+        }
+    }
+
+    return best;
+}
+
+// a minimal MSB first bit reader for the decoder
+class RiceBitReader{
+    public:
+        RiceBitReader(uint8_t const * data_in, size_t nbr_bits_in) : data(data_in), nbr_bits(nbr_bits_in) {}
+
+        bool overrun(void) const{
+            return crrt_bit_position > nbr_bits;
+        }
+
+        uint32_t get_bit(void){
+            if (crrt_bit_position >= nbr_bits){
+                crrt_bit_position += 1;
+                return 0;
+            }
+            uint32_t const bit = (data[crrt_bit_position / 8] >> (7 - (crrt_bit_position % 8))) & 0b1;
+            crrt_bit_position += 1;
+            return bit;
+        }
+
+        uint32_t get_bits(int nbr_bits_to_read){
+            uint32_t value = 0;
+            for (int i = 0; i < nbr_bits_to_read; i++){
+                value = (value << 1) | get_bit();
+            }
+            return value;
+        }
+
+    private:
+        uint8_t const * data;
+        size_t nbr_bits;
+        size_t crrt_bit_position = 0;
+};
+
+size_t rice_decode_block(uint8_t const * data_in, size_t nbr_data_bytes, uint16_t * values_out, size_t max_nbr_values){
+    size_t const nbr_samples = static_cast<size_t>(data_in[0]) | (static_cast<size_t>(data_in[1]) << 8);
+
+    if ((nbr_samples == 0) || (nbr_samples > max_nbr_values)){
+        return 0;
+    }
+
+    uint16_t previous_value = static_cast<uint16_t>(data_in[2] | (data_in[3] << 8));
+    values_out[0] = previous_value;
+    size_t nbr_decoded = 1;
+
+    RiceBitReader reader(&data_in[rice_nbr_header_bytes], (nbr_data_bytes - rice_nbr_header_bytes) * 8);
+
+    while (nbr_decoded < nbr_samples){
+        uint32_t const partition_header = reader.get_bits(8);
+        int const k = static_cast<int>(partition_header >> 4);
+        size_t const nbr_values_in_partition = (partition_header & 0x0F) + 1;
+
+        if (nbr_decoded + nbr_values_in_partition > nbr_samples){
+            return 0;
+        }
+
+        for (size_t i = 0; i < nbr_values_in_partition; i++){
+            if (k == rice_escape_k){
+                previous_value = static_cast<uint16_t>(reader.get_bits(16));
+            }
+            else{
+                uint32_t quotient = 0;
+                while (reader.get_bit() == 1){
+                    quotient += 1;
+                    if (reader.overrun()){
+                        return 0;
+                    }
+                }
+
+                uint32_t const zigzag_value = (quotient << k) | reader.get_bits(k);
+                previous_value = static_cast<uint16_t>(static_cast<int32_t>(previous_value) + zigzag_decode(zigzag_value));
+            }
+
+            values_out[nbr_decoded] = previous_value;
+            nbr_decoded += 1;
+        }
+
+        if (reader.overrun()){
+            return 0;
+        }
+    }
+
+    return nbr_decoded;
+}
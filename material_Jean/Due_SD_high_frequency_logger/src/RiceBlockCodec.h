@@ -0,0 +1,72 @@
+#ifndef RICE_BLOCK_CODEC
+#define RICE_BLOCK_CODEC
+
+#include <stdint.h>
+#include <stddef.h>
+
+// lossless compression of one ADC channel into the data part of a 512 bytes block, using first differences and
+// adaptive Rice coding; the layout of the data part is (all little endian):
+// - uint16_t nbr_samples: how many samples are in the block
+// - uint16_t first_sample: the first sample, raw
+// - a bitstream (MSB first in each byte) of partitions, each of up to 16 samples:
+//   - 4 bits k, 4 bits (nbr_samples_in_partition - 1)
+//   - if k < 15: for each sample, the zigzag coded difference to the previous sample, as q = u >> k ones, one zero,
+//     and the k low bits of u
+//   - if k == 15 (escape, for noisy partitions): each sample raw, on 16 bits
+// the partition length is explicit, so that the partitions do not need to be aligned on the 250 values ADC blocks
+// the host decoder is in BinarySdDataParser/BinaryParser.py
+
+constexpr size_t rice_nbr_header_bytes = 4;
+constexpr int rice_max_nbr_values_per_partition = 16;
+constexpr int rice_escape_k = 15;
+
+// an upper bound of the nbr of samples in a block: a constant signal costs 1 bit per sample, plus the partition headers
+constexpr size_t rice_max_nbr_samples(size_t nbr_data_bytes){
+    return 1 + (nbr_data_bytes - rice_nbr_header_bytes) * 8 * rice_max_nbr_values_per_partition / (rice_max_nbr_values_per_partition + 8);
+}
+
+class RiceBlockEncoder{
+    public:
+        // start filling a new block data part, of nbr_data_bytes bytes
+        void start_block(uint8_t * data_out, size_t nbr_data_bytes);
+
+        // encode as many of the values as fit in the block, and return how many were taken
+        // if less than nbr_values were taken, the block is full and must be finished
+        size_t append(uint16_t const * values_in, size_t nbr_values);
+
+        // is the block full
+        bool is_full(void) const;
+
+        // how many samples are in the block so far
+        uint16_t get_nbr_samples(void) const;
+
+        // write the header and flush the last bits; the block data part is then ready to be written
+        void finish_block(void);
+
+    private:
+        uint8_t * data;
+        size_t nbr_data_bits;
+
+        // the bitstream writer
+        size_t crrt_bit_position;
+        uint32_t bit_accumulator;
+        int nbr_bits_in_accumulator;
+
+        uint16_t nbr_samples;
+        uint16_t previous_value;
+        bool block_is_full;
+
+        void put_bits(uint32_t value, int nbr_bits);
+
+        // the nbr of bits needed to encode nbr_values zigzag values with a given k
+        static size_t partition_cost(uint32_t const * zigzag_values, int nbr_values, int k);
+
+        // the best k for a partition, escape included
+        static int best_k(uint32_t const * zigzag_values, int nbr_values, size_t & cost);
+};
+
+// decode the data part of a block written by a RiceBlockEncoder; return the nbr of samples decoded, which is
+// at most max_nbr_values, or 0 if the block is inconsistent
+size_t rice_decode_block(uint8_t const * data_in, size_t nbr_data_bytes, uint16_t * values_out, size_t max_nbr_values);
+
+#endif // !RICE_BLOCK_CODEC
@@ -0,0 +1,127 @@
+#include "SdBlockStream.h"
+
+SdBlockStream * SdBlockStream::active_stream = nullptr;
+
+bool SdBlockStream::begin(sd_t * sd_in, file_t * file_in){
+    sd = sd_in;
+    file = file_in;
+    nbr_blocks_written = 0;
+    is_raw = false;
+
+    if (!sd_use_raw_streaming || (sd->fatType() == FAT_TYPE_EXFAT)){
+        return false;
+    }
+
+    uint32_t first_sector;
+    if (!file->contiguousRange(&first_sector, &last_sector)){
+        return false;
+    }
+
+    // the extent is in whole clusters, while the file size (which truncate cannot exceed) is the pre-allocated size
+    uint64_t const nbr_sectors_in_file = file->fileSize() >> 9;
+    if (nbr_sectors_in_file == 0){
+        return false;
+    }
+    if (last_sector - first_sector + 1 > nbr_sectors_in_file){
+        last_sector = first_sector + static_cast<uint32_t>(nbr_sectors_in_file) - 1;
+    }
+
+    crrt_sector = first_sector;
+    is_raw = true;
+
+    return true;
+}
+
+bool SdBlockStream::write_block(void const * block_start){
+    // not begun, or already ended: the sectors may not belong to the file any longer
+    if (file == nullptr){
+        return false;
+    }
+
+    // the pre-allocated extent is full: continue through the file system, after what was streamed
+    if (is_raw && (crrt_sector > last_sector)){
+        pause();
+        is_raw = false;
+
+        if (!file->seekSet(static_cast<uint64_t>(nbr_blocks_written) << 9)){
+            return false;
+        }
+    }
+
+    if (!is_raw){
+        pause_active_stream();
+
+        if (file->write(block_start, 512) != 512){
+            return false;
+        }
+
+        nbr_blocks_written += 1;
+        return true;
+    }
+
+    if (active_stream != this){
+        pause_active_stream();
+
+        if (!sd->card()->writeStart(crrt_sector)){
+            return false;
+        }
+        active_stream = this;
+    }
+
+    if (!sd->card()->writeData(static_cast<uint8_t const *>(block_start))){
+        return false;
+    }
+
+    crrt_sector += 1;
+    nbr_blocks_written += 1;
+
+    return true;
+}
+
+bool SdBlockStream::pause(){
+    if (active_stream != this){
+        return true;
+    }
+
+    active_stream = nullptr;
+    return sd->card()->writeStop();
+}
+
+bool SdBlockStream::end(){
+    // the file will be closed next, so the card must be free, whichever stream is on
+    bool result = pause_active_stream();
+
+    if (file == nullptr){
+        return result;
+    }
+
+    // the pre-allocation set the file size to the whole extent; trim it to the blocks written, so that a file
+    // never ends with blocks that were not written
+    if (is_raw){
+        result &= file->truncate(static_cast<uint64_t>(nbr_blocks_written) << 9);
+    }
+    else{
+        result &= file->truncate();
+    }
+
+    file = nullptr;
+    is_raw = false;
+
+    return result;
+}
+
+uint32_t SdBlockStream::get_nbr_blocks_written() const{
+    return nbr_blocks_written;
+}
+
+bool SdBlockStream::pause_active_stream(){
+    if (active_stream == nullptr){
+        return true;
+    }
+
+    return active_stream->pause();
+}
+
+bool SdBlockStream::card_is_busy(sd_t * sd_in){
+    return sd_in->card()->isBusy();
+}
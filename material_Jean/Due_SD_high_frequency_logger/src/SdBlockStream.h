@@ -0,0 +1,58 @@
+#ifndef SD_BLOCK_STREAM
+#define SD_BLOCK_STREAM
+
+#include "Arduino.h"
+#include "SdFat.h"
+
+#include <params.h>
+
+// write 512 bytes blocks to a pre-allocated file, streaming them to the card as one multi-block write over the
+// contiguous extent of the file, rather than going through the file system for each block
+// inspired from: LowLatencyLogger_Joey_v5, recordBinFile
+//
+// the card can only do one multi-block write at a time: starting to write on a stream, or calling
+// pause_active_stream before any other access to the card (open, exists, close, etc), ends the current one
+//
+// the file system is still used (write, one block at a time) if sd_use_raw_streaming is false, if the file is not
+// contiguous, on exFAT (where the pre-allocation does not make the data valid), and if the pre-allocated extent is full
+class SdBlockStream{
+    public:
+        // use a file that has just been opened and pre-allocated; return true if it can be streamed to
+        bool begin(sd_t * sd_in, file_t * file_in);
+
+        // write the next 512 bytes block
+        bool write_block(void const * block_start);
+
+        // end the multi-block write of this stream, if it is on; it is started again at the next write_block
+        bool pause();
+
+        // pause any stream, and set the size of the file to what was written; the file can then be closed, and
+        // nothing more is written until the next begin
+        bool end();
+
+        // how many blocks were written since begin
+        uint32_t get_nbr_blocks_written() const;
+
+        // end the multi-block write of whichever stream is on, so that the card can be used otherwise
+        static bool pause_active_stream();
+
+        // is the card still programming the last blocks; writing now would have to wait for it
+        static bool card_is_busy(sd_t * sd_in);
+
+    private:
+        sd_t * sd = nullptr;
+        file_t * file = nullptr;
+
+        bool is_raw = false;
+
+        // the next sector to write, and the last sector of the contiguous extent
+        uint32_t crrt_sector = 0;
+        uint32_t last_sector = 0;
+
+        uint32_t nbr_blocks_written = 0;
+
+        // the stream whose multi-block write is on, if any
+        static SdBlockStream * active_stream;
+};
+
+#endif // !SD_BLOCK_STREAM
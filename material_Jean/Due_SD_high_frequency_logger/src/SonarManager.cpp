@@ -1,34 +1,34 @@
 #include "SonarManager.h"
 
 void SonarManager::start_sonar(FastLogger * fast_logger, bool use_serial_debug){
-  fast_logger = fast_logger;
-  use_serial_debug = use_serial_debug;
-
-  for (size_t i=0; i<size_buffer_status_message; i++){
-      buffer_status_messages[i] = '\0';
-  }
+  this->fast_logger = fast_logger;
+  this->use_serial_debug = use_serial_debug;
 
   // start the sonar
   selected_sonar_serial->begin(9600);
 
-  // try at most 5 times to start
+  // try at most 5 times to start: the sonar is there if it tells its firmware version
   for(int i=0; i < 5; i++){
-      if (!sonar_ping.initialize()){
-          if (use_serial_debug){
-              Serial.println(F("fail start sonar ping"));
-              delay(250);
-          }
+      parser.reset();
+      send_general_request(ping1d_message_id_firmware_version);
+
+      unsigned long const time_request_ms = millis();
+      while ((millis() - time_request_ms < sonar_answer_timeout_ms) && !working_sonar){
+          working_sonar = receive(ping1d_message_id_firmware_version);
       }
-      else{
-          working_sonar = true;
+
+      if (working_sonar){
           if (use_serial_debug){
               Serial.println(F("sonar started"));
           }
           break;
       }
+      else if (use_serial_debug){
+          Serial.println(F("fail start sonar ping"));
+      }
   }
 
-  // make time ready to measureSerial.printlnSerial.printlnSerial.println
+  // make time ready to measure
   time_last_measurement_ms = millis() - sample_period_sonar_ms - 1;
 
   if (use_serial_debug){
@@ -36,124 +36,101 @@ void SonarManager::start_sonar(FastLogger * fast_logger, bool use_serial_debug){
   }
 }
 
-bool SonarManager::ready_to_measure(void){
-    if (millis() - time_last_measurement_ms > sample_period_sonar_ms){
-        if (use_serial_debug){
-            Serial.println(F("SNR meas rdy"));
+void SonarManager::update(void){
+    if (!working_sonar){
+        return;
+    }
+
+    if (waiting_for_answer){
+        if (receive(ping1d_message_id_profile)){
+            log_profile();
+        }
+        else if (millis() - time_last_measurement_ms > sonar_answer_timeout_ms){
+            log_missing_answer();
         }
-        return true;
     }
-    else{
-        return false;
+    else if (ready_to_measure()){
+        request_measurement();
     }
 }
 
-void SonarManager::measure_and_log(void){
-    time_last_measurement_ms = millis();
+bool SonarManager::ready_to_measure(void){
+    return millis() - time_last_measurement_ms > sample_period_sonar_ms;
+}
 
+void SonarManager::request_measurement(void){
     if (use_serial_debug){
-        Serial.println(F("millis"));
+        Serial.println(F("rqst snr"));
     }
 
-    if (working_sonar){
-
-        if (use_serial_debug){
-            Serial.println(F("rqst snr"));
-            // TODO: remove
-            Serial.flush();
-        }
-
-        buffer_status_messages[0] = 'r'; // msg flag request
-        buffer_status_messages[1] = 's';
-        buffer_status_messages[2] = 'n';
-        buffer_status_messages[3] = 'r';
-        buffer_status_messages[4] = ':';
-        buffer_status_messages[5] = '\0';
-
-        fast_logger->log_cstring(buffer_status_messages);  // request sonar
-
-        /* this would be the ideal: logging the full sonar profile; however, I somehow cannot get this to work!
-        // I wonder if there are some problems in the sonar library itself
-        if (sonar_ping.request(Ping1DNamespace::Profile)) {
-            if (use_serial_debug){
-                Serial.print(F("nbr sonar points: "));
-                Serial.println(sonar_ping.profile_data_length());
-                // TODO: remove
-                Serial.flush();
-            }
-
-            for (unsigned int i = 0; i < sonar_ping.profile_data_length(); i++) {
-                uint8_t crrt_ping = sonar_ping.profile_data()[i];
-                fast_logger->log_char(static_cast<char>(crrt_ping));
-            }
-        */
-
-
-        // */ this is less information; sending only the distance to max hit and confidence
-        if (sonar_ping.update()) {
-            int sonar_distance;
-            int sonar_confidence;
+    time_last_measurement_ms = millis();
 
-            sonar_distance = sonar_ping.distance();
-            sonar_confidence = sonar_ping.confidence();
+    crrt_record.micros_request = micros();
+    crrt_record.distance = 0;
+    crrt_record.confidence = 0;
+    crrt_record.is_valid = 0;
 
-            char buffer_sonar_message[64];
+    // drop what is left of an answer that came too late
+    parser.reset();
+    send_general_request(ping1d_message_id_profile);
+    waiting_for_answer = true;
+}
 
-            for (size_t i=0; i<64; i++){
-                buffer_sonar_message[i] = '\0';
-            }
+void SonarManager::log_profile(void){
+    waiting_for_answer = false;
 
-            buffer_sonar_message[0] = 'D';
-            buffer_sonar_message[1] = 'S';
-            buffer_sonar_message[2] = 'T';
-            buffer_sonar_message[3] = ':';
+    crrt_profile_record.micros_request = crrt_record.micros_request;
 
-            sprintf(&buffer_sonar_message[4], "%+09i,", sonar_distance);
+    if (!decode_ping1d_profile(parser.get_payload(), parser.get_payload_length(), crrt_profile_record.profile)){
+        log_missing_answer();
+        return;
+    }
 
-            if (use_serial_debug){
-                Serial.println(buffer_sonar_message);
-            }
+    crrt_record.distance = crrt_profile_record.profile.distance;
+    crrt_record.confidence = crrt_profile_record.profile.confidence;
+    crrt_record.is_valid = 1;
 
-            fast_logger->log_cstring(buffer_sonar_message);
+    fast_logger->log_record(crrt_record);
+    fast_logger->log_record(crrt_profile_record);
 
-            for (size_t i=0; i<64; i++){
-                buffer_sonar_message[i] = '\0';
-            }
+    if (use_serial_debug){
+        Serial.print(F("DST:"));
+        Serial.print(crrt_record.distance);
+        Serial.print(F(",CFD:"));
+        Serial.print(crrt_record.confidence);
+        Serial.print(F(",PTS:"));
+        Serial.println(crrt_profile_record.profile.profile_data_length);
+    }
+}
 
-            buffer_sonar_message[0] = 'C';
-            buffer_sonar_message[1] = 'F';
-            buffer_sonar_message[2] = 'D';
-            buffer_sonar_message[3] = ':';
+void SonarManager::log_missing_answer(void){
+    waiting_for_answer = false;
 
-            sprintf(&buffer_sonar_message[4], "%+09i,", sonar_confidence);
+    if (use_serial_debug){
+        Serial.print(F("get sonar data fail, bad messages: "));
+        Serial.println(parser.get_nbr_bad_messages());
+    }
 
-            if (use_serial_debug){
-                Serial.println(buffer_sonar_message);
-            }
+    fast_logger->log_record(crrt_record);
+}
 
-            fast_logger->log_cstring(buffer_sonar_message);
-            // *
+void SonarManager::send_general_request(uint16_t requested_id){
+    uint8_t request[ping_general_request_nbr_bytes];
+    size_t const nbr_bytes = make_ping_general_request(request, requested_id);
 
-            buffer_status_messages[0] = 'e';  // msg flag end
-            buffer_status_messages[1] = 's';
-            buffer_status_messages[2] = 'n';
-            buffer_status_messages[3] = 'r';
-            buffer_status_messages[4] = ':';
-            buffer_status_messages[5] = '\0';
+    // a few bytes, that go to the TX buffer of the UART
+    selected_sonar_serial->write(request, nbr_bytes);
+}
 
-            fast_logger->log_cstring(buffer_status_messages);
+bool SonarManager::receive(uint16_t message_id){
+    // only what has already been received, i.e. at most the RX buffer of the UART
+    while (selected_sonar_serial->available() > 0){
+        uint8_t const crrt_byte = static_cast<uint8_t>(selected_sonar_serial->read());
 
-        } else {
-            if (use_serial_debug){
-                Serial.println(F("get sonar data fail"));
-                // TODO: remove
-                Serial.flush();
-            }
-        }
-    }
-    else{
-        if (use_serial_debug){
-            Serial.println(F("non working sonar"));
+        if (parser.parse_byte(crrt_byte) && (parser.get_message_id() == message_id)){
+            return true;
         }
     }
+
+    return false;
 }
@@ -3,26 +3,65 @@
 
 #include "params.h"
 #include "FastLogger.h"
+#include "Ping1DParser.h"
 
-#include "ping1d.h"
+// one sonar measurement, logged as a 'D' record (see FastLogger::log_record)
+// micros_request is when the measurement was requested, the record itself being timestamped when received;
+// is_valid is 0 if the sonar did not answer, and then distance and confidence are 0
+struct SonarRecord{
+    static constexpr uint8_t record_tag = 'D';
 
-static Ping1D sonar_ping {*selected_sonar_serial};
+    uint32_t micros_request;
+    uint32_t distance;  // in mm
+    uint16_t confidence;  // in %
+    uint16_t is_valid;
+};
+
+static_assert(sizeof(SonarRecord) == 12);
+
+// the full profile of a sonar measurement, logged as a 'P' record after the 'D' record of the same measurement
+struct SonarProfileRecord{
+    static constexpr uint8_t record_tag = 'P';
+
+    uint32_t micros_request;
+    Ping1DProfile profile;
+};
+
+static_assert(sizeof(SonarProfileRecord) == 232);
 
+// the Ping1D sonar, on selected_sonar_serial
+// every sample_period_sonar_ms, a profile is requested, and the answer is parsed from the bytes received at each call
+// to update, so that the main loop never waits for the sonar; if no profile comes within sonar_answer_timeout_ms, an
+// invalid 'D' record is logged
 class SonarManager{
     public:
+        // look for the sonar; this waits for its answers, so it is for the setup only
         void start_sonar(FastLogger * fast_logger, bool use_serial_debug);
 
-        bool ready_to_measure(void);
+        // request, receive and log the measurements, never waiting; to be called at each main loop
+        void update(void);
 
-        void measure_and_log(void);
     private:
         unsigned long time_last_measurement_ms {1UL << 31};
         FastLogger * fast_logger;
         bool use_serial_debug {false};
         bool working_sonar {false};
-        static constexpr size_t size_buffer_status_message = 32;
-        char buffer_status_messages[size_buffer_status_message];
+
+        Ping1DParser parser;
+        bool waiting_for_answer {false};
+        SonarRecord crrt_record;
+        SonarProfileRecord crrt_profile_record;
+
+        bool ready_to_measure(void);
+        void request_measurement(void);
+        void log_profile(void);
+        void log_missing_answer(void);
+
+        void send_general_request(uint16_t requested_id);
+
+        // feed the bytes received so far to the parser; return true if they complete a message with message_id
+        bool receive(uint16_t message_id);
 };
 
 
-#endif // !SONAR_MANAGER
\ No newline at end of file
+#endif // !SONAR_MANAGER
@@ -0,0 +1,82 @@
+#include "StaLtaDetector.h"
+
+// the LTA is floored to one count**2, so that a perfectly flat signal does not trigger on the first LSB of noise
+static constexpr int64_t lta_floor_q16 = static_cast<int64_t>(1) << 16;
+
+void StaLtaDetector::init(int sta_shift, int lta_shift, uint32_t trigger_ratio_x16, uint32_t detrigger_ratio_x16){
+    this->sta_shift = sta_shift;
+    this->lta_shift = lta_shift;
+    this->trigger_ratio_x16 = trigger_ratio_x16;
+    this->detrigger_ratio_x16 = detrigger_ratio_x16;
+
+    baseline_q16 = -1;
+    sta_q16 = 0;
+    lta_q16 = 0;
+
+    nbr_values_warmup_left = static_cast<uint32_t>(1) << lta_shift;
+
+    triggered = false;
+    nbr_triggers = 0;
+}
+
+bool StaLtaDetector::register_block(uint16_t const * values_in, size_t nbr_values){
+    bool triggered_in_block = triggered;
+
+    // the first value ever seen gives the initial baseline, rather than converging from 0
+    if ((baseline_q16 < 0) && (nbr_values > 0)){
+        baseline_q16 = static_cast<int64_t>(values_in[0]) << 16;
+    }
+
+    for (size_t i = 0; i < nbr_values; i++){
+        int64_t const value_q16 = static_cast<int64_t>(values_in[i]) << 16;
+        int64_t const centered = (value_q16 - baseline_q16) >> 16;
+        int64_t const energy_q16 = (centered * centered) << 16;
+
+        sta_q16 += (energy_q16 - sta_q16) >> sta_shift;
+
+        if (!triggered){
+            baseline_q16 += (value_q16 - baseline_q16) >> lta_shift;
+            lta_q16 += (energy_q16 - lta_q16) >> lta_shift;
+
+            if (nbr_values_warmup_left > 0){
+                nbr_values_warmup_left -= 1;
+                continue;
+            }
+        }
+
+        int64_t const lta_floored_q16 = (lta_q16 > lta_floor_q16) ? lta_q16 : lta_floor_q16;
+
+        if (!triggered){
+            if (sta_q16 * 16 > static_cast<int64_t>(trigger_ratio_x16) * lta_floored_q16){
+                triggered = true;
+                triggered_in_block = true;
+                nbr_triggers += 1;
+            }
+        }
+        else{
+            if (sta_q16 * 16 < static_cast<int64_t>(detrigger_ratio_x16) * lta_floored_q16){
+                triggered = false;
+            }
+        }
+    }
+
+    return triggered_in_block;
+}
+
+bool StaLtaDetector::is_triggered(void) const{
+    return triggered;
+}
+
+uint32_t StaLtaDetector::get_nbr_triggers(void) const{
+    return nbr_triggers;
+}
+
+uint32_t StaLtaDetector::get_ratio_x16(void) const{
+    int64_t const lta_floored_q16 = (lta_q16 > lta_floor_q16) ? lta_q16 : lta_floor_q16;
+    int64_t const ratio_x16 = sta_q16 * 16 / lta_floored_q16;
+
+    if (ratio_x16 > 0xFFFF){
+        return 0xFFFF;
+    }
+    return static_cast<uint32_t>(ratio_x16);
+}
@@ -0,0 +1,51 @@
+#ifndef STA_LTA_DETECTOR
+#define STA_LTA_DETECTOR
+
+#include <stdint.h>
+#include <stddef.h>
+
+// a recursive STA / LTA (short term average / long term average) event detector, for one ADC channel
+// - the characteristic function is the energy (x - baseline)**2, where the baseline is a slow running mean
+// - STA and LTA are exponential averages of the energy, with time constants 2**sta_shift and 2**lta_shift samples,
+//   so that updating them is only shifts and additions
+// - the detector triggers when STA > trigger_ratio * LTA, and detriggers when STA < detrigger_ratio * LTA;
+//   the LTA (and baseline) are frozen while triggered, so that a long event does not raise its own threshold
+// - no trigger is possible until the LTA has seen 2**lta_shift samples
+// all the state is integer, in Q16 fixed point; the ratios are given in 1/16 units, i.e. 4.0 is 64
+class StaLtaDetector{
+    public:
+        void init(int sta_shift, int lta_shift, uint32_t trigger_ratio_x16, uint32_t detrigger_ratio_x16);
+
+        // run the detector over a block of consecutive values, for example the data of a full BlockADCWithMetadata
+        // return true if the detector was triggered on any of the values of the block
+        bool register_block(uint16_t const * values_in, size_t nbr_values);
+
+        // is the detector triggered after the last value registered
+        bool is_triggered(void) const;
+
+        // how many times the detector went from not triggered to triggered since init
+        uint32_t get_nbr_triggers(void) const;
+
+        // the current STA / LTA ratio, in 1/16 units, saturated to 0xFFFF
+        uint32_t get_ratio_x16(void) const;
+
+    private:
+        // the parameters
+        int sta_shift;
+        int lta_shift;
+        uint32_t trigger_ratio_x16;
+        uint32_t detrigger_ratio_x16;
+
+        // Q16 running values
+        int64_t baseline_q16;
+        int64_t sta_q16;
+        int64_t lta_q16;
+
+        // the LTA is not trusted before it has seen 2**lta_shift values
+        uint32_t nbr_values_warmup_left;
+
+        bool triggered;
+        uint32_t nbr_triggers;
+};
+
+#endif // !STA_LTA_DETECTOR
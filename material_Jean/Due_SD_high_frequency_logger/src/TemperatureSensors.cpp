@@ -11,9 +11,8 @@ void TemperatureSensorsManager::start_sensors(void){
         Serial.println(F("Start temperature sensors"));
     }
 
-    for (size_t i=0; i<extra_length_tmp_msg_buffer; i++){
-        buffer_message[i] = '\0';
-    }
+    memset(&record, 0, sizeof(record));
+    record.nbr_sensors = nbr_temp_sensors;
 
     // reset all temperature sensors
     for (size_t i = 0; i < nbr_temp_sensors; i++){
@@ -29,73 +28,124 @@ void TemperatureSensorsManager::start_sensors(void){
     // get the calibration coefficients of each sensor
     for (size_t i = 0; i < nbr_temp_sensors; i++){
         get_i2c_tmp_sensor_coefficients(i);
+        polynomials[i].init(calibration_data[i]);
     }
 
     delay(10);
 
-    // prepare the message buffer
-    buffer_message[0] = 'T';
-    buffer_message[1] = 'M';
-    buffer_message[2] = 'P';
-    buffer_message[3] = ',';
+    // from now on, the bus is used through the queue only
+    twi_queue.begin();
+    queue_conversions();
+    measurement_phase = MeasurementPhase::starting;
+}
 
-    // set the reference time for start of measurements and start first measurement
-    time_start_measurement_micros = micros() - duration_reading_micros - 1;
-    start_new_measurement();
+void TemperatureSensorsManager::update(void){
+    switch (measurement_phase){
+        case MeasurementPhase::starting:
+            twi_queue.update();
+
+            if (twi_queue.is_finished()){
+                for (size_t crrt_channel = 0; crrt_channel < nbr_temp_sensors; crrt_channel++){
+                    conversion_is_started[crrt_channel] = true;
+                    for (int i = 0; i < nbr_start_transactions_per_sensor; i++){
+                        int const transaction_index = crrt_channel * nbr_start_transactions_per_sensor + i;
+                        conversion_is_started[crrt_channel] &= (twi_queue.get_transaction(transaction_index).status == TwiStatus::done);
+                    }
+                }
+
+                time_start_measurement_micros = micros();
+                measurement_phase = MeasurementPhase::converting;
+            }
+            break;
+
+        case MeasurementPhase::converting:
+            if (micros() - time_start_measurement_micros > duration_reading_micros){
+                queue_readings();
+                measurement_phase = MeasurementPhase::reading;
+            }
+            break;
+
+        case MeasurementPhase::reading:
+            twi_queue.update();
+
+            if (twi_queue.is_finished()){
+                update_record();
+                queue_conversions();
+                measurement_phase = MeasurementPhase::starting;
+            }
+            break;
+    }
 }
 
-void TemperatureSensorsManager::start_new_measurement(void){
-    // if enough tie since last measurement, start a new one
-    if (micros() - time_start_measurement_micros > duration_reading_micros){
+bool TemperatureSensorsManager::record_is_available(void) const{
+    return new_record_is_available;
+}
 
-        if (serial_output){
-            Serial.println(F("start new measurement"));
-        }
+TemperaturesRecord const & TemperatureSensorsManager::get_record(void){
+    new_record_is_available = false;
+    return record;
+}
 
-        time_start_measurement_micros += duration_reading_micros;
+void TemperatureSensorsManager::queue_conversions(void){
+    if (serial_output){
+        Serial.println(F("start new measurement"));
+    }
 
-        // ask for a new measurement on each of the sensors
-        for (uint8_t channel_nbr = 0; channel_nbr < nbr_temp_sensors; channel_nbr++){
-            send_i2c_command_start_tmp_measurement(channel_nbr);
-        }
+    twi_queue.clear();
+
+    // ask for a new measurement on each of the sensors
+    for (uint8_t crrt_channel = 0; crrt_channel < nbr_temp_sensors; crrt_channel++){
+        twi_queue.add_write(TCAADDR, 1 << crrt_channel);
+        twi_queue.add_write(TSYS01_ADDR, TSYS01_ADC_TEMP_CONV);
     }
 }
 
-bool TemperatureSensorsManager::is_available(void){
-    if (micros() - time_start_measurement_micros > duration_reading_micros){
-        return true;
-    }
-    else{
-        return false;
+void TemperatureSensorsManager::queue_readings(void){
+    twi_queue.clear();
+
+    for (uint8_t crrt_channel = 0; crrt_channel < nbr_temp_sensors; crrt_channel++){
+        twi_queue.add_write(TCAADDR, 1 << crrt_channel);
+        twi_queue.add_write(TSYS01_ADDR, TSYS01_ADC_READ);
+        twi_queue.add_read(TSYS01_ADDR, 3);
     }
 }
 
-char * TemperatureSensorsManager::get_message(void){
-    if (is_available()){
-        if (serial_output){
-            Serial.println(F("update temperature message"));
+void TemperatureSensorsManager::update_record(void){
+    if (serial_output){
+        Serial.println(F("update temperature record"));
+    }
+
+    for (size_t crrt_channel = 0; crrt_channel < nbr_temp_sensors; crrt_channel++){
+        // the multiplexer, the command and the reading must all have gone through, else this may be another sensor
+        bool is_valid = conversion_is_started[crrt_channel];
+        for (int i = 0; i < nbr_read_transactions_per_sensor; i++){
+            int const transaction_index = crrt_channel * nbr_read_transactions_per_sensor + i;
+            is_valid &= (twi_queue.get_transaction(transaction_index).status == TwiStatus::done);
         }
 
-        // loop over channels
-        for (size_t crrt_channel = 0; crrt_channel < nbr_temp_sensors; crrt_channel++){
-            // get reading
-            uint32_t crrt_reading = get_i2c_tmp_sensor_reading(crrt_channel);
+        if (!is_valid){
+            record.centi_degrees[crrt_channel] = temperature_no_reading;
+            continue;
+        }
 
-            // convert to temperature
-            float crrt_temperature = convert_i2c_tmp_reading_to_degrees_celcius(crrt_reading, crrt_channel);
+        uint8_t const * const read_bytes = twi_queue.get_transaction(crrt_channel * nbr_read_transactions_per_sensor + 2).read_bytes;
+        uint32_t const crrt_reading = (static_cast<uint32_t>(read_bytes[0]) << 16) | (static_cast<uint32_t>(read_bytes[1]) << 8) | read_bytes[2];
 
-            // add to message
-            size_t position_start_message = 4 + (6 + 1) * crrt_channel;
-            sprintf(&(buffer_message[position_start_message]), "%+06.2f,", crrt_temperature);
-            buffer_message[4 + (6 + 1) * (crrt_channel + 1)] = '\0';
-        }
+        // convert to temperature; the conversion clamps to +-99 degrees, so this fits in an int16
+        record.centi_degrees[crrt_channel] = static_cast<int16_t>(polynomials[crrt_channel].centi_degrees(crrt_reading));
     }
 
+    new_record_is_available = true;
+
     if (serial_output){
-        Serial.println(buffer_message);
+        Serial.print(F("TMP"));
+        for (size_t crrt_channel = 0; crrt_channel < nbr_temp_sensors; crrt_channel++){
+            Serial.print(F(","));
+            Serial.print(record.centi_degrees[crrt_channel]);
+        }
+        Serial.print(F(", failed I2C transactions "));
+        Serial.println(twi_queue.get_nbr_failed());
     }
-
-    return buffer_message;
 }
 
 void TemperatureSensorsManager::set_multiplexer_channel(uint8_t channel_nbr){
@@ -118,14 +168,6 @@ void TemperatureSensorsManager::send_i2c_command_start_tmp_sensor(uint8_t tmp_se
 	Wire.endTransmission();
 }
 
-void TemperatureSensorsManager::send_i2c_command_start_tmp_measurement(uint8_t tmp_sensor_nbr){
-    set_multiplexer_channel(tmp_sensor_nbr);
-
-    Wire.beginTransmission(TSYS01_ADDR);
-	Wire.write(TSYS01_ADC_TEMP_CONV);
-	Wire.endTransmission();
-}
-
 void TemperatureSensorsManager::get_i2c_tmp_sensor_coefficients(uint8_t tmp_sensor_nbr){
     set_multiplexer_channel(tmp_sensor_nbr);
 
@@ -142,43 +184,3 @@ void TemperatureSensorsManager::get_i2c_tmp_sensor_coefficients(uint8_t tmp_sens
         );
 	}
 }
-
-uint32_t TemperatureSensorsManager::get_i2c_tmp_sensor_reading(uint8_t tmp_sensor_nbr){
-    uint32_t result = 0;
-
-    set_multiplexer_channel(tmp_sensor_nbr);
-
-    Wire.beginTransmission(TSYS01_ADDR);
-	Wire.write(TSYS01_ADC_READ);
-	Wire.endTransmission();
-
-	Wire.requestFrom(TSYS01_ADDR, 3);
-
-	result = Wire.read();
-	result = (result << 8) | Wire.read();
-	result = (result << 8) | Wire.read();
-
-    return result;
-}
-
-float TemperatureSensorsManager::convert_i2c_tmp_reading_to_degrees_celcius(uint32_t reading, uint8_t tmp_sensor_nbr){
-    float tmp_value = 0;
-
-    uint32_t adc_16 = reading / 256;
-
-    tmp_value = (-2) * static_cast<float>(calibration_data[tmp_sensor_nbr][1]) / 1000000000000000000000.0f * pow(adc_16, 4) + 
-                4 * static_cast<float>(calibration_data[tmp_sensor_nbr][2]) / 10000000000000000.0f * pow(adc_16, 3) +
-                (-2) * static_cast<float>(calibration_data[tmp_sensor_nbr][3]) / 100000000000.0f * pow(adc_16, 2) +
-                1 * static_cast<float>(calibration_data[tmp_sensor_nbr][4]) / 1000000.0f * adc_16 +
-                (-1.5) * static_cast<float>(calibration_data[tmp_sensor_nbr][5]) / 100 ;
-    
-    if (tmp_value > 99.0){
-        tmp_value = 99.0;
-    }
-
-    if (tmp_value < -99.0){
-        tmp_value = -99.0;
-    }
-
-    return tmp_value;
-}
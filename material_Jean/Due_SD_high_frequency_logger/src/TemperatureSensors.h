@@ -3,11 +3,24 @@
 
 #include <Wire.h>
 #include "params.h"
+#include "TwiTransactionQueue.h"
+#include "Tsys01Polynomial.h"
 
-// TODO: the temperature stuff buffer length and writing if a big mess: FIXME!!!
-// a solution: log each temperature sensor as a cstring separately
-constexpr size_t length_tmp_msg_buffer = 5 + 10 * nbr_temp_sensors + 1;
-constexpr size_t extra_length_tmp_msg_buffer = length_tmp_msg_buffer + 100;
+static_assert(nbr_temp_sensors <= 8, "the multiplexer has 8 channels");
+
+// the value of a sensor that did not answer
+constexpr int16_t temperature_no_reading = INT16_MIN;
+
+// the temperatures of all the sensors, logged as one 'T' record (see FastLogger::log_record)
+// in hundredths of degrees celcius, or temperature_no_reading; padded to a whole nbr of 4 bytes words
+struct TemperaturesRecord{
+    static constexpr uint8_t record_tag = 'T';
+
+    uint16_t nbr_sensors;
+    int16_t centi_degrees[nbr_temp_sensors + 1 - nbr_temp_sensors % 2];
+};
+
+static_assert(sizeof(TemperaturesRecord) % 4 == 0);
 
 constexpr byte TCAADDR = 0x70;
 
@@ -23,35 +36,54 @@ constexpr byte TSYS01_PROM_READ                 = 0XA0;
 // they have fixed I2C address, so using an I2C multiplexer to read them
 // https://learn.adafruit.com/adafruit-tca9548a-1-to-8-i2c-multiplexer-breakout/wiring-and-test
 // this class wraps all the sensors and the multiplexer, in order to provide a single
-// message with all the data
+// record with all the data
+// the measurements go on in the background of the main loop: the conversions are started on all the sensors, and read
+// duration_reading_micros later, through a TwiTransactionQueue, one I2C step per call to update
 class TemperatureSensorsManager{
     public:
         void enable_serial_output(bool enable_serial = true);
 
+        // reset the sensors and read their calibration; this waits for the bus, so it is for the setup only
         void start_sensors(void);
 
-        void start_new_measurement(void);
-        bool is_available(void);
-        char * get_message(void);
+        // one step of the measurements, never waiting; to be called at each main loop
+        void update(void);
+
+        // is a new record ready since the last get_record
+        bool record_is_available(void) const;
+        TemperaturesRecord const & get_record(void);
     
     private:
+        enum class MeasurementPhase{
+            starting,
+            converting,
+            reading
+        };
+
+        // the transactions of each sensor in the queue, in this order
+        static constexpr int nbr_start_transactions_per_sensor = 2;
+        static constexpr int nbr_read_transactions_per_sensor = 3;
+
+        MeasurementPhase measurement_phase = MeasurementPhase::starting;
+        TwiTransactionQueue twi_queue;
+        bool conversion_is_started[nbr_temp_sensors];
+
         unsigned long time_start_measurement_micros = (1 << 31);
         bool serial_output {false};
-        char buffer_message[extra_length_tmp_msg_buffer]; // length should depend on number of sensors; add some extra to avoid bad overflows (bad way to do...)
+        bool new_record_is_available {false};
+        TemperaturesRecord record;
         uint16_t calibration_data[nbr_temp_sensors][8];
+        // the conversion of each sensor, from its calibration_data
+        Tsys01Polynomial polynomials[nbr_temp_sensors];
+
+        void queue_conversions(void);
+        void queue_readings(void);
+        void update_record(void);
 
         void set_multiplexer_channel(uint8_t channel_nbr);
 
         void send_i2c_command_start_tmp_sensor(uint8_t tmp_sensor_nbr);
-        void send_i2c_command_start_tmp_measurement(uint8_t tmp_sensor_nbr);
         void get_i2c_tmp_sensor_coefficients(uint8_t tmp_sensor_nbr);
-        uint32_t get_i2c_tmp_sensor_reading(uint8_t tmp_sensor_nbr);
-        float convert_i2c_tmp_reading_to_degrees_celcius(uint32_t reading, uint8_t tmp_sensor_nbr);
 };
 
 #endif // !TEMPERATURE_SENSOR_HEADER
-
-// TODO
-// have it manage all sensors at the same time? ie go through the multiplexer chip
-// make sure no need to wait too long, by checking the time needed through is_available
-// know in advance how many sensors used
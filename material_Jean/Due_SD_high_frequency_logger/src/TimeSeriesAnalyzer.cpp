@@ -0,0 +1,136 @@
+#include "TimeSeriesAnalyzer.h"
+
+TimeSeriesStatistics to_time_series_statistics(TimeSeriesIntegerStatistics const & integer_stats){
+    TimeSeriesStatistics stats;
+
+    double inverse_nbr_samples = 0.0;
+    if (integer_stats.nbr_samples > 0){
+        inverse_nbr_samples = 1.0 / static_cast<double>(integer_stats.nbr_samples);
+    }
+
+    stats.mean = static_cast<double>(integer_stats.sum) * inverse_nbr_samples;
+    stats.mean_of_square = static_cast<double>(integer_stats.sum_of_squares) * inverse_nbr_samples;
+    stats.max = static_cast<double>(integer_stats.max);
+    stats.min = static_cast<double>(integer_stats.min);
+    stats.extremal_count = integer_stats.extremal_count;
+
+    return stats;
+}
+
+void TimeSeriesAnalyzer::init(int nbr_samples_per_analysis, int middle_value, int threshold_low, int threshold_high){
+    this->nbr_samples_per_analysis = nbr_samples_per_analysis;
+    this->middle_value = middle_value;
+    this->threshold_low = threshold_low;
+    this->threshold_high = threshold_high;
+
+    flag_stats_available = false;
+    reset_filling_stats();
+}
+
+bool TimeSeriesAnalyzer::stats_are_available(void) const{
+    return flag_stats_available;
+}
+
+TimeSeriesStatistics const & TimeSeriesAnalyzer::get_stats(void){
+    flag_stats_available = false;
+    available_stats = to_time_series_statistics(available_integer_stats);
+    return available_stats;
+}
+
+TimeSeriesIntegerStatistics const & TimeSeriesAnalyzer::get_integer_stats(void){
+    flag_stats_available = false;
+    return available_integer_stats;
+}
+
+void TimeSeriesAnalyzer::register_value(int value_in){
+    int32_t value_centered = value_in - middle_value;
+
+    crrt_filling_stats.nbr_samples += 1;
+    crrt_filling_stats.sum += value_centered;
+    crrt_filling_stats.sum_of_squares += static_cast<int64_t>(value_centered) * value_centered;
+
+    if (value_centered > crrt_filling_stats.max){
+        crrt_filling_stats.max = value_centered;
+    }
+    if (value_centered < crrt_filling_stats.min){
+        crrt_filling_stats.min = value_centered;
+    }
+
+    if ( (value_centered > threshold_high) || (value_centered < threshold_low) ){
+        crrt_filling_stats.extremal_count += 1;
+    }
+
+    // what to do if finished with the current working structure
+    if (crrt_filling_stats.nbr_samples >= static_cast<uint32_t>(nbr_samples_per_analysis)){
+        close_filling_stats();
+    }
+}
+
+void TimeSeriesAnalyzer::register_block(uint16_t const * values_in, size_t nbr_values){
+    while (nbr_values > 0){
+        // the part of the block that goes into the current window
+        size_t nbr_values_to_window = static_cast<size_t>(nbr_samples_per_analysis) - crrt_filling_stats.nbr_samples;
+        if (nbr_values_to_window > nbr_values){
+            nbr_values_to_window = nbr_values;
+        }
+
+        // local accumulators, so that the loop stays in registers; a centered value of up to 16 bits squared fits in 32 bits
+        int32_t chunk_sum = 0;
+        int64_t chunk_sum_of_squares = 0;
+        int32_t chunk_max = crrt_filling_stats.max;
+        int32_t chunk_min = crrt_filling_stats.min;
+        uint32_t chunk_extremal_count = 0;
+
+        for (size_t i = 0; i < nbr_values_to_window; i++){
+            int32_t value_centered = static_cast<int32_t>(values_in[i]) - middle_value;
+
+            chunk_sum += value_centered;
+            chunk_sum_of_squares += static_cast<uint32_t>(value_centered * value_centered);
+
+            if (value_centered > chunk_max){
+                chunk_max = value_centered;
+            }
+            if (value_centered < chunk_min){
+                chunk_min = value_centered;
+            }
+
+            if ( (value_centered > threshold_high) || (value_centered < threshold_low) ){
+                chunk_extremal_count += 1;
+            }
+        }
+
+        crrt_filling_stats.nbr_samples += static_cast<uint32_t>(nbr_values_to_window);
+        crrt_filling_stats.sum += chunk_sum;
+        crrt_filling_stats.sum_of_squares += chunk_sum_of_squares;
+        crrt_filling_stats.max = chunk_max;
+        crrt_filling_stats.min = chunk_min;
+        crrt_filling_stats.extremal_count += chunk_extremal_count;
+
+        values_in += nbr_values_to_window;
+        nbr_values -= nbr_values_to_window;
+
+        if (crrt_filling_stats.nbr_samples >= static_cast<uint32_t>(nbr_samples_per_analysis)){
+            close_filling_stats();
+        }
+    }
+}
+
+void TimeSeriesAnalyzer::reset_filling_stats(void){
+    crrt_filling_stats.nbr_samples = 0;
+    crrt_filling_stats.sum = 0;
+    crrt_filling_stats.sum_of_squares = 0;
+    crrt_filling_stats.max = -999999;
+    crrt_filling_stats.min = 999999;
+    crrt_filling_stats.extremal_count = 0;
+}
+
+void TimeSeriesAnalyzer::close_filling_stats(void){
+    // copy the crrt struct to the output one; the conversion to floating point is only done on request
+    available_integer_stats = crrt_filling_stats;
+
+    // reset all crrt analysis values
+    reset_filling_stats();
+
+    // stats are available now
+    flag_stats_available = true;
+}
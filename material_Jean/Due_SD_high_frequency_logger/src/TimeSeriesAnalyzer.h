@@ -0,0 +1,86 @@
+#ifndef TIME_SERIES_ANALYZER
+#define TIME_SERIES_ANALYZER
+
+#include <stdint.h>
+#include <stddef.h>
+
+////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////
+
+// a struct containing statistics about a time series
+struct TimeSeriesStatistics{
+    double mean; // mean(X)
+    double mean_of_square; // mean(X**2)
+    double max; // max value reached
+    double min; // min value reached
+    unsigned long extremal_count; // nbr of readings over or under mean +- percent_threshold
+};
+
+// the exact integer sums the TimeSeriesStatistics are computed from
+// all values are relative to the middle_value of the analyzer
+// these can be dumped and re-computed bit for bit on the host
+struct TimeSeriesIntegerStatistics{
+    uint32_t nbr_samples; // nbr of values in the window
+    int64_t sum; // sum(X)
+    int64_t sum_of_squares; // sum(X**2)
+    int32_t max; // max value reached
+    int32_t min; // min value reached
+    uint32_t extremal_count; // nbr of readings over or under the thresholds
+};
+
+// convert the exact sums into the mean based statistics; only one division is performed
+TimeSeriesStatistics to_time_series_statistics(TimeSeriesIntegerStatistics const & integer_stats);
+
+// a class to take care of tracking time series statistics
+// this will "eat" readings from an ADC channel, and generate on-the-fly stats about this channel
+// the stats are the ones descrived in the TimeSeriesStatistics
+// an updated stat struct is made available regularly, as soon as fully computed
+// all the accumulation is done on int32 / int64; the conversion to TimeSeriesStatistics only happens when a window is full
+class TimeSeriesAnalyzer{
+    public:
+        // nbr_samples_per_analysis: how many values make one stat struct
+        // middle_value: subtracted from each raw value before accumulating
+        // threshold_low, threshold_high: values (after subtracting middle_value) outside of these are counted as extremal
+        void init(int nbr_samples_per_analysis, int middle_value, int threshold_low, int threshold_high);
+
+        // is there a stat struct available readily computed?
+        bool stats_are_available(void) const;
+
+        // get access to the computed stat struct available, and reset the availability flag
+        TimeSeriesStatistics const & get_stats(void);
+
+        // get access to the exact sums behind the available stat struct, and reset the availability flag
+        TimeSeriesIntegerStatistics const & get_integer_stats(void);
+
+        // register a new value inside the current building stat
+        void register_value(int value_in);
+
+        // register a whole block of consecutive values, for example the data of a full BlockADCWithMetadata
+        // this gives exactly the same result as calling register_value on each value in turn, but is much cheaper
+        void register_block(uint16_t const * values_in, size_t nbr_values);
+
+    private:
+        // the analysis parameters
+        int nbr_samples_per_analysis;
+        int middle_value;
+        int threshold_low;
+        int threshold_high;
+
+        // if an unread TimeSeriesStatistics is available
+        bool flag_stats_available;
+
+        // the integer accumulators of the stat under building
+        TimeSeriesIntegerStatistics crrt_filling_stats;
+
+        // reset the stat under buildind and the nbr of registered values
+        void reset_filling_stats(void);
+
+        // turn the accumulators into the available stat and start a new one
+        void close_filling_stats(void);
+
+        // the available stat, both as exact sums and converted
+        TimeSeriesIntegerStatistics available_integer_stats;
+        TimeSeriesStatistics available_stats;
+};
+
+#endif // TIME_SERIES_ANALYZER
@@ -0,0 +1,40 @@
+#include "Tsys01Polynomial.h"
+
+#include <math.h>
+
+void Tsys01Polynomial::init(uint16_t const * calibration){
+    // the datasheet factors, in centi degrees, for x**i
+    double const factors[nbr_coefficients] = {-1.5e-2 * 100, 1e-6 * 100, -2e-11 * 100, 4e-16 * 100, -2e-21 * 100};
+
+    // x = u * 2**16, so the coefficient of u**i gets 2**(16 i)
+    double scale = ldexp(1.0, fraction_bits);
+
+    for (int i = 0; i < nbr_coefficients; i++){
+        double const k_i = calibration[5 - i];
+        coefficients[i] = llround(factors[i] * k_i * scale);
+        scale *= 65536.0;
+    }
+}
+
+int32_t Tsys01Polynomial::centi_degrees(uint32_t reading) const{
+    int64_t const x = reading >> 8;
+
+    // Horner, in Q24: each step multiplies by u, i.e. by x and then shifts by 16; the accumulator stays below 2**45,
+    // so the product fits in 61 bits
+    int64_t accumulator = coefficients[nbr_coefficients - 1];
+    for (int i = nbr_coefficients - 2; i >= 0; i--){
+        accumulator = coefficients[i] + ((accumulator * x) >> 16);
+    }
+
+    int32_t result = static_cast<int32_t>((accumulator + (int64_t{1} << (fraction_bits - 1))) >> fraction_bits);
+
+    if (result > 9900){
+        result = 9900;
+    }
+
+    if (result < -9900){
+        result = -9900;
+    }
+
+    return result;
+}
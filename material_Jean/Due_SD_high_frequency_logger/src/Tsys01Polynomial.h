@@ -0,0 +1,29 @@
+#ifndef TSYS01_POLYNOMIAL
+#define TSYS01_POLYNOMIAL
+
+#include <stdint.h>
+
+// the TSYS01 temperature, from its 24 bits ADC reading and its calibration PROM, as in the datasheet:
+// T = -2 k4 1e-21 x**4 + 4 k3 1e-16 x**3 - 2 k2 1e-11 x**2 + k1 1e-6 x - 1.5 k0 1e-2, with x the 16 high bits of the
+// reading, and k4..k0 the PROM words 1..5
+//
+// the coefficients of each sensor are folded once, at init, into a polynomial of u = x / 2**16 in centi degrees, whose
+// coefficients are at most about 2**20 in magnitude; they are kept as Q24 fixed point, so that a reading is a Horner
+// evaluation with 4 integer multiplications and shifts, instead of the float powers
+class Tsys01Polynomial{
+    public:
+        // calibration: the 8 words of the PROM, as read at 0xA0, 0xA2, ... 0xAE
+        void init(uint16_t const * calibration);
+
+        // the temperature in centi degrees, clamped to +-99 degrees
+        int32_t centi_degrees(uint32_t reading) const;
+
+    private:
+        static constexpr int nbr_coefficients = 5;
+        static constexpr int fraction_bits = 24;
+
+        // coefficients[i] is for u**i
+        int64_t coefficients[nbr_coefficients];
+};
+
+#endif // !TSYS01_POLYNOMIAL
@@ -0,0 +1,167 @@
+#include "TwiTransactionQueue.h"
+
+void TwiTransactionQueue::begin(){
+    clock_waveform = WIRE_INTERFACE->TWI_CWGR;
+    nbr_failed = 0;
+    clear();
+}
+
+int TwiTransactionQueue::add_transaction(uint8_t address, uint8_t byte_to_write, uint8_t nbr_bytes_to_read){
+    if ((nbr_transactions >= twi_max_nbr_transactions) || (nbr_bytes_to_read > twi_max_nbr_bytes_to_read)){
+        return -1;
+    }
+
+    TwiTransaction & transaction = transactions[nbr_transactions];
+    transaction.address = address;
+    transaction.byte_to_write = byte_to_write;
+    transaction.nbr_bytes_to_read = nbr_bytes_to_read;
+    transaction.nbr_bytes_read = 0;
+    transaction.status = TwiStatus::queued;
+    memset(transaction.read_bytes, 0, sizeof(transaction.read_bytes));
+
+    nbr_transactions += 1;
+
+    return static_cast<int>(nbr_transactions - 1);
+}
+
+int TwiTransactionQueue::add_write(uint8_t address, uint8_t byte_to_write){
+    return add_transaction(address, byte_to_write, 0);
+}
+
+int TwiTransactionQueue::add_read(uint8_t address, uint8_t nbr_bytes_to_read){
+    if (nbr_bytes_to_read == 0){
+        return -1;
+    }
+
+    return add_transaction(address, 0, nbr_bytes_to_read);
+}
+
+void TwiTransactionQueue::update(){
+    if (is_finished()){
+        return;
+    }
+
+    TwiTransaction & transaction = transactions[crrt_transaction_index];
+
+    if (crrt_phase == Phase::start){
+        start_transaction(transaction);
+        return;
+    }
+
+    // reading the status clears NACK, so it is read once
+    uint32_t const status = WIRE_INTERFACE->TWI_SR;
+
+    if (status & (TWI_SR_NACK | TWI_SR_ARBLST)){
+        finish_transaction(TwiStatus::failed);
+        return;
+    }
+
+    switch (crrt_phase){
+        case Phase::wait_byte_sent:
+            if (status & TWI_SR_TXRDY){
+                WIRE_INTERFACE->TWI_CR = TWI_CR_STOP;
+                crrt_phase = Phase::wait_complete;
+                micros_last_progress = micros();
+                return;
+            }
+            break;
+
+        case Phase::wait_byte_received:
+            if (status & TWI_SR_RXRDY){
+                transaction.read_bytes[transaction.nbr_bytes_read] = static_cast<uint8_t>(WIRE_INTERFACE->TWI_RHR);
+                transaction.nbr_bytes_read += 1;
+
+                if (transaction.nbr_bytes_read == transaction.nbr_bytes_to_read){
+                    crrt_phase = Phase::wait_complete;
+                }
+                // the stop must be asked for while the last byte is received
+                else if (transaction.nbr_bytes_read + 1 == transaction.nbr_bytes_to_read){
+                    WIRE_INTERFACE->TWI_CR = TWI_CR_STOP;
+                }
+                micros_last_progress = micros();
+                return;
+            }
+            break;
+
+        case Phase::wait_complete:
+            if (status & TWI_SR_TXCOMP){
+                finish_transaction(TwiStatus::done);
+                return;
+            }
+            break;
+
+        case Phase::start:
+            break;
+    }
+
+    // measured from the last step that went through, so that a slow main loop pass between 2 steps is not taken for a
+    // stuck bus
+    if (micros() - micros_last_progress > i2c_transaction_timeout_micros){
+        finish_transaction(TwiStatus::failed);
+    }
+}
+
+void TwiTransactionQueue::start_transaction(TwiTransaction & transaction){
+    Twi * const twi = WIRE_INTERFACE;
+
+    transaction.status = TwiStatus::running;
+    micros_last_progress = micros();
+
+    // no internal address: the command is a data byte, as with Wire
+    twi->TWI_MMR = 0;
+    twi->TWI_IADR = 0;
+
+    if (transaction.nbr_bytes_to_read == 0){
+        twi->TWI_MMR = TWI_MMR_DADR(transaction.address);
+        // writing the byte starts the transfer
+        twi->TWI_THR = transaction.byte_to_write;
+        crrt_phase = Phase::wait_byte_sent;
+    }
+    else{
+        twi->TWI_MMR = TWI_MMR_DADR(transaction.address) | TWI_MMR_MREAD;
+        twi->TWI_CR = (transaction.nbr_bytes_to_read == 1) ? (TWI_CR_START | TWI_CR_STOP) : TWI_CR_START;
+        crrt_phase = Phase::wait_byte_received;
+    }
+}
+
+void TwiTransactionQueue::finish_transaction(TwiStatus status){
+    transactions[crrt_transaction_index].status = status;
+
+    if (status == TwiStatus::failed){
+        nbr_failed += 1;
+        reset_twi();
+    }
+
+    crrt_transaction_index += 1;
+    crrt_phase = Phase::start;
+}
+
+void TwiTransactionQueue::reset_twi(){
+    Twi * const twi = WIRE_INTERFACE;
+
+    // as Wire sets up the master mode
+    twi->TWI_CR = TWI_CR_SVDIS;
+    twi->TWI_CR = TWI_CR_SWRST;
+    (void) twi->TWI_RHR;
+    twi->TWI_CR = TWI_CR_MSDIS | TWI_CR_SVDIS;
+    twi->TWI_CR = TWI_CR_MSEN;
+    twi->TWI_CWGR = clock_waveform;
+}
+
+bool TwiTransactionQueue::is_finished() const{
+    return crrt_transaction_index >= nbr_transactions;
+}
+
+TwiTransaction const & TwiTransactionQueue::get_transaction(int index) const{
+    return transactions[index];
+}
+
+void TwiTransactionQueue::clear(){
+    nbr_transactions = 0;
+    crrt_transaction_index = 0;
+    crrt_phase = Phase::start;
+}
+
+uint32_t TwiTransactionQueue::get_nbr_failed() const{
+    return nbr_failed;
+}
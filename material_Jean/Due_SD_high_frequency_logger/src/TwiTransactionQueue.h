@@ -0,0 +1,96 @@
+#ifndef TWI_TRANSACTION_QUEUE
+#define TWI_TRANSACTION_QUEUE
+
+#include "Arduino.h"
+
+#include "params.h"
+
+// I2C transactions on the TWI of Wire (WIRE_INTERFACE, i.e. TWI1 on SDA 20 / SCL 21), without ever waiting for the bus
+// the transactions are queued, and each call to update does at most one step of the current one (start it, or act on
+// one byte sent / byte received / transfer complete flag), reading the TWI status register once; the rest of the main
+// loop goes on between the steps, instead of waiting for the bus as Wire does
+// the steps are the same as in Wire::endTransmission and Wire::requestFrom, so the sensors see the same transfers
+//
+// the TWI interrupt cannot be used here, as the Due core Wire library already has the TWI1_Handler (for the slave mode);
+// at 100kHz, a byte takes 90 micros, so the main loop polling the status register is about as reactive
+//
+// a transaction that gets a NACK, or whose next step does not come within i2c_transaction_timeout_micros, fails; the
+// TWI is then reset, so that a dead or stuck device cannot freeze the bus, and the next transactions go on
+// Wire must have been started (Wire.begin, Wire.setClock) before begin, and not be used while transactions are queued
+
+// at most 8 sensors on the multiplexer, with 3 transactions each per measurement
+constexpr size_t twi_max_nbr_transactions = 24;
+constexpr size_t twi_max_nbr_bytes_to_read = 4;
+
+enum class TwiStatus : uint8_t{
+    queued,
+    running,
+    done,
+    failed
+};
+
+// either a write of one byte (nbr_bytes_to_read is 0), or a read of nbr_bytes_to_read bytes
+struct TwiTransaction{
+    uint8_t address;
+    uint8_t byte_to_write;
+    uint8_t nbr_bytes_to_read;
+    uint8_t nbr_bytes_read;
+    TwiStatus status;
+    uint8_t read_bytes[twi_max_nbr_bytes_to_read];
+};
+
+class TwiTransactionQueue{
+    public:
+        // take over the TWI, as set up by Wire
+        void begin();
+
+        // queue a transaction; return its index, or -1 if the queue is full
+        int add_write(uint8_t address, uint8_t byte_to_write);
+        int add_read(uint8_t address, uint8_t nbr_bytes_to_read);
+
+        // one step of the current transaction
+        void update();
+
+        // are all the queued transactions done or failed
+        bool is_finished() const;
+
+        TwiTransaction const & get_transaction(int index) const;
+
+        // forget all the transactions, to queue the next ones; only once is_finished
+        void clear();
+
+        // the nbr of transactions that failed since begin
+        uint32_t get_nbr_failed() const;
+
+    private:
+        enum class Phase{
+            start,
+            wait_byte_sent,
+            wait_byte_received,
+            wait_complete
+        };
+
+        TwiTransaction transactions[twi_max_nbr_transactions];
+        size_t nbr_transactions = 0;
+        size_t crrt_transaction_index = 0;
+
+        Phase crrt_phase = Phase::start;
+        // when the current transaction was started, or last made a step
+        unsigned long micros_last_progress = 0;
+
+        // the clock setting of Wire, to restore after a reset
+        uint32_t clock_waveform = 0;
+
+        uint32_t nbr_failed = 0;
+
+        int add_transaction(uint8_t address, uint8_t byte_to_write, uint8_t nbr_bytes_to_read);
+
+        void start_transaction(TwiTransaction & transaction);
+
+        void finish_transaction(TwiStatus status);
+
+        // put the TWI back in master mode, ending any transfer
+        void reset_twi();
+};
+
+#endif // !TWI_TRANSACTION_QUEUE
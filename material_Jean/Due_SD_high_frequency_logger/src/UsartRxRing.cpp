@@ -0,0 +1,59 @@
+#include "UsartRxRing.h"
+
+void UsartRxRing::begin(Usart * usart, char * ring, size_t ring_nbr_chars){
+    this->usart = usart;
+    this->ring = ring;
+    this->ring_nbr_chars = ring_nbr_chars;
+    nbr_laps = 0;
+    nbr_restarts = 0;
+
+    // the chars now go to the PDC only
+    usart->US_IDR = US_IDR_RXRDY | US_IDR_OVRE | US_IDR_FRAME;
+    usart->US_PTCR = US_PTCR_RXTDIS;
+
+    // what the core may have received is not wanted
+    (void) usart->US_RHR;
+    usart->US_CR = US_CR_RSTSTA;
+
+    usart->US_RPR = reinterpret_cast<uintptr_t>(ring);
+    usart->US_RCR = ring_nbr_chars;
+    usart->US_RNPR = reinterpret_cast<uintptr_t>(ring);
+    usart->US_RNCR = ring_nbr_chars;
+
+    usart->US_PTCR = US_PTCR_RXTEN;
+}
+
+uint32_t UsartRxRing::update(void){
+    // the PDC may move from the current to the next buffer between the 2 reads, so read until both agree
+    uint32_t nbr_next;
+    uintptr_t pointer;
+    do{
+        nbr_next = usart->US_RNCR;
+        pointer = usart->US_RPR;
+    } while (nbr_next != usart->US_RNCR);
+
+    // the PDC has gone on with the next buffer, i.e. is on a new lap
+    if (nbr_next == 0){
+        nbr_laps += 1;
+
+        // the current buffer is full as well: the PDC has stopped; start it again on a new lap, the framer then sees
+        // that more than a ring of chars went by
+        if (usart->US_RCR == 0){
+            nbr_laps += 1;
+            nbr_restarts += 1;
+            usart->US_CR = US_CR_RSTSTA;
+            usart->US_RPR = reinterpret_cast<uintptr_t>(ring);
+            usart->US_RCR = ring_nbr_chars;
+            pointer = reinterpret_cast<uintptr_t>(ring);
+        }
+
+        usart->US_RNPR = reinterpret_cast<uintptr_t>(ring);
+        usart->US_RNCR = ring_nbr_chars;
+    }
+
+    return nbr_laps * ring_nbr_chars + static_cast<uint32_t>(pointer - reinterpret_cast<uintptr_t>(ring));
+}
+
+uint32_t UsartRxRing::get_nbr_restarts(void) const{
+    return nbr_restarts;
+}
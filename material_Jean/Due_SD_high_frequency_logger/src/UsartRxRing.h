@@ -0,0 +1,38 @@
+#ifndef USART_RX_RING
+#define USART_RX_RING
+
+#include "Arduino.h"
+
+// receive a USART into a ring buffer with its PDC (the peripheral DMA), so that no char is lost while the main loop is
+// busy, for example with the SD card: the chars land in the ring without the CPU, as long as update is called at least
+// once per ring length of chars (about 2 seconds for 2048 chars at 9600 baud)
+//
+// the PDC receives into the whole ring, with the whole ring again as its next buffer: when it reaches the end of the
+// ring, it goes on from the start by itself, and update gives it the next lap
+// the USART interrupt of the core (USARTClass::IrqHandler, for Serial1 / 2 / 3) cannot be replaced, as the core
+// defines it; so the core serial is started as usual, and begin turns off its receive interrupts, so that the core
+// does not take the chars from the PDC; sending through the core serial still works
+class UsartRxRing{
+    public:
+        // take over the receive side of usart, once its core serial is started; ring_nbr_chars must be a power of 2
+        void begin(Usart * usart, char * ring, size_t ring_nbr_chars);
+
+        // give the PDC its next lap if it needs one; return the total nbr of chars received since begin, as a free
+        // running count (see NmeaFramer), the next char being at ring[count % ring_nbr_chars]
+        uint32_t update(void);
+
+        // the nbr of times the PDC had stopped, i.e. update was called too late and chars were lost
+        uint32_t get_nbr_restarts(void) const;
+
+    private:
+        Usart * usart = nullptr;
+        char * ring = nullptr;
+        uint32_t ring_nbr_chars = 0;
+
+        // the nbr of times the PDC went through the whole ring
+        uint32_t nbr_laps = 0;
+
+        uint32_t nbr_restarts = 0;
+};
+
+#endif // !USART_RX_RING
@@ -52,10 +52,15 @@
 
 #include <SonarManager.h>
 
+#include <PpsTimebase.h>
+
 FastLogger fast_logger;
 
 GPSManager gps_manager;
 
+// the UTC time of the micros, from the PPS and the RMC of the GPS; stamps the ADC blocks
+PpsTimebase pps_timebase;
+
 TemperatureSensorsManager temperature_sensors_manager;
 
 SonarManager sonar_manager;
@@ -94,6 +99,7 @@ void setup() {
     fast_logger.disable_SD();
   }
 
+  fast_logger.set_timebase(&pps_timebase);
   fast_logger.start_recording();
   gps_manager.start_gps();
   temperature_sensors_manager.start_sensors();
@@ -114,50 +120,46 @@ void loop() {
 
   if (fast_logger.is_active()){
 
-    // take care of the sonar
-
-    // TODO: remove me: this is for debugging only
-    if (use_serial_debug){
-      Serial.flush();
-    }
+    // take care of the sonar; this only reads the bytes already received
+    sonar_manager.update();
 
-    if (sonar_manager.ready_to_measure()){
+    fast_logger.internal_update();
+    // take care of the GPS and log the GPS output
+    gps_manager.update_status();
+    // the sentences are logged straight from the GPS ring; they go before the PPS, so that after a long pass, the RMC
+    // of a second is still logged and registered before the edge of the next second
+    while (gps_manager.message_available()){
       if (use_serial_debug){
-        Serial.println(F("SNR updt"));
-        // TODO: remove
-        Serial.flush();
+        Serial.println(F("GPS updt"));
       }
-      sonar_manager.measure_and_log();
+      NmeaSentenceView const & sentence = gps_manager.get_message();
+      fast_logger.log_message(sentence.chars, sentence.nbr_chars, sentence.chars_continued, sentence.nbr_chars_continued);
+      pps_timebase.register_sentence(sentence, micros());
     }
 
     fast_logger.internal_update();
-    // take care of the GPS and log the GPS output
-    gps_manager.update_status();
+
     if (gps_manager.pps_available()){
       if (use_serial_debug){
         Serial.println(F("PPS updt"));
       }
       fast_logger.log_cstring(gps_manager.get_pps_message());
-    }
 
-    fast_logger.internal_update();
-
-    if (gps_manager.message_available()){
-      if (use_serial_debug){
-        Serial.println(F("GPS updt"));
+      pps_timebase.register_pps(gps_manager.get_pps_micros());
+      if (pps_timebase.is_valid()){
+        fast_logger.log_record(pps_timebase.get_record());
       }
-      fast_logger.log_cstring(gps_manager.get_message());
     }
 
     fast_logger.internal_update();
 
-    // take care of the temperature sensors
-    if (temperature_sensors_manager.is_available()){
+    // take care of the temperature sensors; this only does one I2C step at a time
+    temperature_sensors_manager.update();
+    if (temperature_sensors_manager.record_is_available()){
       if (use_serial_debug){
         Serial.println(F("TMP updt"));
       }
-      fast_logger.log_cstring(temperature_sensors_manager.get_message());
-      temperature_sensors_manager.start_new_measurement();
+      fast_logger.log_record(temperature_sensors_manager.get_record());
     }
 
     fast_logger.internal_update();
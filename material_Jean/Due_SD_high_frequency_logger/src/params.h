@@ -6,6 +6,8 @@
 #include "Arduino.h"
 #include "SdFat.h"
 
+#include "AdcChannels.h"
+
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
 // some I2C properties
@@ -14,6 +16,10 @@
 constexpr unsigned long i2c_timeout_micro_seconds = 100UL;
 constexpr unsigned long i2c_clock_frequency = 100000UL;  // I think the default is 100000UL; may need to test by hand which values work
 
+// the longest a step of a TwiTransactionQueue transaction (a byte sent or received, the stop) may take before the
+// transaction is given up and the TWI reset; a byte is about 0.1ms at 100kHz
+constexpr unsigned long i2c_transaction_timeout_micros = 2000UL;
+
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
 // parameters related to the ADC channels logging
@@ -28,15 +34,44 @@ constexpr unsigned long i2c_clock_frequency = 100000UL;  // I think the default
 //      A5    AD2
 //      A6    AD1
 //      A7    AD
-constexpr uint8_t adc_channels[] = {7, 6, 5, 4, 3};
-constexpr int nbr_of_adc_channels = sizeof(adc_channels);
-
-// the frequency of logging, in samples per seconds, ie 1000 for 1kHz
+// the channel list is a template parameter, so that the ADC setup and ISR are specialised for it at compile time
+// (unrolled reads, constant register addresses and enable mask, exactly sized buffers)
+using AdcChannels = AdcChannelSet<7, 6, 5, 4, 3>;
+constexpr auto & adc_channels = AdcChannels::channel_numbers;
+constexpr int nbr_of_adc_channels = AdcChannels::nbr_channels;
+
+// the frequency of logging at boot, in samples per seconds, ie 1000 for 1kHz
+// it can be changed without reflashing with FastLogger::request_sampling_frequency, and takes effect at the next file
+// the ADC prescaler and trigger timer are computed from it and the nbr of channels, see AdcTiming.h
 constexpr int adc_sampling_frequency = 1000;
 // constexpr int adc_sampling_frequency = 100;
 
-// the prescaler should be 100 for 1kHz, 15 for 10kHz, 2 for 100kHz
-constexpr uint8_t adc_prescale = 100;
+// how the ADC conversions are collected
+// false: one ADC interrupt per scan, the ISR reads every channel register and fills the blocks sample by sample
+// true: the ADC PDC (DMA) fills a whole buffer of scans (one per ADC block), chaining buffers through ADC_RNPR / ADC_RNCR,
+//       and the CPU only gets one interrupt per completed block; this is what allows going to 10s of kHz
+constexpr bool adc_use_pdc = true;
+
+// oversampling: the ADC is triggered at adc_oversampling_ratio * adc_sampling_frequency, and a CIC decimator of order
+// adc_cic_order per channel brings each channel back to adc_sampling_frequency, which is what gets logged
+// - 1 disables this: the raw 12 bits ADC values are logged
+// - above 1, the logged values are 16 bits (the 12 bits full scale times 16), the averaging adding effective bits and
+//   the CIC rejecting what would alias onto the logged band; the CIC also has a group delay of
+//   adc_cic_order * (adc_oversampling_ratio - 1) / 2 ADC samples, not compensated in the timestamps
+// - this needs adc_use_pdc, and must divide the nbr of samples per ADC block (250)
+// - the ADC prescaler is computed for the acquisition frequency, i.e. adc_oversampling_ratio times the logged one
+constexpr int adc_oversampling_ratio = 1;
+constexpr int adc_cic_order = 3;
+constexpr int adc_acquisition_frequency = adc_sampling_frequency * adc_oversampling_ratio;
+static_assert((adc_oversampling_ratio == 1) || adc_use_pdc, "ADC oversampling needs adc_use_pdc");
+
+// if the ADC data are logged as lossless compressed 'R' blocks (first differences and Rice coding, see RiceBlockCodec.h)
+// rather than raw 'A' blocks; each 'R' block holds one channel, and a variable nbr of samples
+// this only applies to the continuous ADC logging, not to the event files and decimated blocks of event_logging
+constexpr bool adc_compression = false;
+
+// the nbr of bits of the logged ADC values
+constexpr int adc_logged_bits = (adc_oversampling_ratio > 1) ? 16 : 12;
 
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
@@ -44,11 +79,43 @@ constexpr uint8_t adc_prescale = 100;
 
 // how often to report an updated statistics
 constexpr int nbr_of_seconds_per_analysis = 0.1 * 60;  // i.e. nbr_minutes * seconds_per_minute
-constexpr int nbr_of_samples_per_analysis = nbr_of_seconds_per_analysis * adc_sampling_frequency;
-constexpr int middle_adc_value = (0b1 << (12-1)) -1;
+constexpr int middle_adc_value = (0b1 << (adc_logged_bits-1)) -1;
 constexpr float threshold_extrema = 0.20;
-constexpr int threshold_low = static_cast<int>(threshold_extrema * ((0b1 << 12) - 1) - middle_adc_value);
-constexpr int threshold_high = static_cast<int>((1.0 - threshold_extrema) * ((0b1 << 12) - 1) - middle_adc_value);
+constexpr int threshold_low = static_cast<int>(threshold_extrema * ((0b1 << adc_logged_bits) - 1) - middle_adc_value);
+constexpr int threshold_high = static_cast<int>((1.0 - threshold_extrema) * ((0b1 << adc_logged_bits) - 1) - middle_adc_value);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+// parameters for event triggered logging
+
+// false: all ADC samples are logged continuously to the F*.bin files
+// true: the F*.bin files only get the ADC data decimated by event_decimation_ratio ('D' blocks); a STA / LTA detector
+//       runs on each channel, and when any channel in event_detection_channel_mask triggers, the full rate ADC blocks
+//       are written to a dedicated E*.bin event file, starting event_pretrigger_seconds before the trigger (taken from
+//       the last ADC blocks kept in RAM) and ending event_posttrigger_seconds after the detrigger
+constexpr bool event_logging = false;
+
+// STA and LTA time constants, as log2 of a number of samples: 2**5 = 32ms and 2**12 = 4s at 1kHz
+constexpr int event_sta_shift = 5;
+constexpr int event_lta_shift = 12;
+
+// trigger when STA > 4 * LTA, detrigger when STA < 2 * LTA; in 1/16 units
+constexpr uint32_t event_trigger_ratio_x16 = 4 * 16;
+constexpr uint32_t event_detrigger_ratio_x16 = 2 * 16;
+
+// which channels (bit i is adc_channels[i]) can trigger an event
+constexpr uint32_t event_detection_channel_mask = (0b1 << nbr_of_adc_channels) - 1;
+
+// how much is logged around an event; the pre trigger is limited by the free blocks of the block pool
+constexpr float event_pretrigger_seconds = 2.0;
+constexpr float event_posttrigger_seconds = 5.0;
+
+// the longest event file; a longer event continues in a new file, without pre trigger
+constexpr int event_max_duration_seconds = 60;
+
+// the decimation of the continuous data, through a CIC of order event_decimation_cic_order; must divide 250
+constexpr int event_decimation_ratio = 10;
+constexpr int event_decimation_cic_order = 2;
 
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
@@ -59,6 +126,25 @@ constexpr int threshold_high = static_cast<int>((1.0 - threshold_extrema) * ((0b
 // constexpr int logger_file_duration_seconds = 15;
 constexpr int logger_file_duration_seconds = 15;
 
+// the full char and record blocks wait in a queue until internal_update writes them, after the ADC blocks, so that
+// logging a message never waits for the SD card; the blocks themselves come from the block pool, this is only how many
+// can wait at a time; a block that does not fit in a full queue is dropped, and its chars or records counted as dropped
+constexpr int log_write_queue_nbr_blocks = 16;
+
+// internal_update always writes the ADC blocks first, and switches files when due; the work that can wait (the stats
+// records, the queued char and record blocks, the telemetry, getting the next file ready) is only done while the free
+// blocks of the pool would last the ADC at least scheduler_min_slack_block_sets block periods, i.e. while a slow SD
+// write cannot make the ADC drop samples; the queued char and record blocks are written anyway once half the queue is used
+constexpr int scheduler_min_slack_block_sets = 3;
+
+// how often to log the loss accounting (OVRN message: sequence number of the next ADC block, nbr of samples per channel
+// dropped for lack of free blocks, nbr of ADC conversion overruns, nbr of chars dropped for lack of free blocks or of
+// room in the log write queue, nbr of file header and index blocks that could not be written); these are totals since
+// start_recording
+// at the same time, a 'T' telemetry block gets the SD write latency and internal_update duration histograms, and the
+// lowest nbr of free blocks, over the period (see BlockTelemetryWithMetadata)
+constexpr int telemetry_period_seconds = 60;
+
 // which kind of card format is used
 // this is what works on my 32 GB SD card
 typedef SdFs sd_t;
@@ -67,17 +153,57 @@ typedef FsFile file_t;
 // typedef SdExFat sd_t;
 // typedef ExFile file_t;
 
+// if the blocks are streamed to the card as one multi-block write over the contiguous pre-allocated file (much less
+// overhead per block), rather than written one by one through the file system; see SdBlockStream.h
+constexpr bool sd_use_raw_streaming = true;
+
+// when getting the next file ready in advance, how many of its sectors to erase per step; erased sectors are faster
+// to write, and a file that was never closed (power loss) ends with erased sectors rather than with old data
+constexpr uint32_t sd_nbr_sectors_erased_per_step = 2048;
+
+// the SRAM of the Due, and how much of it the rest of the firmware uses (core, SdFat and its cache, the managers, the
+// analyzers, compressed and decimated blocks, stack, etc); the rest, less the ADC PDC buffers, is the pool of 512 bytes
+// blocks shared by the ADC and the chars, i.e. the buffering against SD card write stalls (see FastLogger.h)
+// if the firmware grows, this must grow too, otherwise the link fails (RAM overflow) or the stack runs into the data
+constexpr size_t sram_nbr_bytes = 96 * 1024;
+constexpr size_t sram_nbr_bytes_reserved = 47 * 1024;
+
+// each F file starts with a header block, and ends with file_index_nbr_blocks index blocks telling where the blocks of
+// each type are, at file_index_nbr_entries_per_type regularly spaced times (see BlockIndexWithMetadata)
+// the index holds 41 entries per block, for all the block types in the file together; once full, the end of the file
+// is not indexed
+constexpr int file_index_nbr_entries_per_type = 32;
+constexpr int file_index_nbr_blocks = 4;
+
+// the F files are checked by groups of file_check_group_nbr_blocks blocks, the last one of each group holding the CRCs
+// of the others (see BlockCheckWithMetadata); after a power loss, the blocks after the last complete group are lost, so
+// a smaller group loses less, at the cost of more check blocks
+constexpr int file_check_group_nbr_blocks = 32;
+static_assert((file_check_group_nbr_blocks >= 2) && (file_check_group_nbr_blocks <= 120), "the CRCs must fit in one block");
+
 // which slave select pin to use
 // the default SS pin on due is the digital pin 10
 const uint8_t sd_card_select_pin = SS;
 
+// the SPI clock of the SD card, in MHz; the Due divides its 84 MHz clock, so this is rounded down to 84 / n MHz
+// env:sd_benchmark (see sd_benchmark/SdBenchmark.cpp) tells which clocks a given card sustains
+constexpr uint32_t sd_spi_clock_mhz = 25;
+
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
 // parameters related to the GPS
 
 constexpr HardwareSerial * selected_gps_serial = &Serial1;
+// the USART behind selected_gps_serial (Serial1: USART0, Serial2: USART1, Serial3: USART3), whose PDC receives the GPS
+// chars, see UsartRxRing
+Usart * const selected_gps_usart = USART0;
 constexpr uint8_t selected_PPS_digital_pin = 2;
 
+// the ring the GPS chars are received into; must be a power of 2; the main loop must look at it at least once per ring
+// length of chars, i.e. about 2 seconds at 9600 baud for 2048 chars
+constexpr size_t gps_rx_ring_nbr_chars = 2048;
+static_assert((gps_rx_ring_nbr_chars & (gps_rx_ring_nbr_chars - 1)) == 0, "the GPS ring must be a power of 2");
+
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
 // parameters related to the temperature sensors
@@ -101,4 +227,9 @@ constexpr unsigned long duration_reading_micros = 100000UL;
 constexpr HardwareSerial * selected_sonar_serial = &Serial2;
 constexpr unsigned long sample_period_sonar_ms = 1000UL;
 
+// how long to wait for the answer of the sonar; at 9600 baud, a profile message (236 bytes) takes about 250ms to come
+// must be below sample_period_sonar_ms
+constexpr unsigned long sonar_answer_timeout_ms = 800UL;
+static_assert(sonar_answer_timeout_ms < sample_period_sonar_ms, "the answer must come before the next request");
+
 #endif // !PARAMS_HFLOGGER
\ No newline at end of file
@@ -0,0 +1,427 @@
+// SD card qualification: a firmware of its own (env:sd_benchmark), that replays the write pattern of FastLogger on a
+// card, for the ADC channels and sampling frequency of params.h, at a range of SPI clocks, and tells if the card keeps up
+// to use: > pio run -e sd_benchmark -t upload, then > pio device monitor -e sd_benchmark
+//
+// for each SPI clock:
+// - a burst of back to back block writes to a pre-allocated file gives the raw throughput
+// - a replay of the logging, in real time: the ADC block sets come at the sampling frequency, the char and record blocks
+//   at benchmark_nbr_aux_blocks_per_second, a check block after each file_check_group_nbr_blocks - 1 blocks, and files of
+//   logger_file_duration_seconds with their header and index blocks, pre-allocated and erased in the idle time, as
+//   FastLogger does; the blocks produced and not written yet are what the block pool of the logger has to hold
+//
+// each SPI clock gives a line:
+// BNCH,spi_mhz,throughput_kB_per_s,p99_write_micros,max_write_micros,min_safe_nbr_blocks,verdict
+// where min_safe_nbr_blocks is the largest backlog plus the ADC block set being filled, and the verdict is GO if this
+// fits benchmark_pool_safety_factor times in the block pool of the logger (nbr_blocks_in_pool)
+// the last line is the verdict at the SPI clock the logger uses (sd_spi_clock_mhz): CARD,GO or CARD,NO GO
+//
+// only the BNCH*.bin files are written, and they are removed at the end; the other files on the card are left as they are
+
+#include "Arduino.h"
+#include "SdFat.h"
+
+#include <params.h>
+#include <FastLogger.h>
+#include <SdBlockStream.h>
+
+// the SPI clocks to try, from the one the logger uses upward; the Due rounds them down to 84 / n MHz
+constexpr uint32_t benchmark_spi_clocks_mhz[] = {sd_spi_clock_mhz, 28, 42, 84};
+
+// the replay lasts benchmark_nbr_files files, i.e. as many file rotations
+constexpr int benchmark_nbr_files = 4;
+
+// the chars and records; this is what FastLogger::file_preallocate_size allows for
+constexpr int benchmark_nbr_aux_blocks_per_second = 2;
+
+// the burst, 4 MB
+constexpr uint32_t benchmark_nbr_burst_blocks = 8192;
+
+// how many times the largest backlog must fit in the block pool
+constexpr int benchmark_pool_safety_factor = 2;
+
+// the write durations, in bins of latency_bin_micros, the last bin taking anything longer
+constexpr uint32_t latency_bin_micros = 50;
+constexpr size_t nbr_latency_bins = 4000;
+
+sd_t sd_object;
+file_t benchmark_files[2];
+SdBlockStream benchmark_streams[2];
+char benchmark_filenames[2][16];
+int benchmark_file_number = 0;
+
+// what is written; the content does not matter to the card, but is not all 0s or 1s either
+uint8_t benchmark_block[512];
+
+uint32_t latency_counts[nbr_latency_bins];
+uint32_t nbr_latencies = 0;
+uint32_t max_latency_micros = 0;
+bool all_writes_succeeded = true;
+
+// the preparation of the next file in the idle time, as in FastLogger::prepare_next_file_step
+enum class PrepareStep{
+    close_previous,
+    open,
+    pre_allocate,
+    erase,
+    ready
+};
+
+PrepareStep next_file_step = PrepareStep::open;
+uint32_t next_file_crrt_erase_sector = 0;
+uint32_t next_file_last_erase_sector = 0;
+
+void reset_latencies(){
+    memset(latency_counts, 0, sizeof(latency_counts));
+    nbr_latencies = 0;
+    max_latency_micros = 0;
+    all_writes_succeeded = true;
+}
+
+void register_latency(uint32_t duration_micros){
+    size_t bin = duration_micros / latency_bin_micros;
+    if (bin >= nbr_latency_bins){
+        bin = nbr_latency_bins - 1;
+    }
+
+    latency_counts[bin] += 1;
+    nbr_latencies += 1;
+
+    if (duration_micros > max_latency_micros){
+        max_latency_micros = duration_micros;
+    }
+}
+
+// the duration below which per_thousand / 1000 of the writes are, rounded up to the bin
+uint32_t latency_percentile_micros(uint32_t per_thousand){
+    uint64_t const nbr_latencies_below = (static_cast<uint64_t>(nbr_latencies) * per_thousand + 999) / 1000;
+    uint64_t cumulated_count = 0;
+
+    for (size_t bin = 0; bin < nbr_latency_bins - 1; bin++){
+        cumulated_count += latency_counts[bin];
+        if (cumulated_count >= nbr_latencies_below){
+            return (bin + 1) * latency_bin_micros;
+        }
+    }
+
+    return max_latency_micros;
+}
+
+void write_timed_block(int file_index){
+    unsigned long const micros_start = micros();
+    bool const result = benchmark_streams[file_index].write_block(benchmark_block);
+    register_latency(static_cast<uint32_t>(micros() - micros_start));
+
+    all_writes_succeeded = all_writes_succeeded && result;
+}
+
+// as FastLogger::file_preallocate_size
+uint64_t benchmark_file_size(){
+    uint64_t const nbr_adc_blocks = (static_cast<uint64_t>(logger_file_duration_seconds) * adc_sampling_frequency + nbr_adc_measurements_per_block - 1)
+                                    / nbr_adc_measurements_per_block;
+    uint64_t const nbr_data_blocks = nbr_adc_blocks * nbr_of_adc_channels + logger_file_duration_seconds * benchmark_nbr_aux_blocks_per_second
+                                     + 1 + file_index_nbr_blocks + 10;
+    uint64_t const preallocate_nbr_blocks = nbr_data_blocks + nbr_data_blocks / (file_check_group_nbr_blocks - 1) + 1;
+
+    return preallocate_nbr_blocks << 9;
+}
+
+// one step of getting the file at file_index ready, of pre_allocate_size bytes; return true once it is ready
+bool prepare_file_step(int file_index, uint64_t pre_allocate_size){
+    file_t & file = benchmark_files[file_index];
+
+    SdBlockStream::pause_active_stream();
+
+    switch (next_file_step){
+        case PrepareStep::close_previous:
+            benchmark_streams[file_index].end();
+            file.close();
+            sd_object.remove(benchmark_filenames[file_index]);
+            next_file_step = PrepareStep::open;
+            break;
+
+        case PrepareStep::open:
+            sprintf(benchmark_filenames[file_index], "BNCH%04i.bin", benchmark_file_number);
+            benchmark_file_number += 1;
+
+            if (sd_object.exists(benchmark_filenames[file_index])){
+                sd_object.remove(benchmark_filenames[file_index]);
+            }
+
+            if (!file.open(benchmark_filenames[file_index], O_RDWR | O_CREAT)){
+                Serial.println(F("cannot open file"));
+                all_writes_succeeded = false;
+                next_file_step = PrepareStep::ready;
+                break;
+            }
+
+            next_file_step = PrepareStep::pre_allocate;
+            break;
+
+        case PrepareStep::pre_allocate:
+            if (!file.preAllocate(pre_allocate_size)){
+                Serial.println(F("cannot pre-allocate file"));
+                all_writes_succeeded = false;
+                next_file_step = PrepareStep::ready;
+                break;
+            }
+
+            // as FastLogger does; the sync takes card time too, during the idle time or at a switch
+            if (!file.sync()){
+                Serial.println(F("cannot sync file"));
+                all_writes_succeeded = false;
+                next_file_step = PrepareStep::ready;
+                break;
+            }
+
+            if (file.contiguousRange(&next_file_crrt_erase_sector, &next_file_last_erase_sector)){
+                next_file_step = PrepareStep::erase;
+            }
+            else{
+                next_file_step = PrepareStep::ready;
+            }
+            break;
+
+        case PrepareStep::erase: {
+            uint32_t last_sector_to_erase = next_file_crrt_erase_sector + sd_nbr_sectors_erased_per_step - 1;
+            if (last_sector_to_erase > next_file_last_erase_sector){
+                last_sector_to_erase = next_file_last_erase_sector;
+            }
+
+            if (!sd_object.card()->erase(next_file_crrt_erase_sector, last_sector_to_erase)){
+                next_file_step = PrepareStep::ready;
+                break;
+            }
+
+            next_file_crrt_erase_sector = last_sector_to_erase + 1;
+
+            if (next_file_crrt_erase_sector > next_file_last_erase_sector){
+                next_file_step = PrepareStep::ready;
+            }
+            break;
+        }
+
+        case PrepareStep::ready:
+            break;
+    }
+
+    return next_file_step == PrepareStep::ready;
+}
+
+// get the file ready at once, skipping the erase as FastLogger::switch_to_next_file does; return false if the file
+// could not be opened, and then there is nothing to write to
+bool prepare_file(int file_index, uint64_t pre_allocate_size){
+    while (!prepare_file_step(file_index, pre_allocate_size)){
+        if (next_file_step == PrepareStep::erase){
+            next_file_step = PrepareStep::ready;
+        }
+    }
+
+    return benchmark_files[file_index].isOpen();
+}
+
+void close_file(int file_index){
+    benchmark_streams[file_index].end();
+    benchmark_files[file_index].close();
+    sd_object.remove(benchmark_filenames[file_index]);
+}
+
+// back to back writes; return the throughput in kB/s, 0 if the file could not be opened
+float run_burst(){
+    next_file_step = PrepareStep::open;
+    if (!prepare_file(0, static_cast<uint64_t>(benchmark_nbr_burst_blocks) << 9)){
+        return 0.0f;
+    }
+    benchmark_streams[0].begin(&sd_object, &benchmark_files[0]);
+
+    unsigned long const micros_start = micros();
+
+    for (uint32_t i = 0; i < benchmark_nbr_burst_blocks; i++){
+        all_writes_succeeded = benchmark_streams[0].write_block(benchmark_block) && all_writes_succeeded;
+    }
+
+    unsigned long const duration_micros = micros() - micros_start;
+
+    close_file(0);
+
+    return benchmark_nbr_burst_blocks * 500000.0f / duration_micros;
+}
+
+// the logging in real time; return the largest nbr of blocks produced and not written yet
+// if a file cannot be opened, the replay stops there, with all_writes_succeeded false
+uint32_t run_replay(){
+    uint64_t const file_size = benchmark_file_size();
+    unsigned long const file_duration_micros = 1000000UL * logger_file_duration_seconds;
+    unsigned long const replay_duration_micros = file_duration_micros * benchmark_nbr_files;
+
+    int crrt_file_index = 0;
+    next_file_step = PrepareStep::open;
+    if (!prepare_file(crrt_file_index, file_size)){
+        return 0;
+    }
+    benchmark_streams[crrt_file_index].begin(&sd_object, &benchmark_files[crrt_file_index]);
+    write_timed_block(crrt_file_index);  // the header
+
+    next_file_step = PrepareStep::open;
+
+    uint64_t nbr_blocks_written = 0;
+    int nbr_blocks_in_check_group = 0;
+    uint32_t max_backlog = 0;
+    unsigned long time_next_file = file_duration_micros;
+
+    unsigned long const micros_start = micros();
+
+    while (true){
+        unsigned long const elapsed_micros = micros() - micros_start;
+
+        if (elapsed_micros >= replay_duration_micros){
+            break;
+        }
+
+        // the ISR hands a whole block set at a time
+        uint64_t const nbr_adc_block_sets = static_cast<uint64_t>(elapsed_micros) * adc_sampling_frequency
+                                            / (nbr_adc_measurements_per_block * 1000000ULL);
+        uint64_t const nbr_aux_blocks = static_cast<uint64_t>(elapsed_micros) * benchmark_nbr_aux_blocks_per_second / 1000000ULL;
+        uint64_t const nbr_blocks_produced = nbr_adc_block_sets * nbr_of_adc_channels + nbr_aux_blocks;
+
+        uint32_t const backlog = static_cast<uint32_t>(nbr_blocks_produced - nbr_blocks_written);
+        if (backlog > max_backlog){
+            max_backlog = backlog;
+        }
+
+        // the file switch is not deferred; the index, the final check block, and the header of the next file
+        if (elapsed_micros >= time_next_file){
+            time_next_file += file_duration_micros;
+
+            for (int i = 0; i < file_index_nbr_blocks + 1; i++){
+                write_timed_block(crrt_file_index);
+            }
+
+            if (!prepare_file(1 - crrt_file_index, file_size)){
+                break;
+            }
+            crrt_file_index = 1 - crrt_file_index;
+            benchmark_streams[crrt_file_index].begin(&sd_object, &benchmark_files[crrt_file_index]);
+            write_timed_block(crrt_file_index);
+
+            nbr_blocks_in_check_group = 0;
+            next_file_step = PrepareStep::close_previous;
+        }
+        else if (backlog > 0){
+            write_timed_block(crrt_file_index);
+            nbr_blocks_written += 1;
+            nbr_blocks_in_check_group += 1;
+
+            if (nbr_blocks_in_check_group == file_check_group_nbr_blocks - 1){
+                write_timed_block(crrt_file_index);
+                nbr_blocks_in_check_group = 0;
+            }
+        }
+        // the idle time, as in FastLogger::internal_update
+        else if (!SdBlockStream::card_is_busy(&sd_object)){
+            prepare_file_step(1 - crrt_file_index, file_size);
+        }
+    }
+
+    close_file(crrt_file_index);
+
+    // the other file: the previous one not closed yet, or the next one, unless not opened yet
+    if (next_file_step != PrepareStep::open){
+        close_file(1 - crrt_file_index);
+    }
+
+    return max_backlog;
+}
+
+void print_card_information(){
+    cid_t cid;
+
+    if (!sd_object.card()->readCID(&cid)){
+        Serial.println(F("cannot read the card CID"));
+        return;
+    }
+
+    // CARD,manufacturer id,product name,serial number,manufacturing date,size in MB
+    Serial.print(F("CARD,0x"));
+    Serial.print(cid.mid, HEX);
+    Serial.print(F(","));
+    for (int i = 0; i < 5; i++){
+        Serial.print(cid.pnm[i]);
+    }
+    Serial.print(F(",0x"));
+    Serial.print(cid.psn, HEX);
+    Serial.print(F(","));
+    Serial.print(static_cast<int>(cid.mdt_month));
+    Serial.print(F("/"));
+    Serial.print(2000 + cid.mdt_year_low + 10 * cid.mdt_year_high);
+    Serial.print(F(","));
+    Serial.println(sd_object.card()->sectorCount() / 2048);
+}
+
+void setup(){
+    Serial.begin(115200);
+    delay(1000);
+    Serial.println();
+
+    Serial.print(F("SD benchmark: "));
+    Serial.print(nbr_of_adc_channels);
+    Serial.print(F(" channels at "));
+    Serial.print(adc_sampling_frequency);
+    Serial.print(F(" Hz, "));
+    Serial.print(nbr_blocks_in_pool);
+    Serial.println(F(" blocks in the pool of the logger"));
+
+    for (size_t i = 0; i < sizeof(benchmark_block); i++){
+        benchmark_block[i] = static_cast<uint8_t>(i * 7 + 3);
+    }
+
+    bool card_information_printed = false;
+    bool logger_clock_is_go = false;
+
+    for (uint32_t crrt_clock_mhz : benchmark_spi_clocks_mhz){
+        SdSpiConfig sd_config{sd_card_select_pin, DEDICATED_SPI, SD_SCK_MHZ(crrt_clock_mhz)};
+
+        if (!sd_object.begin(sd_config)){
+            Serial.print(F("BNCH,"));
+            Serial.print(crrt_clock_mhz);
+            Serial.println(F(",cannot start the card"));
+            continue;
+        }
+
+        if (!card_information_printed){
+            print_card_information();
+            card_information_printed = true;
+        }
+
+        reset_latencies();
+        float const throughput_kB_per_s = run_burst();
+        bool const burst_succeeded = all_writes_succeeded;
+
+        // a card the burst could not even open a file on is not worth the replay
+        reset_latencies();
+        uint32_t const min_safe_nbr_blocks = (burst_succeeded ? run_replay() : 0) + nbr_of_adc_channels;
+
+        bool const is_go = burst_succeeded && all_writes_succeeded
+                           && (min_safe_nbr_blocks * benchmark_pool_safety_factor <= nbr_blocks_in_pool);
+
+        if (crrt_clock_mhz == sd_spi_clock_mhz){
+            logger_clock_is_go = is_go;
+        }
+
+        Serial.print(F("BNCH,"));
+        Serial.print(crrt_clock_mhz);
+        Serial.print(F(","));
+        Serial.print(throughput_kB_per_s, 1);
+        Serial.print(F(","));
+        Serial.print(latency_percentile_micros(990));
+        Serial.print(F(","));
+        Serial.print(max_latency_micros);
+        Serial.print(F(","));
+        Serial.print(min_safe_nbr_blocks);
+        Serial.println(is_go ? F(",GO") : F(",NO GO"));
+    }
+
+    Serial.println(logger_clock_is_go ? F("CARD,GO") : F("CARD,NO GO"));
+}
+
+void loop(){
+}
@@ -0,0 +1,87 @@
+#include <unity.h>
+
+#include <AdcTiming.h>
+
+#include <stdio.h>
+
+// the Due master clock
+constexpr uint32_t mck = 84000000UL;
+
+// the default settings must be valid at compile time
+static_assert(compute_adc_timing(mck, 1000, 5).valid, "1kHz with 5 channels must be possible");
+static_assert(!compute_adc_timing(mck, 1000000, 5).valid, "1MHz with 5 channels is not possible");
+
+void test_documented_settings(void) {
+    // the hand found values of Due_ADC_reading, with 5 channels: ps 2 @100kHz, 20 @10kHz, 200 @1kHz
+    // the computed ones are the slowest ADC clock with the 40 clocks per conversion budget, i.e. close to these
+    AdcTiming const timing_1kHz = compute_adc_timing(mck, 1000, 5);
+    TEST_ASSERT_TRUE(timing_1kHz.valid);
+    TEST_ASSERT_EQUAL(209, timing_1kHz.prescale);
+    TEST_ASSERT_EQUAL(10500, timing_1kHz.timer_rc);
+
+    AdcTiming const timing_10kHz = compute_adc_timing(mck, 10000, 5);
+    TEST_ASSERT_TRUE(timing_10kHz.valid);
+    TEST_ASSERT_EQUAL(20, timing_10kHz.prescale);
+    TEST_ASSERT_EQUAL(1050, timing_10kHz.timer_rc);
+
+    AdcTiming const timing_100kHz = compute_adc_timing(mck, 100000, 5);
+    TEST_ASSERT_TRUE(timing_100kHz.valid);
+    TEST_ASSERT_EQUAL(1, timing_100kHz.prescale);
+    TEST_ASSERT_EQUAL(105, timing_100kHz.timer_rc);
+}
+
+void test_impossible_settings(void) {
+    TEST_ASSERT_FALSE(compute_adc_timing(mck, 0, 5).valid);
+    TEST_ASSERT_FALSE(compute_adc_timing(mck, 1000, 0).valid);
+    // the scan would need a faster ADC clock than the 22MHz maximum
+    TEST_ASSERT_FALSE(compute_adc_timing(mck, 120000, 5).valid);
+    TEST_ASSERT_TRUE(compute_adc_timing(mck, 500000, 1).valid);
+    TEST_ASSERT_FALSE(compute_adc_timing(mck, 600000, 1).valid);
+}
+
+void test_sweep(void) {
+    // whatever the rate and channels, a valid setting fits a scan in a period, within the register ranges
+    size_t nbr_valid = 0;
+
+    for (int nbr_channels = 1; nbr_channels <= 16; nbr_channels++){
+        for (uint32_t frequency = 1; frequency <= 1000000; frequency = frequency * 5 / 4 + 1){
+            AdcTiming const timing = compute_adc_timing(mck, frequency, nbr_channels);
+            if (!timing.valid){
+                continue;
+            }
+            nbr_valid += 1;
+
+            // all durations in MCK periods, so that the comparisons are exact
+            uint64_t const actual_period = 8 * static_cast<uint64_t>(timing.timer_rc);
+            uint64_t const nbr_adc_clock_periods_per_scan = static_cast<uint64_t>(nbr_channels) * adc_clock_periods_per_conversion;
+            TEST_ASSERT_TRUE(2 * (timing.prescale + 1) * nbr_adc_clock_periods_per_scan <= actual_period);
+            TEST_ASSERT_TRUE(timing.adc_clock_frequency <= adc_max_clock_frequency);
+            TEST_ASSERT_EQUAL(mck / (2 * (timing.prescale + 1)), timing.adc_clock_frequency);
+
+            // the timer rounding error is at most half a tick, plus the mHz resolution
+            double const relative_error = (timing.actual_frequency_mHz / 1000.0 - frequency) / frequency;
+            double const max_relative_error = 0.5 / timing.timer_rc + 0.001 / frequency;
+            TEST_ASSERT_TRUE(relative_error < max_relative_error);
+            TEST_ASSERT_TRUE(relative_error > -max_relative_error);
+
+            // and the prescaler is the largest that works, unless saturated
+            if (timing.prescale < 255){
+                TEST_ASSERT_TRUE(2 * (timing.prescale + 2) * nbr_adc_clock_periods_per_scan > actual_period);
+            }
+        }
+    }
+
+    char message[64];
+    snprintf(message, sizeof(message), "%zu valid settings checked", nbr_valid);
+    TEST_MESSAGE(message);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_documented_settings);
+    RUN_TEST(test_impossible_settings);
+    RUN_TEST(test_sweep);
+    UNITY_END();
+
+    return 0;
+}
@@ -0,0 +1,191 @@
+#include <unity.h>
+
+#include <BlockPool.h>
+
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+struct TestBlock{
+    uint32_t owner;
+    uint8_t data[508];
+};
+
+constexpr size_t nbr_test_blocks = 16;
+
+void test_take_all_and_give_back(void) {
+    static BlockPool<TestBlock, nbr_test_blocks> pool;
+    TestBlock * taken[nbr_test_blocks];
+
+    TEST_ASSERT_EQUAL(nbr_test_blocks, pool.get_nbr_free());
+
+    for (size_t i = 0; i < nbr_test_blocks; i++){
+        taken[i] = pool.take();
+        TEST_ASSERT_NOT_NULL(taken[i]);
+
+        // all different
+        for (size_t j = 0; j < i; j++){
+            TEST_ASSERT_TRUE(taken[i] != taken[j]);
+        }
+    }
+
+    TEST_ASSERT_EQUAL(0, pool.get_nbr_free());
+    TEST_ASSERT_NULL(pool.take());
+    TEST_ASSERT_EQUAL(0, pool.get_min_nbr_free());
+
+    for (size_t i = 0; i < nbr_test_blocks; i++){
+        pool.give_back(taken[i]);
+    }
+
+    TEST_ASSERT_EQUAL(nbr_test_blocks, pool.get_nbr_free());
+    TEST_ASSERT_EQUAL(0, pool.get_min_nbr_free());
+
+    pool.reset_min_nbr_free();
+    TEST_ASSERT_EQUAL(nbr_test_blocks, pool.get_min_nbr_free());
+}
+
+void test_last_given_back_is_taken_first(void) {
+    static BlockPool<TestBlock, nbr_test_blocks> pool;
+
+    TestBlock * const first = pool.take();
+    TestBlock * const second = pool.take();
+
+    pool.give_back(first);
+    TEST_ASSERT_EQUAL_PTR(first, pool.take());
+
+    pool.give_back(second);
+    pool.give_back(first);
+    TEST_ASSERT_EQUAL_PTR(first, pool.take());
+    TEST_ASSERT_EQUAL_PTR(second, pool.take());
+    TEST_ASSERT_EQUAL(nbr_test_blocks - 2, pool.get_nbr_free());
+}
+
+void test_queue_order_and_wrap(void) {
+    SpscQueue<int, 5> queue;
+    int value = 0;
+
+    TEST_ASSERT_TRUE(queue.is_empty());
+    TEST_ASSERT_FALSE(queue.pop(value));
+
+    // several times around the ring
+    int next_in = 0;
+    int next_out = 0;
+
+    for (int round = 0; round < 10; round++){
+        while (queue.push(next_in)){
+            next_in += 1;
+        }
+        TEST_ASSERT_EQUAL(5, queue.size());
+
+        for (int i = 0; i < 3; i++){
+            TEST_ASSERT_TRUE(queue.pop(value));
+            TEST_ASSERT_EQUAL(next_out, value);
+            next_out += 1;
+        }
+        TEST_ASSERT_EQUAL(2, queue.size());
+    }
+
+    while (queue.pop(value)){
+        TEST_ASSERT_EQUAL(next_out, value);
+        next_out += 1;
+    }
+
+    TEST_ASSERT_EQUAL(next_in, next_out);
+    TEST_ASSERT_TRUE(queue.is_empty());
+    TEST_ASSERT_EQUAL(5, queue.get_max_size());
+}
+
+// as on the logger: one producer (the ISR) takes blocks and queues them, one consumer (the main loop) gets them from
+// the queue and gives them back, while also taking and giving back blocks of its own (the chars)
+void test_concurrent_producer_consumer(void) {
+    static BlockPool<TestBlock, nbr_test_blocks> pool;
+    static SpscQueue<TestBlock *, nbr_test_blocks> queue;
+
+    constexpr uint32_t nbr_blocks_to_produce = 200000;
+
+    uint32_t nbr_produced = 0;
+    uint32_t nbr_dropped = 0;
+    uint32_t nbr_out_of_order = 0;
+    std::atomic<bool> producer_is_finished {false};
+
+    std::thread producer([&](){
+        for (uint32_t i = 0; i < nbr_blocks_to_produce; i++){
+            TestBlock * block = pool.take();
+
+            if (block == nullptr){
+                nbr_dropped += 1;
+                std::this_thread::yield();
+                continue;
+            }
+
+            block->owner = i;
+            block->data[0] = static_cast<uint8_t>(i);
+            queue.push(block);
+            nbr_produced += 1;
+        }
+
+        producer_is_finished.store(true);
+    });
+
+    uint32_t nbr_consumed = 0;
+    uint32_t nbr_corrupted = 0;
+    uint32_t last_owner = 0;
+
+    while (true){
+        // once the producer is finished, one more pass gets the last blocks
+        bool const is_last_pass = producer_is_finished.load();
+
+        // a block of our own, kept for a short while
+        TestBlock * own_block = pool.take();
+        if (own_block != nullptr){
+            own_block->owner = 0xFFFFFFFF;
+        }
+
+        TestBlock * block;
+        while (queue.pop(block)){
+            if ((block->owner == 0xFFFFFFFF) || (block->data[0] != static_cast<uint8_t>(block->owner))){
+                nbr_corrupted += 1;
+            }
+            if ((nbr_consumed > 0) && (block->owner <= last_owner)){
+                nbr_out_of_order += 1;
+            }
+            last_owner = block->owner;
+            nbr_consumed += 1;
+            pool.give_back(block);
+        }
+
+        if (own_block != nullptr){
+            if (own_block->owner != 0xFFFFFFFF){
+                nbr_corrupted += 1;
+            }
+            pool.give_back(own_block);
+        }
+
+        if (is_last_pass){
+            break;
+        }
+    }
+
+    producer.join();
+
+    TEST_ASSERT_EQUAL(nbr_blocks_to_produce, nbr_produced + nbr_dropped);
+    TEST_ASSERT_EQUAL(nbr_produced, nbr_consumed);
+    TEST_ASSERT_EQUAL(0, nbr_corrupted);
+    TEST_ASSERT_EQUAL(0, nbr_out_of_order);
+    TEST_ASSERT_EQUAL(nbr_test_blocks, pool.get_nbr_free());
+
+    char message[64];
+    snprintf(message, sizeof(message), "%u blocks through the queue, %u dropped", nbr_consumed, nbr_dropped);
+    TEST_MESSAGE(message);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_take_all_and_give_back);
+    RUN_TEST(test_last_given_back_is_taken_first);
+    RUN_TEST(test_queue_order_and_wrap);
+    RUN_TEST(test_concurrent_producer_consumer);
+    UNITY_END();
+
+    return 0;
+}
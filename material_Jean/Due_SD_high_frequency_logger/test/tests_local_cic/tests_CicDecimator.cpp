@@ -0,0 +1,211 @@
+#include <unity.h>
+
+#include <CicDecimator.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <chrono>
+#include <initializer_list>
+
+// a typical setting: logging at 1kHz, sampling at 5kHz, 3 stages
+constexpr int order = 3;
+constexpr int decimation_ratio = 5;
+constexpr double output_frequency = 1000.0;
+constexpr double input_frequency = output_frequency * decimation_ratio;
+
+using Decimator = CicDecimator<order, decimation_ratio>;
+
+constexpr size_t nbr_values_per_block = 250;
+constexpr int middle_value = (0b1 << (12-1)) -1;
+
+// the theoretical CIC amplitude response, relative to DC
+double theoretical_gain(double frequency){
+    double const x = M_PI * frequency / input_frequency;
+    return pow(fabs(sin(decimation_ratio * x) / (decimation_ratio * sin(x))), order);
+}
+
+// feed a sine at frequency, and measure the amplitude of the output at the frequency it aliases to
+// the output amplitude is relative to the input one, both in 12 bits units
+double measured_gain(double frequency, double amplitude){
+    Decimator decimator;
+    decimator.reset();
+
+    constexpr size_t nbr_outputs = 20000;
+    constexpr size_t nbr_outputs_settling = 100;
+
+    static uint16_t input[nbr_outputs * decimation_ratio];
+    static uint16_t output[nbr_outputs];
+
+    for (size_t i = 0; i < nbr_outputs * decimation_ratio; i++){
+        input[i] = static_cast<uint16_t>(lround(middle_value + amplitude * sin(2.0 * M_PI * frequency * i / input_frequency)));
+    }
+
+    size_t nbr_written = 0;
+    for (size_t crrt_block = 0; crrt_block < nbr_outputs * decimation_ratio / nbr_values_per_block; crrt_block++){
+        nbr_written += decimator.process(&input[crrt_block * nbr_values_per_block], 1, nbr_values_per_block, &output[nbr_written]);
+    }
+    TEST_ASSERT_EQUAL(nbr_outputs, nbr_written);
+
+    // the frequency seen after decimation
+    double aliased_frequency = fmod(frequency, output_frequency);
+    if (aliased_frequency > output_frequency / 2){
+        aliased_frequency = output_frequency - aliased_frequency;
+    }
+
+    // project on the aliased frequency, removing the DC first
+    double mean = 0.0;
+    for (size_t i = nbr_outputs_settling; i < nbr_outputs; i++){
+        mean += output[i];
+    }
+    mean /= (nbr_outputs - nbr_outputs_settling);
+
+    double in_phase = 0.0;
+    double quadrature = 0.0;
+    for (size_t i = nbr_outputs_settling; i < nbr_outputs; i++){
+        double const phase = 2.0 * M_PI * aliased_frequency * i / output_frequency;
+        in_phase += (output[i] - mean) * cos(phase);
+        quadrature += (output[i] - mean) * sin(phase);
+    }
+
+    double const output_amplitude = 2.0 * sqrt(in_phase * in_phase + quadrature * quadrature) / (nbr_outputs - nbr_outputs_settling);
+
+    // the output is 16 bits, i.e. the 12 bits values times 16
+    return output_amplitude / 16.0 / amplitude;
+}
+
+void test_dc_is_scaled_to_16_bits(void) {
+    Decimator decimator;
+    decimator.reset();
+
+    for (uint16_t dc_value : {uint16_t{0}, uint16_t{1}, uint16_t{middle_value}, uint16_t{4095}}){
+        uint16_t input[nbr_values_per_block];
+        uint16_t output[nbr_values_per_block / decimation_ratio];
+
+        for (auto & crrt_value : input){
+            crrt_value = dc_value;
+        }
+
+        // a few blocks so that the previous DC value is flushed out of the filter
+        for (int crrt_block = 0; crrt_block < 3; crrt_block++){
+            TEST_ASSERT_EQUAL(nbr_values_per_block / decimation_ratio, decimator.process(input, 1, nbr_values_per_block, output));
+        }
+
+        for (auto crrt_value : output){
+            TEST_ASSERT_EQUAL_UINT16(dc_value * 16, crrt_value);
+        }
+    }
+}
+
+void test_chunks_and_stride(void) {
+    // decimating interleaved scans in odd sized chunks must give the same as one channel in one go
+    constexpr size_t nbr_channels = 3;
+    constexpr size_t nbr_scans = 1000;
+
+    static uint16_t interleaved[nbr_scans * nbr_channels];
+    static uint16_t single_channel[nbr_scans];
+
+    for (size_t i = 0; i < nbr_scans; i++){
+        uint16_t const value = static_cast<uint16_t>((static_cast<uint32_t>(i) * 2654435761u) >> 20);  // 0..4095
+        single_channel[i] = value;
+        for (size_t crrt_channel = 0; crrt_channel < nbr_channels; crrt_channel++){
+            interleaved[i * nbr_channels + crrt_channel] = (crrt_channel == 1) ? value : 0;
+        }
+    }
+
+    Decimator reference;
+    Decimator chunked;
+    reference.reset();
+    chunked.reset();
+
+    uint16_t reference_output[nbr_scans / decimation_ratio];
+    uint16_t chunked_output[nbr_scans / decimation_ratio];
+
+    TEST_ASSERT_EQUAL(nbr_scans / decimation_ratio, reference.process(single_channel, 1, nbr_scans, reference_output));
+
+    size_t nbr_scans_done = 0;
+    size_t nbr_written = 0;
+    size_t crrt_chunk_size = 1;
+    while (nbr_scans_done < nbr_scans){
+        size_t const nbr_scans_in_chunk = (crrt_chunk_size < nbr_scans - nbr_scans_done) ? crrt_chunk_size : nbr_scans - nbr_scans_done;
+        nbr_written += chunked.process(&interleaved[nbr_scans_done * nbr_channels + 1], nbr_channels, nbr_scans_in_chunk, &chunked_output[nbr_written]);
+        nbr_scans_done += nbr_scans_in_chunk;
+        crrt_chunk_size = (crrt_chunk_size * 3 + 1) % 17;
+    }
+
+    TEST_ASSERT_EQUAL(nbr_scans / decimation_ratio, nbr_written);
+    TEST_ASSERT_EQUAL_UINT16_ARRAY(reference_output, chunked_output, nbr_scans / decimation_ratio);
+}
+
+void test_frequency_response(void) {
+    constexpr double amplitude = 1800.0;
+
+    // passband: follows the sinc**order response, i.e. some droop towards the output Nyquist
+    for (double frequency : {10.0, 50.0, 100.0, 200.0, 300.0}){
+        double const gain = measured_gain(frequency, amplitude);
+        char message[128];
+        snprintf(message, sizeof(message), "passband %6.1f Hz: gain %.4f, theory %.4f", frequency, gain, theoretical_gain(frequency));
+        TEST_MESSAGE(message);
+        TEST_ASSERT_DOUBLE_WITHIN(0.005, theoretical_gain(frequency), gain);
+    }
+
+    // stopband: the bands that alias onto the 0-100 Hz band are strongly attenuated
+    for (double frequency : {950.0, 1050.0, 1980.0, 2030.0}){
+        double const gain = measured_gain(frequency, amplitude);
+        char message[128];
+        snprintf(message, sizeof(message), "alias %6.1f Hz: gain %.5f (%.1f dB), theory %.5f", frequency, gain, 20.0 * log10(gain), theoretical_gain(frequency));
+        TEST_MESSAGE(message);
+        TEST_ASSERT_DOUBLE_WITHIN(0.002, theoretical_gain(frequency), gain);
+        TEST_ASSERT_TRUE(gain < 0.01);
+    }
+}
+
+void test_benchmark(void) {
+    // gives an idea of the cost per input value; the Due is of course much slower, count roughly 3 cycles per stage
+    // and input value there; the bound is only there to catch a gross slow down, even in an unoptimized build
+    constexpr size_t nbr_channels = 5;
+    constexpr size_t nbr_pdc_buffers = 2000;
+
+    static uint16_t pdc_buffer[nbr_values_per_block * nbr_channels];
+    static uint16_t output[nbr_channels][nbr_values_per_block / decimation_ratio];
+    Decimator decimators[nbr_channels];
+
+    for (size_t i = 0; i < nbr_values_per_block * nbr_channels; i++){
+        pdc_buffer[i] = static_cast<uint16_t>((static_cast<uint32_t>(i) * 2654435761u) >> 20);
+    }
+
+    for (auto & crrt_decimator : decimators){
+        crrt_decimator.reset();
+    }
+
+    uint32_t checksum = 0;
+    auto const time_start = std::chrono::steady_clock::now();
+
+    for (size_t crrt_buffer = 0; crrt_buffer < nbr_pdc_buffers; crrt_buffer++){
+        for (size_t crrt_channel = 0; crrt_channel < nbr_channels; crrt_channel++){
+            decimators[crrt_channel].process(&pdc_buffer[crrt_channel], nbr_channels, nbr_values_per_block, output[crrt_channel]);
+            checksum += output[crrt_channel][crrt_buffer % (nbr_values_per_block / decimation_ratio)];
+        }
+    }
+
+    auto const time_end = std::chrono::steady_clock::now();
+    double const nanoseconds = std::chrono::duration<double, std::nano>(time_end - time_start).count();
+    double const nanoseconds_per_value = nanoseconds / (nbr_pdc_buffers * nbr_channels * nbr_values_per_block);
+
+    char message[128];
+    snprintf(message, sizeof(message), "%.2f ns per input value (checksum %u)", nanoseconds_per_value, checksum);
+    TEST_MESSAGE(message);
+
+    constexpr double max_nanoseconds_per_value = 200.0;
+    TEST_ASSERT_TRUE(nanoseconds_per_value < max_nanoseconds_per_value);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_dc_is_scaled_to_16_bits);
+    RUN_TEST(test_chunks_and_stride);
+    RUN_TEST(test_frequency_response);
+    RUN_TEST(test_benchmark);
+    UNITY_END();
+
+    return 0;
+}
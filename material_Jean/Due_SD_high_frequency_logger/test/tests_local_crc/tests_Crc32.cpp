@@ -0,0 +1,85 @@
+#include <unity.h>
+
+#include <Crc32.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+uint32_t pseudo_random(uint32_t index){
+    return (index * 2654435761u) ^ ((index * 2246822519u) >> 13);
+}
+
+void test_check_values(void) {
+    // the standard check value, also what zlib.crc32 gives on the host
+    char const message[] = "123456789";
+    TEST_ASSERT_EQUAL_HEX32(0xCBF43926UL, crc32(message, strlen(message)));
+
+    TEST_ASSERT_EQUAL_HEX32(0, crc32(message, 0));
+
+    uint8_t zeros[512] = {0};
+    uint8_t ones[512];
+    memset(ones, 0xFF, sizeof(ones));
+
+    // an erased sector, whichever the erased value, does not have the CRC of a written block full of 0s
+    TEST_ASSERT_TRUE(crc32(zeros, sizeof(zeros)) != 0);
+    TEST_ASSERT_TRUE(crc32(ones, sizeof(ones)) != 0xFFFFFFFFUL);
+}
+
+void test_in_parts(void) {
+    uint8_t block[512];
+    for (size_t i = 0; i < sizeof(block); i++){
+        block[i] = static_cast<uint8_t>(pseudo_random(i));
+    }
+
+    uint32_t const crc_whole = crc32(block, sizeof(block));
+
+    for (size_t split = 0; split <= sizeof(block); split += 37){
+        TEST_ASSERT_EQUAL_HEX32(crc_whole, crc32(block + split, sizeof(block) - split, crc32(block, split)));
+    }
+
+    // any single bit flip is seen
+    for (size_t crrt_bit = 0; crrt_bit < 8 * sizeof(block); crrt_bit += 13){
+        block[crrt_bit / 8] ^= static_cast<uint8_t>(0b1 << (crrt_bit % 8));
+        TEST_ASSERT_TRUE(crc32(block, sizeof(block)) != crc_whole);
+        block[crrt_bit / 8] ^= static_cast<uint8_t>(0b1 << (crrt_bit % 8));
+    }
+}
+
+void test_benchmark(void) {
+    // not a pass / fail test: the cost per 512 bytes block; on the Due, count some 10 cycles per byte, i.e. in the
+    // order of 60 us per block at 84 MHz
+    constexpr size_t nbr_blocks = 200000;
+
+    std::vector<uint8_t> blocks(512 * 64);
+    for (size_t i = 0; i < blocks.size(); i++){
+        blocks[i] = static_cast<uint8_t>(pseudo_random(i));
+    }
+
+    uint32_t accumulated = 0;
+
+    auto const time_start = std::chrono::steady_clock::now();
+
+    for (size_t crrt_block = 0; crrt_block < nbr_blocks; crrt_block++){
+        accumulated ^= crc32(&blocks[512 * (crrt_block % 64)], 512);
+    }
+
+    auto const time_end = std::chrono::steady_clock::now();
+    double const nanoseconds = std::chrono::duration<double, std::nano>(time_end - time_start).count();
+
+    char message[128];
+    snprintf(message, sizeof(message), "crc32: %.1f ns per 512 bytes block, %.2f ns per byte (%08x)",
+             nanoseconds / nbr_blocks, nanoseconds / nbr_blocks / 512, static_cast<unsigned int>(accumulated));
+    TEST_MESSAGE(message);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_check_values);
+    RUN_TEST(test_in_parts);
+    RUN_TEST(test_benchmark);
+    UNITY_END();
+
+    return 0;
+}
@@ -0,0 +1,67 @@
+#include <unity.h>
+
+#include <Log2Histogram.h>
+
+static_assert(Log2Histogram<24>::bucket_index(0) == 0);
+static_assert(Log2Histogram<24>::bucket_index(1) == 1);
+static_assert(Log2Histogram<24>::bucket_index(0xFFFFFFFF) == 23);
+
+void test_bucket_bounds(void) {
+    using Histogram = Log2Histogram<24>;
+
+    TEST_ASSERT_EQUAL(0, Histogram::bucket_index(0));
+    TEST_ASSERT_EQUAL(1, Histogram::bucket_index(1));
+    TEST_ASSERT_EQUAL(2, Histogram::bucket_index(2));
+    TEST_ASSERT_EQUAL(2, Histogram::bucket_index(3));
+    TEST_ASSERT_EQUAL(3, Histogram::bucket_index(4));
+    TEST_ASSERT_EQUAL(11, Histogram::bucket_index(1024));
+    TEST_ASSERT_EQUAL(10, Histogram::bucket_index(1023));
+
+    // each bucket starts at its lower bound, and ends just before the next one
+    for (size_t bucket = 1; bucket < Histogram::get_nbr_buckets() - 1; bucket++){
+        TEST_ASSERT_EQUAL(bucket, Histogram::bucket_index(Histogram::bucket_lower_bound(bucket)));
+        TEST_ASSERT_EQUAL(bucket, Histogram::bucket_index(Histogram::bucket_lower_bound(bucket + 1) - 1));
+    }
+
+    // everything large goes to the last bucket
+    TEST_ASSERT_EQUAL(23, Histogram::bucket_index(Histogram::bucket_lower_bound(23)));
+    TEST_ASSERT_EQUAL(23, Histogram::bucket_index(10000000));
+    TEST_ASSERT_EQUAL(23, Histogram::bucket_index(0xFFFFFFFF));
+
+    // with one bucket per bit, nothing is merged
+    TEST_ASSERT_EQUAL(32, Log2Histogram<33>::bucket_index(0xFFFFFFFF));
+}
+
+void test_register_and_reset(void) {
+    Log2Histogram<8> histogram;
+
+    uint32_t const values[] = {0, 1, 5, 6, 7, 100, 200, 1000000};
+    for (uint32_t crrt_value : values){
+        histogram.register_value(crrt_value);
+    }
+
+    uint32_t const expected_counts[] = {1, 1, 0, 3, 0, 0, 0, 3};
+    for (size_t bucket = 0; bucket < 8; bucket++){
+        TEST_ASSERT_EQUAL(expected_counts[bucket], histogram.get_counts()[bucket]);
+    }
+
+    TEST_ASSERT_EQUAL(8, histogram.get_nbr_values());
+    TEST_ASSERT_EQUAL(1000000, histogram.get_max_value());
+
+    histogram.reset();
+
+    for (size_t bucket = 0; bucket < 8; bucket++){
+        TEST_ASSERT_EQUAL(0, histogram.get_counts()[bucket]);
+    }
+    TEST_ASSERT_EQUAL(0, histogram.get_nbr_values());
+    TEST_ASSERT_EQUAL(0, histogram.get_max_value());
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_bucket_bounds);
+    RUN_TEST(test_register_and_reset);
+    UNITY_END();
+
+    return 0;
+}
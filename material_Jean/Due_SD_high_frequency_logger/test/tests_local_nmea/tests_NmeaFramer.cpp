@@ -0,0 +1,158 @@
+#include <unity.h>
+
+#include <NmeaFramer.h>
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// the usual example of an RMC sentence, with its checksum
+constexpr char rmc_sentence[] = "$GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W*6A";
+
+constexpr size_t ring_nbr_chars = 256;
+
+// the ring and the producer, as the UART PDC would fill it
+struct TestRing{
+    char chars[ring_nbr_chars];
+    uint32_t nbr_chars_written = 0;
+
+    void write(std::string const & text){
+        for (char crrt_char : text){
+            chars[nbr_chars_written % ring_nbr_chars] = crrt_char;
+            nbr_chars_written += 1;
+        }
+    }
+};
+
+std::string view_to_string(NmeaSentenceView const & sentence){
+    return std::string(sentence.chars, sentence.nbr_chars) + std::string(sentence.chars_continued, sentence.nbr_chars_continued);
+}
+
+// all the sentences found in what was written so far
+std::vector<std::string> find_sentences(NmeaFramer & framer, TestRing const & ring){
+    std::vector<std::string> sentences;
+    NmeaSentenceView sentence;
+
+    while (framer.find_sentence(ring.nbr_chars_written, sentence)){
+        sentences.push_back(view_to_string(sentence));
+    }
+
+    return sentences;
+}
+
+void test_sentences_in_pieces(void) {
+    TestRing ring;
+    NmeaFramer framer;
+    framer.init(ring.chars, ring_nbr_chars);
+
+    // the sentences come a few chars at a time, and wrap around the ring many times
+    std::string const stream = std::string(rmc_sentence) + "\r\n";
+    size_t nbr_sentences = 0;
+
+    for (size_t crrt_sentence = 0; crrt_sentence < 50; crrt_sentence++){
+        for (size_t piece_start = 0; piece_start < stream.size(); piece_start += 7){
+            ring.write(stream.substr(piece_start, 7));
+
+            for (std::string const & found : find_sentences(framer, ring)){
+                TEST_ASSERT_EQUAL_STRING(rmc_sentence, found.c_str());
+                nbr_sentences += 1;
+            }
+        }
+    }
+
+    TEST_ASSERT_EQUAL(50, nbr_sentences);
+    TEST_ASSERT_EQUAL(0, framer.get_nbr_bad_sentences());
+    TEST_ASSERT_EQUAL(0, framer.get_nbr_lost_chars());
+}
+
+void test_sentence_across_ring_end(void) {
+    TestRing ring;
+    NmeaFramer framer;
+    framer.init(ring.chars, ring_nbr_chars);
+
+    // so that the sentence starts 20 chars before the end of the ring
+    ring.write(std::string(ring_nbr_chars - 20, 'x'));
+    TEST_ASSERT_EQUAL(0, find_sentences(framer, ring).size());
+
+    ring.write(std::string(rmc_sentence) + "\r\n");
+
+    NmeaSentenceView sentence;
+    TEST_ASSERT_TRUE(framer.find_sentence(ring.nbr_chars_written, sentence));
+
+    // in place, in 2 parts
+    TEST_ASSERT_EQUAL_PTR(&ring.chars[ring_nbr_chars - 20], sentence.chars);
+    TEST_ASSERT_EQUAL(20, sentence.nbr_chars);
+    TEST_ASSERT_EQUAL_PTR(ring.chars, sentence.chars_continued);
+    TEST_ASSERT_EQUAL(strlen(rmc_sentence) - 20, sentence.nbr_chars_continued);
+    TEST_ASSERT_EQUAL_STRING(rmc_sentence, view_to_string(sentence).c_str());
+}
+
+void test_bad_sentences_are_dropped(void) {
+    TestRing ring;
+    NmeaFramer framer;
+    framer.init(ring.chars, ring_nbr_chars);
+
+    std::string corrupted = rmc_sentence;
+    corrupted[10] = '9';
+
+    std::string no_checksum = rmc_sentence;
+    no_checksum.resize(no_checksum.size() - 3);
+
+    // a sentence cut by the start of another, as when chars are lost
+    std::string const cut = std::string(rmc_sentence).substr(0, 30);
+
+    std::vector<std::string> sentences;
+
+    // looked at after each piece, so that the ring is never overrun
+    for (std::string const & piece : {corrupted + "\r\n", no_checksum + "\r\n", "noise" + cut,
+                                      "$" + std::string(nmea_max_sentence_nbr_chars, 'A') + "\r\n",
+                                      std::string(rmc_sentence) + "\r\n"}){
+        ring.write(piece);
+
+        for (std::string const & found : find_sentences(framer, ring)){
+            sentences.push_back(found);
+        }
+    }
+
+    TEST_ASSERT_EQUAL(1, sentences.size());
+    TEST_ASSERT_EQUAL_STRING(rmc_sentence, sentences[0].c_str());
+    TEST_ASSERT_EQUAL(4, framer.get_nbr_bad_sentences());
+}
+
+void test_overrun(void) {
+    TestRing ring;
+    NmeaFramer framer;
+    framer.init(ring.chars, ring_nbr_chars);
+
+    // the main loop was away for more than a ring of chars: what was not looked at is lost, and the framing starts
+    // again from the next sentence
+    std::string const stream = std::string(rmc_sentence) + "\r\n";
+    while (ring.nbr_chars_written < 2 * ring_nbr_chars){
+        ring.write(stream);
+    }
+
+    uint32_t const nbr_chars_overrun = ring.nbr_chars_written;
+    TEST_ASSERT_EQUAL(0, find_sentences(framer, ring).size());
+    TEST_ASSERT_EQUAL(nbr_chars_overrun, framer.get_nbr_lost_chars());
+
+    ring.write(stream);
+    ring.write(stream);
+    TEST_ASSERT_EQUAL(2, find_sentences(framer, ring).size());
+
+    char message[128];
+    snprintf(message, sizeof(message), "%u chars lost, %u bad sentences", framer.get_nbr_lost_chars(), framer.get_nbr_bad_sentences());
+    TEST_MESSAGE(message);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_sentences_in_pieces);
+    RUN_TEST(test_sentence_across_ring_end);
+    RUN_TEST(test_bad_sentences_are_dropped);
+    RUN_TEST(test_overrun);
+    UNITY_END();
+
+    return 0;
+}
@@ -0,0 +1,196 @@
+#include <unity.h>
+
+#include <Ping1DParser.h>
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+// the general_request for the firmware version, as in the examples of the Ping protocol documentation
+constexpr uint8_t firmware_version_request[] = {'B', 'R', 0x02, 0x00, 0x06, 0x00, 0x00, 0x00, 0xB0, 0x04, 0x50, 0x01};
+
+// a message as the sonar sends it, from the sonar (device 1) to the host (0)
+std::vector<uint8_t> make_message(uint16_t message_id, std::vector<uint8_t> const & payload){
+    std::vector<uint8_t> message {'B', 'R',
+                                  static_cast<uint8_t>(payload.size() & 0xFF), static_cast<uint8_t>(payload.size() >> 8),
+                                  static_cast<uint8_t>(message_id & 0xFF), static_cast<uint8_t>(message_id >> 8),
+                                  1, 0};
+    message.insert(message.end(), payload.begin(), payload.end());
+
+    uint16_t checksum = 0;
+    for (uint8_t crrt_byte : message){
+        checksum += crrt_byte;
+    }
+    message.push_back(checksum & 0xFF);
+    message.push_back(checksum >> 8);
+
+    return message;
+}
+
+void append_uint(std::vector<uint8_t> & bytes, uint32_t value, size_t nbr_bytes){
+    for (size_t i = 0; i < nbr_bytes; i++){
+        bytes.push_back((value >> (8 * i)) & 0xFF);
+    }
+}
+
+// a profile with nbr_points points, whose values are the point index plus ping_number
+std::vector<uint8_t> make_profile_message(uint32_t ping_number, uint16_t nbr_points){
+    std::vector<uint8_t> payload;
+    append_uint(payload, 2150 + ping_number, 4);  // distance
+    append_uint(payload, 97, 2);  // confidence
+    append_uint(payload, 150, 2);  // transmit_duration
+    append_uint(payload, ping_number, 4);
+    append_uint(payload, 0, 4);  // scan_start
+    append_uint(payload, 5000, 4);  // scan_length
+    append_uint(payload, 3, 4);  // gain_setting
+    append_uint(payload, nbr_points, 2);
+
+    for (uint16_t i = 0; i < nbr_points; i++){
+        payload.push_back((i + ping_number) & 0xFF);
+    }
+
+    return make_message(ping1d_message_id_profile, payload);
+}
+
+// feed the stream in chunks of chunk_size bytes, as the main loop would find them in the UART buffer; return the ping
+// numbers of the profiles received
+std::vector<uint32_t> parse_stream(Ping1DParser & parser, std::vector<uint8_t> const & stream, size_t chunk_size){
+    std::vector<uint32_t> ping_numbers;
+
+    for (size_t chunk_start = 0; chunk_start < stream.size(); chunk_start += chunk_size){
+        for (size_t i = chunk_start; (i < chunk_start + chunk_size) && (i < stream.size()); i++){
+            if (parser.parse_byte(stream[i]) && (parser.get_message_id() == ping1d_message_id_profile)){
+                Ping1DProfile profile;
+                TEST_ASSERT_TRUE(decode_ping1d_profile(parser.get_payload(), parser.get_payload_length(), profile));
+                ping_numbers.push_back(profile.ping_number);
+            }
+        }
+    }
+
+    return ping_numbers;
+}
+
+void test_general_request(void) {
+    uint8_t request[ping_general_request_nbr_bytes];
+
+    TEST_ASSERT_EQUAL(sizeof(firmware_version_request), make_ping_general_request(request, ping1d_message_id_firmware_version));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(firmware_version_request, request, sizeof(firmware_version_request));
+}
+
+void test_profile_decoding(void) {
+    Ping1DParser parser;
+    std::vector<uint8_t> const message = make_profile_message(12, 200);
+
+    for (size_t i = 0; i < message.size() - 1; i++){
+        TEST_ASSERT_FALSE(parser.parse_byte(message[i]));
+    }
+    TEST_ASSERT_TRUE(parser.parse_byte(message.back()));
+
+    TEST_ASSERT_EQUAL(ping1d_message_id_profile, parser.get_message_id());
+    TEST_ASSERT_EQUAL(26 + 200, parser.get_payload_length());
+
+    Ping1DProfile profile;
+    TEST_ASSERT_TRUE(decode_ping1d_profile(parser.get_payload(), parser.get_payload_length(), profile));
+    TEST_ASSERT_EQUAL(2162, profile.distance);
+    TEST_ASSERT_EQUAL(97, profile.confidence);
+    TEST_ASSERT_EQUAL(150, profile.transmit_duration);
+    TEST_ASSERT_EQUAL(12, profile.ping_number);
+    TEST_ASSERT_EQUAL(5000, profile.scan_length);
+    TEST_ASSERT_EQUAL(3, profile.gain_setting);
+    TEST_ASSERT_EQUAL(200, profile.profile_data_length);
+    for (size_t i = 0; i < 200; i++){
+        TEST_ASSERT_EQUAL_UINT8((i + 12) & 0xFF, profile.profile_data[i]);
+    }
+
+    // a profile that announces more points than it has
+    TEST_ASSERT_FALSE(decode_ping1d_profile(parser.get_payload(), 26 + 100, profile));
+}
+
+void test_stream_in_chunks(void) {
+    // a stream of profiles, mixed with the other messages the sonar may send
+    std::vector<uint8_t> stream;
+    for (uint32_t ping_number = 0; ping_number < 20; ping_number++){
+        std::vector<uint8_t> const profile = make_profile_message(ping_number, 200);
+        stream.insert(stream.end(), profile.begin(), profile.end());
+
+        std::vector<uint8_t> const distance = make_message(ping1d_message_id_distance_simple, {0x66, 0x08, 0, 0, 97});
+        stream.insert(stream.end(), distance.begin(), distance.end());
+    }
+
+    // from one byte at a time to the whole 128 bytes of the UART buffer
+    for (size_t chunk_size : {1, 3, 17, 64, 128}){
+        Ping1DParser parser;
+        std::vector<uint32_t> const ping_numbers = parse_stream(parser, stream, chunk_size);
+
+        TEST_ASSERT_EQUAL(20, ping_numbers.size());
+        for (uint32_t i = 0; i < 20; i++){
+            TEST_ASSERT_EQUAL(i, ping_numbers[i]);
+        }
+        TEST_ASSERT_EQUAL(0, parser.get_nbr_bad_messages());
+        TEST_ASSERT_EQUAL(0, parser.get_nbr_skipped_bytes());
+    }
+}
+
+void test_resynchronisation(void) {
+    std::vector<uint8_t> stream;
+
+    // line noise before the first message, including a lone 'B', a "BB" and a lone 'R'
+    std::vector<uint8_t> const noise {0x00, 0xFF, 'B', 0x13, 'B', 'B', 0x07, 'R'};
+    stream.insert(stream.end(), noise.begin(), noise.end());
+
+    std::vector<uint8_t> message = make_profile_message(1, 200);
+    stream.insert(stream.end(), message.begin(), message.end());
+
+    // a corrupted byte in the profile points: bad checksum
+    message = make_profile_message(2, 200);
+    message[100] ^= 0x01;
+    stream.insert(stream.end(), message.begin(), message.end());
+
+    // a payload too long to be kept
+    message = make_message(ping_message_id_nack, std::vector<uint8_t>(ping_max_payload_nbr_bytes + 1, 'x'));
+    stream.insert(stream.end(), message.begin(), message.end());
+
+    message = make_profile_message(3, 200);
+    stream.insert(stream.end(), message.begin(), message.end());
+
+    Ping1DParser parser;
+    std::vector<uint32_t> const ping_numbers = parse_stream(parser, stream, 32);
+
+    TEST_ASSERT_EQUAL(2, ping_numbers.size());
+    TEST_ASSERT_EQUAL(1, ping_numbers[0]);
+    TEST_ASSERT_EQUAL(3, ping_numbers[1]);
+    TEST_ASSERT_EQUAL(2, parser.get_nbr_bad_messages());
+
+    char message_text[128];
+    snprintf(message_text, sizeof(message_text), "%u bad messages, %u bytes skipped", parser.get_nbr_bad_messages(), parser.get_nbr_skipped_bytes());
+    TEST_MESSAGE(message_text);
+}
+
+void test_reset_drops_partial_message(void) {
+    Ping1DParser parser;
+
+    // the start of an answer that came too late, then the next answer
+    std::vector<uint8_t> const late = make_profile_message(4, 200);
+    for (size_t i = 0; i < 50; i++){
+        parser.parse_byte(late[i]);
+    }
+
+    parser.reset();
+
+    std::vector<uint32_t> const ping_numbers = parse_stream(parser, make_profile_message(5, 200), 16);
+    TEST_ASSERT_EQUAL(1, ping_numbers.size());
+    TEST_ASSERT_EQUAL(5, ping_numbers[0]);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_general_request);
+    RUN_TEST(test_profile_decoding);
+    RUN_TEST(test_stream_in_chunks);
+    RUN_TEST(test_resynchronisation);
+    RUN_TEST(test_reset_drops_partial_message);
+    UNITY_END();
+
+    return 0;
+}
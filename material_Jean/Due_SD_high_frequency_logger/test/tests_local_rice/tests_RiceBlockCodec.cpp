@@ -0,0 +1,248 @@
+#include <unity.h>
+
+#include <RiceBlockCodec.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <vector>
+
+// the data part of a 512 bytes block, after the 12 bytes metadata
+constexpr size_t nbr_data_bytes = 500;
+constexpr size_t nbr_values_per_adc_block = 250;
+
+// the recorded file used for measuring the compression on real data; can be changed with the RICE_REPLAY_FILE
+// environment variable
+constexpr char default_replay_file[] = "../BinarySdDataParser/all_example_data/example_data_geophone_temperature/F00000049.bin";
+
+uint32_t pseudo_random(uint32_t index){
+    return (index * 2654435761u) ^ ((index * 2246822519u) >> 13);
+}
+
+// compress a whole series, fed by ADC blocks of 250 values as the logger does, decode all the blocks, and check
+// that the result is identical; return the nbr of blocks used
+size_t round_trip(std::vector<uint16_t> const & series){
+    std::vector<uint16_t> decoded;
+    uint8_t block_data[nbr_data_bytes];
+    uint16_t decoded_block[rice_max_nbr_samples(nbr_data_bytes)];
+
+    RiceBlockEncoder encoder;
+    encoder.start_block(block_data, nbr_data_bytes);
+    size_t nbr_blocks = 0;
+
+    auto flush_block = [&](){
+        encoder.finish_block();
+        size_t const nbr_decoded = rice_decode_block(block_data, nbr_data_bytes, decoded_block, rice_max_nbr_samples(nbr_data_bytes));
+        TEST_ASSERT_EQUAL(encoder.get_nbr_samples(), nbr_decoded);
+        decoded.insert(decoded.end(), decoded_block, decoded_block + nbr_decoded);
+        nbr_blocks += 1;
+        encoder.start_block(block_data, nbr_data_bytes);
+    };
+
+    for (size_t crrt_start = 0; crrt_start < series.size(); crrt_start += nbr_values_per_adc_block){
+        size_t nbr_values = series.size() - crrt_start;
+        if (nbr_values > nbr_values_per_adc_block){
+            nbr_values = nbr_values_per_adc_block;
+        }
+
+        size_t nbr_values_done = 0;
+        while (nbr_values_done < nbr_values){
+            nbr_values_done += encoder.append(&series[crrt_start + nbr_values_done], nbr_values - nbr_values_done);
+            if (encoder.is_full()){
+                flush_block();
+            }
+        }
+    }
+
+    if (encoder.get_nbr_samples() > 0){
+        flush_block();
+    }
+
+    TEST_ASSERT_EQUAL(series.size(), decoded.size());
+    TEST_ASSERT_TRUE(memcmp(series.data(), decoded.data(), series.size() * sizeof(uint16_t)) == 0);
+
+    return nbr_blocks;
+}
+
+void report_ratio(char const * name, size_t nbr_values, size_t nbr_blocks){
+    double const nbr_raw_blocks = static_cast<double>(nbr_values) / nbr_values_per_adc_block;
+    char message[128];
+    snprintf(message, sizeof(message), "%s: %zu values in %zu blocks, %.2f x fewer blocks than raw", name, nbr_values, nbr_blocks, nbr_raw_blocks / nbr_blocks);
+    TEST_MESSAGE(message);
+}
+
+void test_quiet_signal(void) {
+    // a quiet 12 bits signal: a few counts of noise around the middle value
+    std::vector<uint16_t> series;
+    for (uint32_t i = 0; i < 100000; i++){
+        series.push_back(static_cast<uint16_t>(2047 + static_cast<int>(pseudo_random(i) % 9) - 4));
+    }
+
+    size_t const nbr_blocks = round_trip(series);
+    report_ratio("quiet", series.size(), nbr_blocks);
+
+    // about 4 bits per value
+    TEST_ASSERT_TRUE(nbr_blocks * nbr_values_per_adc_block * 3 < series.size());
+}
+
+void test_worst_case(void) {
+    // full scale 16 bits white noise, including the extreme jumps: the escape keeps it close to raw
+    std::vector<uint16_t> series;
+    for (uint32_t i = 0; i < 50000; i++){
+        uint16_t value = static_cast<uint16_t>(pseudo_random(i) >> 16);
+        if (i % 100 == 0){
+            value = 0;
+        }
+        if (i % 100 == 1){
+            value = 0xFFFF;
+        }
+        series.push_back(value);
+    }
+
+    size_t const nbr_blocks = round_trip(series);
+    report_ratio("worst case", series.size(), nbr_blocks);
+
+    TEST_ASSERT_TRUE(nbr_blocks * nbr_values_per_adc_block < series.size() * 105 / 100);
+}
+
+void test_mixed_signal(void) {
+    // quiet periods, bursts, saturation, and a few single values, to exercise the partition splits at block ends
+    std::vector<uint16_t> series;
+    for (uint32_t i = 0; i < 200000; i++){
+        double value = 2047.0 + static_cast<double>(pseudo_random(i) % 5);
+        if ((i / 10000) % 3 == 1){
+            value += 1500.0 * sin(0.03 * i) * exp(-0.0003 * (i % 10000));
+        }
+        if ((i / 20000) % 5 == 4){
+            value = 4095.0;
+        }
+        series.push_back(static_cast<uint16_t>(value));
+    }
+
+    for (size_t nbr_values : {size_t{1}, size_t{2}, size_t{17}, size_t{250}, series.size()}){
+        std::vector<uint16_t> sub_series(series.begin(), series.begin() + nbr_values);
+        round_trip(sub_series);
+    }
+
+    report_ratio("mixed", series.size(), round_trip(series));
+}
+
+void test_recorded_file(void) {
+    // the compression ratio on real geophone data, all channels
+    char const * path_replay_file = getenv("RICE_REPLAY_FILE");
+    if (path_replay_file == nullptr){
+        path_replay_file = default_replay_file;
+    }
+
+    FILE * replay_file = fopen(path_replay_file, "rb");
+    if (replay_file == nullptr){
+        TEST_IGNORE_MESSAGE("no recorded file to replay");
+        return;
+    }
+
+    std::vector<uint16_t> series_per_channel[16];
+    unsigned char block[512];
+
+    while (fread(block, 1, 512, replay_file) == 512){
+        uint16_t metadata_id;
+        uint16_t block_number;
+        memcpy(&metadata_id, &block[0], 2);
+        memcpy(&block_number, &block[2], 2);
+
+        // the channel is in the high byte of metadata_id if the sequenced flag is set, else in block_number
+        uint16_t const channel = (metadata_id & 0x8000) ? ((metadata_id >> 8) & 0x7F) : block_number;
+
+        if (((metadata_id & 0xFF) != 'A') || (channel >= 16)){
+            continue;
+        }
+
+        uint16_t values[nbr_values_per_adc_block];
+        memcpy(values, &block[12], sizeof(values));
+        series_per_channel[channel].insert(series_per_channel[channel].end(), values, values + nbr_values_per_adc_block);
+    }
+
+    fclose(replay_file);
+
+    for (size_t crrt_channel = 0; crrt_channel < 16; crrt_channel++){
+        if (series_per_channel[crrt_channel].empty()){
+            continue;
+        }
+
+        char name[32];
+        snprintf(name, sizeof(name), "recorded channel %zu", crrt_channel);
+        report_ratio(name, series_per_channel[crrt_channel].size(), round_trip(series_per_channel[crrt_channel]));
+    }
+}
+
+void test_benchmark(void) {
+    // not a pass / fail test: the encoding and decoding throughput, in MB/s of raw 16 bits samples; on the Due, count
+    // some 20 to 40 cycles per value for the encoding
+    std::vector<uint16_t> series;
+    for (uint32_t i = 0; i < 1000000; i++){
+        series.push_back(static_cast<uint16_t>(2047 + static_cast<int>(pseudo_random(i) % 33) - 16));
+    }
+
+    // the blocks are kept, to be decoded in a second pass
+    std::vector<uint8_t> blocks_data;
+    blocks_data.reserve(series.size() * sizeof(uint16_t));
+    uint8_t block_data[nbr_data_bytes];
+    RiceBlockEncoder encoder;
+    encoder.start_block(block_data, nbr_data_bytes);
+    size_t nbr_blocks = 0;
+
+    auto const time_start_encoding = std::chrono::steady_clock::now();
+
+    for (size_t crrt_start = 0; crrt_start < series.size(); crrt_start += nbr_values_per_adc_block){
+        size_t nbr_values_done = 0;
+        while (nbr_values_done < nbr_values_per_adc_block){
+            nbr_values_done += encoder.append(&series[crrt_start + nbr_values_done], nbr_values_per_adc_block - nbr_values_done);
+            if (encoder.is_full()){
+                encoder.finish_block();
+                blocks_data.insert(blocks_data.end(), block_data, block_data + nbr_data_bytes);
+                nbr_blocks += 1;
+                encoder.start_block(block_data, nbr_data_bytes);
+            }
+        }
+    }
+
+    auto const time_end_encoding = std::chrono::steady_clock::now();
+
+    uint16_t decoded_block[rice_max_nbr_samples(nbr_data_bytes)];
+    size_t nbr_decoded = 0;
+
+    auto const time_start_decoding = std::chrono::steady_clock::now();
+
+    for (size_t crrt_block = 0; crrt_block < nbr_blocks; crrt_block++){
+        nbr_decoded += rice_decode_block(&blocks_data[crrt_block * nbr_data_bytes], nbr_data_bytes, decoded_block, rice_max_nbr_samples(nbr_data_bytes));
+    }
+
+    auto const time_end_decoding = std::chrono::steady_clock::now();
+
+    // all the values but the ones of the last block, still being filled
+    TEST_ASSERT_EQUAL(series.size() - encoder.get_nbr_samples(), nbr_decoded);
+
+    double const encoding_seconds = std::chrono::duration<double>(time_end_encoding - time_start_encoding).count();
+    double const decoding_seconds = std::chrono::duration<double>(time_end_decoding - time_start_decoding).count();
+    double const raw_megabytes = series.size() * sizeof(uint16_t) / 1e6;
+
+    char message[128];
+    snprintf(message, sizeof(message), "encoding: %.1f MB/s, %.2f ns per value (%zu blocks)", raw_megabytes / encoding_seconds,
+             encoding_seconds * 1e9 / series.size(), nbr_blocks);
+    TEST_MESSAGE(message);
+    snprintf(message, sizeof(message), "decoding: %.1f MB/s", nbr_decoded * sizeof(uint16_t) / 1e6 / decoding_seconds);
+    TEST_MESSAGE(message);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_quiet_signal);
+    RUN_TEST(test_worst_case);
+    RUN_TEST(test_mixed_signal);
+    RUN_TEST(test_recorded_file);
+    RUN_TEST(test_benchmark);
+    UNITY_END();
+
+    return 0;
+}
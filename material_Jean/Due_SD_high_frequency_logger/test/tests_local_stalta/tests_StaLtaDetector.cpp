@@ -0,0 +1,192 @@
+#include <unity.h>
+
+#include <StaLtaDetector.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// same parameters as in params.h
+constexpr int sta_shift = 5;
+constexpr int lta_shift = 12;
+constexpr uint32_t trigger_ratio_x16 = 4 * 16;
+constexpr uint32_t detrigger_ratio_x16 = 2 * 16;
+
+constexpr size_t nbr_values_per_block = 250;
+constexpr int middle_value = (0b1 << (12-1)) -1;
+
+// the recorded file to replay; can be changed with the STALTA_REPLAY_FILE environment variable
+// this one is a geophone on a bench, with a few finger nail ticks at 3 m
+constexpr char default_replay_file[] = "../BinarySdDataParser/all_example_data/example_data_geophone_temperature/F00000049.bin";
+constexpr uint16_t replay_channel = 2;
+
+// a deterministic, roughly gaussian noise of standard deviation about 10 counts
+int noise(size_t index){
+    int sum = 0;
+    for (uint32_t i = 0; i < 4; i++){
+        sum += static_cast<int>(((static_cast<uint32_t>(index) * 4 + i) * 2654435761u) >> 26);  // 0..63
+    }
+    return (sum - 126) / 2;
+}
+
+// noise, with a 1000 values long burst of amplitude 500 starting at burst_start
+uint16_t signal_value(size_t index, size_t burst_start){
+    int value = middle_value + noise(index);
+
+    if ((index >= burst_start) && (index < burst_start + 1000)){
+        value += static_cast<int>(500.0 * sin(2.0 * M_PI * 0.05 * (index - burst_start)));
+    }
+
+    return static_cast<uint16_t>(value);
+}
+
+void init_detector(StaLtaDetector & detector){
+    detector.init(sta_shift, lta_shift, trigger_ratio_x16, detrigger_ratio_x16);
+}
+
+void test_noise_does_not_trigger(void) {
+    StaLtaDetector detector;
+    init_detector(detector);
+
+    uint16_t block[nbr_values_per_block];
+
+    for (size_t crrt_block = 0; crrt_block < 400; crrt_block++){
+        for (size_t i = 0; i < nbr_values_per_block; i++){
+            block[i] = signal_value(crrt_block * nbr_values_per_block + i, SIZE_MAX / 2);
+        }
+        TEST_ASSERT_FALSE(detector.register_block(block, nbr_values_per_block));
+    }
+
+    TEST_ASSERT_EQUAL(0, detector.get_nbr_triggers());
+}
+
+void test_burst_triggers_and_detriggers(void) {
+    StaLtaDetector detector;
+    init_detector(detector);
+
+    constexpr size_t burst_start = 20000;
+    size_t index_trigger = 0;
+    size_t index_detrigger = 0;
+
+    // value by value, to know exactly when the detector switches
+    for (size_t index = 0; index < 40000; index++){
+        uint16_t const value = signal_value(index, burst_start);
+        bool const was_triggered = detector.is_triggered();
+        detector.register_block(&value, 1);
+
+        if (!was_triggered && detector.is_triggered()){
+            index_trigger = index;
+        }
+        if (was_triggered && !detector.is_triggered()){
+            index_detrigger = index;
+        }
+    }
+
+    char message[128];
+    snprintf(message, sizeof(message), "burst at %zu: trigger at %zu, detrigger at %zu", burst_start, index_trigger, index_detrigger);
+    TEST_MESSAGE(message);
+
+    TEST_ASSERT_EQUAL(1, detector.get_nbr_triggers());
+    TEST_ASSERT_TRUE(index_trigger >= burst_start);
+    TEST_ASSERT_TRUE(index_trigger < burst_start + 20);
+    TEST_ASSERT_TRUE(index_detrigger >= burst_start + 1000);
+    TEST_ASSERT_TRUE(index_detrigger < burst_start + 1000 + 8 * (1 << sta_shift));
+    TEST_ASSERT_FALSE(detector.is_triggered());
+}
+
+void test_block_matches_per_value(void) {
+    StaLtaDetector per_value;
+    StaLtaDetector batched;
+    init_detector(per_value);
+    init_detector(batched);
+
+    uint16_t block[nbr_values_per_block];
+
+    for (size_t crrt_block = 0; crrt_block < 160; crrt_block++){
+        bool per_value_triggered_in_block = per_value.is_triggered();
+
+        for (size_t i = 0; i < nbr_values_per_block; i++){
+            block[i] = signal_value(crrt_block * nbr_values_per_block + i, 30000);
+            per_value_triggered_in_block |= per_value.register_block(&block[i], 1);
+        }
+
+        TEST_ASSERT_EQUAL(per_value_triggered_in_block, batched.register_block(block, nbr_values_per_block));
+        TEST_ASSERT_EQUAL(per_value.is_triggered(), batched.is_triggered());
+        TEST_ASSERT_EQUAL(per_value.get_ratio_x16(), batched.get_ratio_x16());
+    }
+
+    TEST_ASSERT_EQUAL(1, batched.get_nbr_triggers());
+}
+
+void test_replay_recorded_file(void) {
+    // replay the ADC blocks of one channel of a logger F*.bin file through the detector, as the logger would
+    char const * path_replay_file = getenv("STALTA_REPLAY_FILE");
+    if (path_replay_file == nullptr){
+        path_replay_file = default_replay_file;
+    }
+
+    FILE * replay_file = fopen(path_replay_file, "rb");
+    if (replay_file == nullptr){
+        TEST_IGNORE_MESSAGE("no recorded file to replay");
+        return;
+    }
+
+    StaLtaDetector detector;
+    init_detector(detector);
+
+    unsigned char block[512];
+    size_t nbr_blocks = 0;
+    size_t nbr_triggered_blocks = 0;
+
+    while (fread(block, 1, 512, replay_file) == 512){
+        uint16_t metadata_id;
+        uint16_t block_number;
+        uint32_t micros_start;
+        memcpy(&metadata_id, &block[0], 2);
+        memcpy(&block_number, &block[2], 2);
+        memcpy(&micros_start, &block[4], 4);
+
+        // the channel is in the high byte of metadata_id if the sequenced flag is set, else in block_number
+        uint16_t const channel = (metadata_id & 0x8000) ? ((metadata_id >> 8) & 0x7F) : block_number;
+
+        if (((metadata_id & 0xFF) != 'A') || (channel != replay_channel)){
+            continue;
+        }
+
+        uint16_t values[nbr_values_per_block];
+        memcpy(values, &block[12], sizeof(values));
+
+        nbr_blocks += 1;
+
+        if (detector.register_block(values, nbr_values_per_block)){
+            nbr_triggered_blocks += 1;
+
+            char message[128];
+            snprintf(message, sizeof(message), "triggered block starting at %lu us, STA / LTA %.1f",
+                     static_cast<unsigned long>(micros_start), detector.get_ratio_x16() / 16.0);
+            TEST_MESSAGE(message);
+        }
+    }
+
+    fclose(replay_file);
+
+    char message[128];
+    snprintf(message, sizeof(message), "%zu triggers, %zu triggered blocks out of %zu", static_cast<size_t>(detector.get_nbr_triggers()), nbr_triggered_blocks, nbr_blocks);
+    TEST_MESSAGE(message);
+
+    // events are rare and short: most of the data must be outside of them
+    TEST_ASSERT_TRUE(nbr_blocks > 0);
+    TEST_ASSERT_TRUE(nbr_triggered_blocks * 2 < nbr_blocks);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_noise_does_not_trigger);
+    RUN_TEST(test_burst_triggers_and_detriggers);
+    RUN_TEST(test_block_matches_per_value);
+    RUN_TEST(test_replay_recorded_file);
+    UNITY_END();
+
+    return 0;
+}
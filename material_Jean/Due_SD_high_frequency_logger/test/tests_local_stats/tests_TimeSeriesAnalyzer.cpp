@@ -0,0 +1,195 @@
+#include <unity.h>
+
+#include <TimeSeriesAnalyzer.h>
+
+// same parameters as in params.h, but on a shorter window so that the tests run fast
+constexpr int nbr_samples_per_analysis = 1000;
+constexpr int middle_value = (0b1 << (12-1)) -1;
+constexpr int threshold_low = -1228;
+constexpr int threshold_high = 1228;
+
+constexpr size_t nbr_values_per_block = 250;
+
+// a deterministic 12 bits signal with some slow oscillation, some noise and a few extremal values
+uint16_t signal_value(size_t index){
+    uint32_t noise = (static_cast<uint32_t>(index) * 2654435761u) >> 24;  // 0..255
+    int value = middle_value + static_cast<int>(((index / 50) % 2 == 0) ? 300 : -300) + static_cast<int>(noise) - 128;
+
+    if (index % 97 == 0){
+        value = 4095;
+    }
+    if (index % 89 == 0){
+        value = 0;
+    }
+
+    return static_cast<uint16_t>(value);
+}
+
+void init_analyzer(TimeSeriesAnalyzer & analyzer){
+    analyzer.init(nbr_samples_per_analysis, middle_value, threshold_low, threshold_high);
+}
+
+void test_block_matches_per_sample(void) {
+    TimeSeriesAnalyzer per_sample;
+    TimeSeriesAnalyzer batched;
+    init_analyzer(per_sample);
+    init_analyzer(batched);
+
+    uint16_t block[nbr_values_per_block];
+    size_t nbr_windows = 0;
+
+    // 10 windows worth of data, fed as full blocks
+    for (size_t crrt_block = 0; crrt_block < 10 * nbr_samples_per_analysis / nbr_values_per_block; crrt_block++){
+        for (size_t i = 0; i < nbr_values_per_block; i++){
+            block[i] = signal_value(crrt_block * nbr_values_per_block + i);
+            per_sample.register_value(block[i]);
+        }
+        batched.register_block(block, nbr_values_per_block);
+
+        TEST_ASSERT_EQUAL(per_sample.stats_are_available(), batched.stats_are_available());
+
+        if (batched.stats_are_available()){
+            nbr_windows += 1;
+            TimeSeriesStatistics const & stats_per_sample = per_sample.get_stats();
+            TimeSeriesStatistics const & stats_batched = batched.get_stats();
+
+            TEST_ASSERT_EQUAL_DOUBLE(stats_per_sample.mean, stats_batched.mean);
+            TEST_ASSERT_EQUAL_DOUBLE(stats_per_sample.mean_of_square, stats_batched.mean_of_square);
+            TEST_ASSERT_EQUAL_DOUBLE(stats_per_sample.max, stats_batched.max);
+            TEST_ASSERT_EQUAL_DOUBLE(stats_per_sample.min, stats_batched.min);
+            TEST_ASSERT_EQUAL(stats_per_sample.extremal_count, stats_batched.extremal_count);
+        }
+    }
+
+    TEST_ASSERT_EQUAL(10, nbr_windows);
+}
+
+void test_block_across_window_boundary(void) {
+    // blocks that do not divide the window: the window closes in the middle of a block
+    TimeSeriesAnalyzer per_sample;
+    TimeSeriesAnalyzer batched;
+    init_analyzer(per_sample);
+    init_analyzer(batched);
+
+    constexpr size_t odd_block_size = 333;
+    uint16_t block[odd_block_size];
+
+    for (size_t crrt_block = 0; crrt_block < 3; crrt_block++){
+        for (size_t i = 0; i < odd_block_size; i++){
+            block[i] = signal_value(crrt_block * odd_block_size + i);
+            per_sample.register_value(block[i]);
+        }
+        batched.register_block(block, odd_block_size);
+    }
+
+    // 999 values: not yet
+    TEST_ASSERT_FALSE(batched.stats_are_available());
+
+    block[0] = signal_value(999);
+    per_sample.register_value(block[0]);
+    batched.register_block(block, 1);
+
+    TEST_ASSERT_TRUE(per_sample.stats_are_available());
+    TEST_ASSERT_TRUE(batched.stats_are_available());
+
+    TimeSeriesStatistics const & stats_per_sample = per_sample.get_stats();
+    TimeSeriesStatistics const & stats_batched = batched.get_stats();
+
+    TEST_ASSERT_EQUAL_DOUBLE(stats_per_sample.mean, stats_batched.mean);
+    TEST_ASSERT_EQUAL_DOUBLE(stats_per_sample.mean_of_square, stats_batched.mean_of_square);
+    TEST_ASSERT_EQUAL(stats_per_sample.extremal_count, stats_batched.extremal_count);
+}
+
+void test_matches_floating_point_reference(void) {
+    // the historical double precision computation, as it used to run in the ISR
+    TimeSeriesAnalyzer batched;
+    init_analyzer(batched);
+
+    double mean = 0;
+    double mean_of_square = 0;
+    double max_value = -999999.0;
+    double min_value = 999999.0;
+    unsigned long extremal_count = 0;
+
+    uint16_t block[nbr_values_per_block];
+
+    for (size_t crrt_block = 0; crrt_block < nbr_samples_per_analysis / nbr_values_per_block; crrt_block++){
+        for (size_t i = 0; i < nbr_values_per_block; i++){
+            block[i] = signal_value(crrt_block * nbr_values_per_block + i);
+
+            double value = static_cast<double>(block[i] - middle_value);
+            mean += value / static_cast<double>(nbr_samples_per_analysis);
+            mean_of_square += value * value / static_cast<double>(nbr_samples_per_analysis);
+            max_value = value > max_value ? value : max_value;
+            min_value = value < min_value ? value : min_value;
+            if ( (value > threshold_high) || (value < threshold_low) ){
+                extremal_count += 1;
+            }
+        }
+        batched.register_block(block, nbr_values_per_block);
+    }
+
+    TEST_ASSERT_TRUE(batched.stats_are_available());
+    TimeSeriesStatistics const & stats = batched.get_stats();
+
+    TEST_ASSERT_DOUBLE_WITHIN(1e-6, mean, stats.mean);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-3, mean_of_square, stats.mean_of_square);
+    TEST_ASSERT_EQUAL_DOUBLE(max_value, stats.max);
+    TEST_ASSERT_EQUAL_DOUBLE(min_value, stats.min);
+    TEST_ASSERT_EQUAL(extremal_count, stats.extremal_count);
+}
+
+void test_integer_stats_are_exact(void) {
+    // the integer form must be exactly the sums, whatever the order the values come in
+    TimeSeriesAnalyzer batched;
+    init_analyzer(batched);
+
+    int64_t sum = 0;
+    int64_t sum_of_squares = 0;
+    int32_t max_value = -999999;
+    int32_t min_value = 999999;
+    uint32_t extremal_count = 0;
+
+    uint16_t block[nbr_values_per_block];
+
+    for (size_t crrt_block = 0; crrt_block < nbr_samples_per_analysis / nbr_values_per_block; crrt_block++){
+        for (size_t i = 0; i < nbr_values_per_block; i++){
+            block[i] = signal_value(crrt_block * nbr_values_per_block + i);
+
+            int32_t value = block[i] - middle_value;
+            sum += value;
+            sum_of_squares += value * value;
+            max_value = value > max_value ? value : max_value;
+            min_value = value < min_value ? value : min_value;
+            if ( (value > threshold_high) || (value < threshold_low) ){
+                extremal_count += 1;
+            }
+        }
+        batched.register_block(block, nbr_values_per_block);
+    }
+
+    TEST_ASSERT_TRUE(batched.stats_are_available());
+    TimeSeriesIntegerStatistics const & integer_stats = batched.get_integer_stats();
+    TEST_ASSERT_FALSE(batched.stats_are_available());
+
+    TEST_ASSERT_EQUAL_UINT32(nbr_samples_per_analysis, integer_stats.nbr_samples);
+    TEST_ASSERT_EQUAL_INT64(sum, integer_stats.sum);
+    TEST_ASSERT_EQUAL_INT64(sum_of_squares, integer_stats.sum_of_squares);
+    TEST_ASSERT_EQUAL_INT32(max_value, integer_stats.max);
+    TEST_ASSERT_EQUAL_INT32(min_value, integer_stats.min);
+    TEST_ASSERT_EQUAL_UINT32(extremal_count, integer_stats.extremal_count);
+
+    // and the variance computed from the exact sums can never be negative
+    TEST_ASSERT_TRUE(static_cast<int64_t>(integer_stats.nbr_samples) * integer_stats.sum_of_squares >= integer_stats.sum * integer_stats.sum);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_block_matches_per_sample);
+    RUN_TEST(test_block_across_window_boundary);
+    RUN_TEST(test_matches_floating_point_reference);
+    RUN_TEST(test_integer_stats_are_exact);
+    UNITY_END();
+
+    return 0;
+}
@@ -0,0 +1,222 @@
+#include <unity.h>
+
+#include <PpsTimebase.h>
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+
+// 1994-03-23 12:35:19 UTC
+constexpr char rmc_sentence[] = "$GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W*6A";
+constexpr int64_t rmc_utc_seconds = 764426119;
+
+// a Due whose crystal runs fast by drift_ppm, and whose PPS interrupt is late by 0 to 2 * jitter_micros
+struct SyntheticClock{
+    double drift_ppm;
+    double jitter_micros;
+    // the micros at the UTC second rmc_utc_seconds
+    double micros_at_start;
+    uint32_t random_state = 12345;
+
+    // uniform in [0, 1)
+    double random(){
+        random_state = random_state * 1664525u + 1013904223u;
+        return (random_state >> 8) / 16777216.0;
+    }
+
+    // the micros clock (wrapping at 2**32) at utc_micros from the start
+    uint32_t micros_at(double utc_micros){
+        double const micros = micros_at_start + utc_micros * (1.0 + drift_ppm * 1e-6);
+        return static_cast<uint32_t>(static_cast<uint64_t>(llround(micros)) & 0xFFFFFFFFu);
+    }
+
+    uint32_t pps_micros(int64_t second){
+        return micros_at(second * 1e6 + 2.0 * jitter_micros * random());
+    }
+};
+
+NmeaSentenceView make_view(std::string const & sentence){
+    static std::string storage;
+    storage = sentence;
+    return NmeaSentenceView{storage.data(), storage.size(), storage.data(), 0};
+}
+
+// the RMC of second from the start, with a correct checksum
+std::string make_rmc(int64_t second){
+    int64_t const seconds_of_day = (12 * 3600 + 35 * 60 + 19 + second) % 86400;
+    char fields[96];
+    snprintf(fields, sizeof(fields), "GPRMC,%02d%02d%02d,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W",
+             static_cast<int>(seconds_of_day / 3600), static_cast<int>((seconds_of_day / 60) % 60), static_cast<int>(seconds_of_day % 60));
+
+    uint8_t checksum = 0;
+    for (char const * crrt_char = fields; *crrt_char != '\0'; crrt_char++){
+        checksum ^= static_cast<uint8_t>(*crrt_char);
+    }
+
+    char sentence[128];
+    snprintf(sentence, sizeof(sentence), "$%s*%02X", fields, checksum);
+    return sentence;
+}
+
+// feed nbr_seconds of PPS and RMC; the RMC comes 300 ms after its edge
+void run_seconds(PpsTimebase & timebase, SyntheticClock & clock, int64_t first_second, int64_t nbr_seconds){
+    for (int64_t second = first_second; second < first_second + nbr_seconds; second++){
+        timebase.register_pps(clock.pps_micros(second));
+        timebase.register_sentence(make_view(make_rmc(second)), clock.micros_at(second * 1e6 + 300000.0));
+    }
+}
+
+// the largest error of utc_micros, in micros, over a second of ADC blocks after second
+double max_stamp_error(PpsTimebase const & timebase, SyntheticClock & clock, int64_t second){
+    double max_error = 0.0;
+
+    for (double utc_micros = 0.0; utc_micros < 1e6; utc_micros += 4000.0){
+        double const true_utc_micros = (rmc_utc_seconds + second) * 1e6 + utc_micros;
+        double const error = fabs(static_cast<double>(timebase.utc_micros(clock.micros_at(second * 1e6 + utc_micros))) - true_utc_micros);
+
+        if (error > max_error){
+            max_error = error;
+        }
+    }
+
+    return max_error;
+}
+
+void test_parse_rmc(void) {
+    int64_t utc_seconds = 0;
+
+    TEST_ASSERT_TRUE(parse_rmc_utc_seconds(rmc_sentence, strlen(rmc_sentence), utc_seconds));
+    TEST_ASSERT_EQUAL(rmc_utc_seconds, utc_seconds);
+
+    // 2024-02-29 23:59:59, with a fractional time and another talker ID
+    char const leap_day[] = "$GNRMC,235959.00,A,4807.038,N,01131.000,E,0.0,0.0,290224,,,A*00";
+    TEST_ASSERT_TRUE(parse_rmc_utc_seconds(leap_day, strlen(leap_day), utc_seconds));
+    TEST_ASSERT_EQUAL(1709251199, utc_seconds);
+
+    // no fix
+    char const no_fix[] = "$GPRMC,123519,V,,,,,,,230394,,,N*00";
+    TEST_ASSERT_FALSE(parse_rmc_utc_seconds(no_fix, strlen(no_fix), utc_seconds));
+
+    char const not_rmc[] = "$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47";
+    TEST_ASSERT_FALSE(parse_rmc_utc_seconds(not_rmc, strlen(not_rmc), utc_seconds));
+}
+
+void test_drift_and_stamps(void) {
+    SyntheticClock clock {37.5, 5.0, 1000000.0};
+    PpsTimebase timebase;
+
+    TEST_ASSERT_FALSE(timebase.is_valid());
+    run_seconds(timebase, clock, 0, 2);
+    TEST_ASSERT_TRUE(timebase.is_valid());
+
+    run_seconds(timebase, clock, 2, 118);
+
+    TimebaseRecord const & record = timebase.get_record();
+    TEST_ASSERT_EQUAL(pps_timebase_nbr_edges_in_fit, record.nbr_edges_in_fit);
+    TEST_ASSERT_EQUAL(0, record.nbr_rejected_edges);
+    TEST_ASSERT_INT_WITHIN(1000, 37500, record.drift_ppb);
+    TEST_ASSERT_EQUAL((rmc_utc_seconds + 119) * 1000000, record.utc_micros_reference);
+
+    // the mean lateness of the interrupt, jitter_micros, is a constant offset that no model can see
+    double const max_error = max_stamp_error(timebase, clock, 119);
+    TEST_ASSERT_DOUBLE_WITHIN(4.0, clock.jitter_micros, max_error);
+
+    char message[128];
+    snprintf(message, sizeof(message), "drift %d ppb, residual %u ns rms, max stamp error %.2f us",
+             record.drift_ppb, record.residual_rms_nanos, max_error);
+    TEST_MESSAGE(message);
+}
+
+void test_micros_wrap_around(void) {
+    // the micros clock wraps 30 seconds in
+    SyntheticClock clock {-12.0, 2.0, 4294967296.0 - 30e6};
+    PpsTimebase timebase;
+
+    run_seconds(timebase, clock, 0, 60);
+
+    TEST_ASSERT_EQUAL(0, timebase.get_record().nbr_rejected_edges);
+    TEST_ASSERT_INT_WITHIN(1000, -12000, timebase.get_record().drift_ppb);
+    TEST_ASSERT_TRUE(max_stamp_error(timebase, clock, 59) < 10.0);
+}
+
+void test_glitches_and_gaps(void) {
+    SyntheticClock clock {20.0, 3.0, 5e6};
+    PpsTimebase timebase;
+
+    run_seconds(timebase, clock, 0, 40);
+
+    // a glitch on the PPS line, half way through a second
+    timebase.register_pps(clock.micros_at(40.5e6));
+    TEST_ASSERT_EQUAL(1, timebase.get_record().nbr_rejected_edges);
+
+    // a gap of 20 seconds without PPS nor RMC, bridged by the model
+    timebase.register_pps(clock.pps_micros(60));
+    TEST_ASSERT_EQUAL(1, timebase.get_record().nbr_rejected_edges);
+    TEST_ASSERT_EQUAL((rmc_utc_seconds + 60) * 1000000, timebase.get_record().utc_micros_reference);
+
+    run_seconds(timebase, clock, 61, 10);
+    TEST_ASSERT_TRUE(timebase.is_valid());
+    TEST_ASSERT_TRUE(max_stamp_error(timebase, clock, 70) < 10.0);
+}
+
+void test_restart_after_lost_track(void) {
+    SyntheticClock clock {20.0, 3.0, 5e6};
+    PpsTimebase timebase;
+
+    run_seconds(timebase, clock, 0, 10);
+
+    // the edges go off the model, e.g. the micros clock was reset: the fit starts again, without the UTC until the next
+    // RMC
+    clock.micros_at_start += 250000.0;
+    timebase.register_pps(clock.pps_micros(10));
+    timebase.register_pps(clock.pps_micros(11));
+    TEST_ASSERT_EQUAL(2, timebase.get_record().nbr_rejected_edges);
+    TEST_ASSERT_FALSE(timebase.is_valid());
+
+    timebase.register_sentence(make_view(make_rmc(11)), clock.micros_at(11.3e6));
+    run_seconds(timebase, clock, 12, 10);
+    TEST_ASSERT_TRUE(timebase.is_valid());
+    TEST_ASSERT_TRUE(max_stamp_error(timebase, clock, 21) < 10.0);
+}
+
+void test_late_rmc(void) {
+    SyntheticClock clock {20.0, 3.0, 5e6};
+    PpsTimebase timebase;
+
+    run_seconds(timebase, clock, 0, 20);
+
+    // the main loop was away past the next edge: the RMC of second 20 is only seen after the edge of second 21
+    timebase.register_pps(clock.pps_micros(20));
+    timebase.register_pps(clock.pps_micros(21));
+    timebase.register_sentence(make_view(make_rmc(20)), clock.micros_at(21.1e6));
+
+    TEST_ASSERT_EQUAL((rmc_utc_seconds + 21) * 1000000, timebase.get_record().utc_micros_reference);
+    TEST_ASSERT_TRUE(max_stamp_error(timebase, clock, 21) < 10.0);
+
+    run_seconds(timebase, clock, 22, 5);
+    TEST_ASSERT_TRUE(max_stamp_error(timebase, clock, 26) < 10.0);
+
+    // but 2 RMCs in a row that agree on another UTC are followed, as when the edges were miscounted
+    timebase.register_pps(clock.pps_micros(27));
+    timebase.register_sentence(make_view(make_rmc(28)), clock.micros_at(27.3e6));
+    TEST_ASSERT_EQUAL((rmc_utc_seconds + 27) * 1000000, timebase.get_record().utc_micros_reference);
+
+    timebase.register_pps(clock.pps_micros(28));
+    timebase.register_sentence(make_view(make_rmc(29)), clock.micros_at(28.3e6));
+    TEST_ASSERT_EQUAL((rmc_utc_seconds + 29) * 1000000, timebase.get_record().utc_micros_reference);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_parse_rmc);
+    RUN_TEST(test_drift_and_stamps);
+    RUN_TEST(test_micros_wrap_around);
+    RUN_TEST(test_glitches_and_gaps);
+    RUN_TEST(test_restart_after_lost_track);
+    RUN_TEST(test_late_rmc);
+    UNITY_END();
+
+    return 0;
+}
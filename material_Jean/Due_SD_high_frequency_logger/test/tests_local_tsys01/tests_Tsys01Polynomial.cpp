@@ -0,0 +1,95 @@
+#include <unity.h>
+
+#include <Tsys01Polynomial.h>
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <math.h>
+
+// the PROM of the example of the TSYS01 datasheet: k4 = 28446, k3 = 24926, k2 = 36016, k1 = 32791, k0 = 40781
+constexpr uint16_t datasheet_calibration[8] = {0, 28446, 24926, 36016, 32791, 40781, 0, 0};
+constexpr uint32_t datasheet_reading = 9378708;
+
+// the formula of the datasheet, in double
+double reference_degrees(uint16_t const * calibration, uint32_t reading){
+    double const x = reading / 256;
+
+    double const degrees = -2.0 * calibration[1] * 1e-21 * pow(x, 4) +
+                            4.0 * calibration[2] * 1e-16 * pow(x, 3) +
+                           -2.0 * calibration[3] * 1e-11 * pow(x, 2) +
+                            1.0 * calibration[4] * 1e-6 * x +
+                           -1.5 * calibration[5] * 1e-2;
+
+    return fmin(99.0, fmax(-99.0, degrees));
+}
+
+void test_datasheet_example(void) {
+    Tsys01Polynomial polynomial;
+    polynomial.init(datasheet_calibration);
+
+    // 10.58 degrees in the datasheet
+    TEST_ASSERT_INT_WITHIN(1, 1058, polynomial.centi_degrees(datasheet_reading));
+}
+
+void test_matches_reference_over_range(void) {
+    Tsys01Polynomial polynomial;
+    polynomial.init(datasheet_calibration);
+
+    int max_error = 0;
+
+    for (uint32_t x = 0; x < 65536; x++){
+        uint32_t const reading = (x << 8) | 0x80;
+        int const expected = static_cast<int>(lround(reference_degrees(datasheet_calibration, reading) * 100.0));
+        int const error = abs(polynomial.centi_degrees(reading) - expected);
+
+        if (error > max_error){
+            max_error = error;
+        }
+    }
+
+    char message[128];
+    snprintf(message, sizeof(message), "max error over the whole range: %d centi degrees", max_error);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_LESS_OR_EQUAL(1, max_error);
+}
+
+void test_extreme_calibrations(void) {
+    // all the coefficients at their max, and each on its own, must not overflow
+    uint16_t calibration[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+
+    for (int k = 1; k <= 6; k++){
+        for (int i = 1; i <= 5; i++){
+            calibration[i] = ((k == 6) || (k == i)) ? 65535 : 0;
+        }
+
+        Tsys01Polynomial polynomial;
+        polynomial.init(calibration);
+
+        for (uint32_t x = 0; x < 65536; x += 97){
+            uint32_t const reading = x << 8;
+            int const expected = static_cast<int>(lround(reference_degrees(calibration, reading) * 100.0));
+            TEST_ASSERT_INT_WITHIN(1, expected, polynomial.centi_degrees(reading));
+        }
+    }
+}
+
+void test_clamping(void) {
+    Tsys01Polynomial polynomial;
+    polynomial.init(datasheet_calibration);
+
+    // the full scale readings are far out of the range of the sensor
+    TEST_ASSERT_EQUAL(-9900, polynomial.centi_degrees(0));
+    TEST_ASSERT_EQUAL(9900, polynomial.centi_degrees(0xFFFFFF));
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_datasheet_example);
+    RUN_TEST(test_matches_reference_over_range);
+    RUN_TEST(test_extreme_calibrations);
+    RUN_TEST(test_clamping);
+    UNITY_END();
+
+    return 0;
+}